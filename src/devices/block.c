@@ -3,7 +3,44 @@
 #include <string.h>
 #include <stdio.h>
 #include "devices/ide.h"
+#include "devices/timer.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* A request not dispatched within this many timer ticks of its
+   submission goes ahead of the elevator order. */
+#define READ_EXPIRE (TIMER_FREQ / 2)
+#define WRITE_EXPIRE (TIMER_FREQ * 5)
+
+/* Most sectors in a batch of merged requests whose buffers are
+   contiguous in memory, and in one staged through a queue's
+   bounce buffer because they are not. */
+#define MAX_BATCH_SECTORS 256
+#define BOUNCE_SECTORS (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* Number of buckets in a latency histogram.  Bucket 0 counts
+   requests that took less than 1 us, bucket I > 0 those that took
+   from 2**(I-1) to 2**I - 1 us, and the last bucket also counts
+   any that took longer. */
+#define LATENCY_BUCKETS 24
+
+/* I/O statistics for a device with a request queue. */
+struct iostat
+  {
+    unsigned long long read_sectors;    /* Sectors read. */
+    unsigned long long write_sectors;   /* Sectors written. */
+    unsigned long long request_cnt;     /* Requests completed. */
+    unsigned long long seq_batches;     /* Batches continuing the last. */
+    unsigned long long random_batches;  /* Batches that seek. */
+    uint64_t busy_cycles;               /* Time spent in the driver. */
+    uint64_t wait_cycles;               /* Time requests spent queued. */
+    size_t depth;                       /* Requests now queued. */
+    size_t max_depth;                   /* Most requests ever queued. */
+    unsigned long long depth_sum;       /* Sum of depths at submission. */
+    unsigned long long latency[LATENCY_BUCKETS]; /* Submit to complete. */
+  };
 
 /* A block device. */
 struct block
@@ -19,6 +56,31 @@ struct block
 
     unsigned long long read_cnt;        /* Number of sectors read. */
     unsigned long long write_cnt;       /* Number of sectors written. */
+
+    /* Staging page for transfers to and from user buffers,
+       allocated by the first such transfer. */
+    struct lock user_lock;              /* Guards user_bounce. */
+    void *user_bounce;                  /* BOUNCE_SECTORS sectors, or null. */
+
+    /* Request queue, for devices without a submit operation. */
+    struct block_dispatcher *dispatcher; /* Serves the queue. */
+    struct list_elem dispatch_elem;     /* Element in dispatcher's list. */
+    struct list sorted_queue;           /* Pending requests by sector. */
+    struct list fifo_queue;             /* Pending requests by arrival. */
+    block_sector_t head;                /* Sector after last dispatched. */
+    void *bounce;                       /* BOUNCE_SECTORS sectors, or null. */
+    struct iostat stats;                /* Updated by the dispatcher. */
+  };
+
+/* A dispatch thread and the queued devices it serves, one batch
+   of requests at a time, taking turns among devices whose queues
+   are nonempty. */
+struct block_dispatcher
+  {
+    struct lock lock;                   /* Guards devices' queues. */
+    struct condition nonempty;          /* Signaled on submission. */
+    struct list devices;                /* Devices served. */
+    struct block *last;                 /* Device served last, or null. */
   };
 
 /* List of all block devices. */
@@ -28,6 +90,12 @@ static struct list all_blocks = LIST_INITIALIZER (all_blocks);
 static struct block *block_by_role[BLOCK_ROLE_CNT];
 
 static struct block *list_elem_to_block (struct list_elem *);
+static void transfer (struct block *, bool write, block_sector_t,
+                      size_t cnt, void *buffer);
+static void transfer_user (struct block *, bool write, block_sector_t,
+                           size_t cnt, uint8_t *buffer);
+static thread_func dispatch_thread NO_RETURN;
+static void print_iostat (struct block *);
 
 /* Returns a human-readable name for the given block device
    TYPE. */
@@ -120,9 +188,7 @@ check_sector (struct block *block, block_sector_t sector)
 void
 block_read (struct block *block, block_sector_t sector, void *buffer)
 {
-  check_sector (block, sector);
-  block->ops->read (block->aux, sector, buffer);
-  block->read_cnt++;
+  transfer (block, false, sector, 1, buffer);
 }
 
 /* Write sector SECTOR to BLOCK from BUFFER, which must contain
@@ -132,13 +198,471 @@ block_read (struct block *block, block_sector_t sector, void *buffer)
    per-block device locking is unneeded. */
 void
 block_write (struct block *block, block_sector_t sector, const void *buffer)
+{
+  transfer (block, true, sector, 1, (void *) buffer);
+}
+
+/* Verifies that the CNT sectors starting at SECTOR all lie
+   within BLOCK.  Panics if not. */
+static void
+check_sectors (struct block *block, block_sector_t sector, size_t cnt)
 {
   check_sector (block, sector);
-  ASSERT (block->type != BLOCK_FOREIGN);
-  block->ops->write (block->aux, sector, buffer);
-  block->write_cnt++;
+  if (cnt > block->size - sector)
+    PANIC ("Access past end of device %s (sector=%"PRDSNu", count=%zu, "
+           "size=%"PRDSNu")\n", block_name (block), sector, cnt,
+           block->size);
+}
+
+/* Reads the CNT consecutive sectors starting at SECTOR from BLOCK
+   into BUFFER, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes.  Drivers that support it move the whole range with as
+   few commands as they can.
+   Internally synchronizes accesses to block devices, so external
+   per-block device locking is unneeded. */
+void
+block_read_multiple (struct block *block, block_sector_t sector, size_t cnt,
+                     void *buffer)
+{
+  if (cnt > 0)
+    transfer (block, false, sector, cnt, buffer);
+}
+
+/* Writes the CNT consecutive sectors starting at SECTOR to BLOCK
+   from BUFFER, which must contain CNT * BLOCK_SECTOR_SIZE bytes.
+   Returns after the block device has acknowledged receiving all
+   of the data.
+   Internally synchronizes accesses to block devices, so external
+   per-block device locking is unneeded. */
+void
+block_write_multiple (struct block *block, block_sector_t sector, size_t cnt,
+                      const void *buffer)
+{
+  if (cnt > 0)
+    transfer (block, true, sector, cnt, (void *) buffer);
+}
+
+/* Transfers the CNT sectors starting at SECTOR between BLOCK and
+   BUFFER as a request, and waits for it to complete.  Requests
+   need kernel buffers, because the dispatch thread does not run
+   in the caller's address space, so a user BUFFER is staged
+   through transfer_user(). */
+static void
+transfer (struct block *block, bool write, block_sector_t sector,
+          size_t cnt, void *buffer)
+{
+  struct block_request req;
+
+  if (!is_kernel_vaddr (buffer))
+    {
+      transfer_user (block, write, sector, cnt, buffer);
+      return;
+    }
+
+  block_request_init (&req, write, sector, cnt, buffer, NULL, NULL);
+  block_submit (block, &req);
+  block_wait (&req);
+}
+
+/* Transfers the CNT sectors starting at SECTOR between BLOCK and
+   user BUFFER a page at a time, through BLOCK's user bounce page.
+   The page is allocated on first use, since most devices are
+   only ever accessed through kernel buffers.  If it cannot be,
+   falls back to staging one sector at a time on the stack. */
+static void
+transfer_user (struct block *block, bool write, block_sector_t sector,
+               size_t cnt, uint8_t *buffer)
+{
+  uint8_t sector_buf[BLOCK_SECTOR_SIZE];
+  uint8_t *bounce;
+  size_t max_cnt;
+
+  lock_acquire (&block->user_lock);
+  if (block->user_bounce == NULL)
+    block->user_bounce = palloc_get_page (0);
+  if (block->user_bounce != NULL)
+    {
+      bounce = block->user_bounce;
+      max_cnt = BOUNCE_SECTORS;
+    }
+  else
+    {
+      bounce = sector_buf;
+      max_cnt = 1;
+    }
+
+  while (cnt > 0)
+    {
+      size_t n = cnt < max_cnt ? cnt : max_cnt;
+      size_t size = n * BLOCK_SECTOR_SIZE;
+
+      if (write)
+        memcpy (bounce, buffer, size);
+      transfer (block, write, sector, n, bounce);
+      if (!write)
+        memcpy (buffer, bounce, size);
+      buffer += size;
+      sector += n;
+      cnt -= n;
+    }
+  lock_release (&block->user_lock);
+}
+
+/* Asynchronous requests. */
+
+/* Initializes REQ to transfer the CNT sectors starting at SECTOR
+   between a block device and BUFFER: to the device if WRITE,
+   otherwise from it.  When REQ completes, CALLBACK will be called
+   with REQ and AUX, or, if CALLBACK is null, block_wait() on REQ
+   will return. */
+void
+block_request_init (struct block_request *req, bool write,
+                    block_sector_t sector, size_t cnt, void *buffer,
+                    block_callback_func *callback, void *aux)
+{
+  req->write = write;
+  req->sector = sector;
+  req->cnt = cnt;
+  req->buffer = buffer;
+  req->callback = callback;
+  req->aux = aux;
+  sema_init (&req->done, 0);
+}
+
+/* Returns true if request A_ starts at a lower sector than
+   request B_. */
+static bool
+request_less (const struct list_elem *a_, const struct list_elem *b_,
+              void *aux UNUSED)
+{
+  const struct block_request *a = list_entry (a_, struct block_request,
+                                              sort_elem);
+  const struct block_request *b = list_entry (b_, struct block_request,
+                                              sort_elem);
+  return a->sector < b->sector;
+}
+
+/* Queues REQ for BLOCK and returns without waiting for it.
+   Requests that overlap each other may be carried out in either
+   order, so a caller that cares must wait for one before
+   submitting the other. */
+void
+block_submit (struct block *block, struct block_request *req)
+{
+  ASSERT (req->cnt > 0);
+  ASSERT (is_kernel_vaddr (req->buffer));
+  check_sectors (block, req->sector, req->cnt);
+  if (req->write)
+    {
+      ASSERT (block->type != BLOCK_FOREIGN);
+      block->write_cnt += req->cnt;
+    }
+  else
+    block->read_cnt += req->cnt;
+
+  if (block->ops->submit != NULL)
+    {
+      block->ops->submit (block->aux, req);
+      return;
+    }
+
+  req->deadline = timer_ticks () + (req->write ? WRITE_EXPIRE : READ_EXPIRE);
+  req->submitted = timer_cycles ();
+  lock_acquire (&block->dispatcher->lock);
+  list_insert_ordered (&block->sorted_queue, &req->sort_elem,
+                       request_less, NULL);
+  list_push_back (&block->fifo_queue, &req->fifo_elem);
+  block->stats.depth++;
+  if (block->stats.depth > block->stats.max_depth)
+    block->stats.max_depth = block->stats.depth;
+  block->stats.depth_sum += block->stats.depth;
+  cond_signal (&block->dispatcher->nonempty, &block->dispatcher->lock);
+  lock_release (&block->dispatcher->lock);
+}
+
+/* Waits for REQ, which must have no completion callback, to
+   complete. */
+void
+block_wait (struct block_request *req)
+{
+  ASSERT (req->callback == NULL);
+  sema_down (&req->done);
+}
+
+/* Completes REQ, calling its callback or waking its waiter.
+   The dispatch thread calls this for queued requests, and a
+   driver whose submit operation carries out REQ itself calls it
+   once it has. */
+void
+block_complete (struct block_request *req)
+{
+  if (req->callback != NULL)
+    req->callback (req, req->aux);
+  else
+    sema_up (&req->done);
+}
+
+/* Picks the request that BLOCK should dispatch next.  That is
+   the oldest request past its deadline, if any.  Otherwise, the
+   elevator sweeps upward from BLOCK->head and then jumps back to
+   the lowest pending sector (C-LOOK).
+   BLOCK's queue must be nonempty and the caller must hold its
+   dispatcher's lock. */
+static struct block_request *
+choose_request (struct block *block)
+{
+  int64_t now = timer_ticks ();
+  struct list_elem *e;
+
+  for (e = list_begin (&block->fifo_queue); e != list_end (&block->fifo_queue);
+       e = list_next (e))
+    {
+      struct block_request *r = list_entry (e, struct block_request,
+                                            fifo_elem);
+      if (r->deadline <= now)
+        return r;
+    }
+
+  for (e = list_begin (&block->sorted_queue);
+       e != list_end (&block->sorted_queue); e = list_next (e))
+    {
+      struct block_request *r = list_entry (e, struct block_request,
+                                            sort_elem);
+      if (r->sector >= block->head)
+        return r;
+    }
+
+  return list_entry (list_front (&block->sorted_queue),
+                     struct block_request, sort_elem);
+}
+
+/* Removes the request chosen by choose_request() from BLOCK's
+   queue, along with any that continue it on the device in the
+   same direction, and puts them in BATCH in sector order.
+   Sets *BUFFER to the requests' own memory if it is also
+   contiguous, otherwise to BLOCK's bounce buffer.  Returns the
+   batch's total number of sectors.
+   BLOCK's queue must be nonempty and the caller must hold its
+   dispatcher's lock. */
+static size_t
+take_batch (struct block *block, struct list *batch, void **buffer)
+{
+  struct block_request *first = choose_request (block);
+  struct block_request *last = first;
+  struct list_elem *e = list_next (&first->sort_elem);
+  size_t cnt = first->cnt;
+  bool contiguous = true;
+  uint64_t now = timer_cycles ();
+
+  if (first->sector == block->head)
+    block->stats.seq_batches++;
+  else
+    block->stats.random_batches++;
+
+  list_init (batch);
+  list_remove (&first->sort_elem);
+  list_remove (&first->fifo_elem);
+  list_push_back (batch, &first->sort_elem);
+  block->stats.wait_cycles += now - first->submitted;
+
+  while (e != list_end (&block->sorted_queue))
+    {
+      struct block_request *r = list_entry (e, struct block_request,
+                                            sort_elem);
+      bool still_contiguous = (contiguous
+                               && r->buffer == ((uint8_t *) last->buffer
+                                                + last->cnt
+                                                  * BLOCK_SECTOR_SIZE));
+      size_t max_cnt = (still_contiguous ? MAX_BATCH_SECTORS
+                        : block->bounce != NULL ? BOUNCE_SECTORS : 0);
+
+      if (r->write != first->write
+          || r->sector != last->sector + last->cnt
+          || cnt + r->cnt > max_cnt)
+        break;
+
+      e = list_next (e);
+      list_remove (&r->sort_elem);
+      list_remove (&r->fifo_elem);
+      list_push_back (batch, &r->sort_elem);
+      block->stats.wait_cycles += now - r->submitted;
+      cnt += r->cnt;
+      contiguous = still_contiguous;
+      last = r;
+    }
+
+  block->head = first->sector + cnt;
+  block->stats.depth -= list_size (batch);
+  *buffer = contiguous ? first->buffer : block->bounce;
+  return cnt;
+}
+
+/* Copies between BUFFER, a bounce buffer, and the buffers of the
+   requests in BATCH: into BUFFER if TO_BUFFER, otherwise out of
+   it. */
+static void
+copy_batch (struct list *batch, uint8_t *buffer, bool to_buffer)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (batch); e != list_end (batch); e = list_next (e))
+    {
+      struct block_request *r = list_entry (e, struct block_request,
+                                            sort_elem);
+      size_t size = r->cnt * BLOCK_SECTOR_SIZE;
+
+      if (to_buffer)
+        memcpy (buffer, r->buffer, size);
+      else
+        memcpy (r->buffer, buffer, size);
+      buffer += size;
+    }
+}
+
+/* Has BLOCK's driver transfer the CNT sectors starting at SECTOR
+   between the device and BUFFER. */
+static void
+driver_transfer (struct block *block, bool write, block_sector_t sector,
+                 size_t cnt, void *buffer)
+{
+  const struct block_operations *ops = block->ops;
+  uint8_t *p = buffer;
+  size_t i;
+
+  if (write && ops->write_multiple != NULL)
+    ops->write_multiple (block->aux, sector, cnt, buffer);
+  else if (!write && ops->read_multiple != NULL)
+    ops->read_multiple (block->aux, sector, cnt, buffer);
+  else
+    for (i = 0; i < cnt; i++, p += BLOCK_SECTOR_SIZE)
+      if (write)
+        ops->write (block->aux, sector + i, p);
+      else
+        ops->read (block->aux, sector + i, p);
+}
+
+/* Returns the next device, in turn after the one served last,
+   that dispatcher D should serve, or a null pointer if all of
+   its devices' queues are empty.
+   The caller must hold D's lock. */
+static struct block *
+next_device (struct block_dispatcher *d)
+{
+  struct list_elem *e;
+  size_t i, n = list_size (&d->devices);
+
+  e = (d->last != NULL ? list_next (&d->last->dispatch_elem)
+       : list_begin (&d->devices));
+  for (i = 0; i < n; i++, e = list_next (e))
+    {
+      struct block *block;
+
+      if (e == list_end (&d->devices))
+        e = list_begin (&d->devices);
+      block = list_entry (e, struct block, dispatch_elem);
+      if (!list_empty (&block->fifo_queue))
+        return d->last = block;
+    }
+  return NULL;
+}
+
+/* Returns the number of timer_cycles() per microsecond, or 1 if
+   that is not known yet. */
+static uint64_t
+cycles_per_us (void)
+{
+  uint64_t n = timer_cycle_freq () / 1000000;
+  return n > 0 ? n : 1;
+}
+
+/* Counts a request that took CYCLES from submission to
+   completion in STATS. */
+static void
+record_latency (struct iostat *stats, uint64_t cycles)
+{
+  uint64_t us = cycles / cycles_per_us ();
+  int bucket = 0;
+
+  while (us > 0 && bucket < LATENCY_BUCKETS - 1)
+    {
+      us >>= 1;
+      bucket++;
+    }
+  stats->latency[bucket]++;
+  stats->request_cnt++;
+}
+
+/* Dispatch thread for D_, which is a struct block_dispatcher *.
+   Takes batches of requests off its devices' queues, carries
+   each out with a single driver call, and completes its
+   requests. */
+static void
+dispatch_thread (void *d_)
+{
+  struct block_dispatcher *d = d_;
+
+  for (;;)
+    {
+      struct list batch;
+      struct block *block;
+      struct block_request *first;
+      void *buffer;
+      size_t cnt;
+      uint64_t start;
+
+      lock_acquire (&d->lock);
+      while ((block = next_device (d)) == NULL)
+        cond_wait (&d->nonempty, &d->lock);
+      cnt = take_batch (block, &batch, &buffer);
+      lock_release (&d->lock);
+
+      start = timer_cycles ();
+      first = list_entry (list_front (&batch), struct block_request,
+                          sort_elem);
+      if (first->write && buffer == block->bounce)
+        copy_batch (&batch, buffer, true);
+      driver_transfer (block, first->write, first->sector, cnt, buffer);
+      if (!first->write && buffer == block->bounce)
+        copy_batch (&batch, buffer, false);
+      block->stats.busy_cycles += timer_cycles () - start;
+      if (first->write)
+        block->stats.write_sectors += cnt;
+      else
+        block->stats.read_sectors += cnt;
+
+      /* A waiter may free its request as soon as it wakes up, so
+         take each one off the batch first. */
+      while (!list_empty (&batch))
+        {
+          struct block_request *r = list_entry (list_pop_front (&batch),
+                                                struct block_request,
+                                                sort_elem);
+          record_latency (&block->stats, timer_cycles () - r->submitted);
+          block_complete (r);
+        }
+    }
 }
 
+/* Creates a dispatcher, with a thread named NAME, for devices
+   passed to block_register_dispatched().  Devices that cannot
+   transfer at the same time, such as the two disks on an IDE
+   channel, should share one. */
+struct block_dispatcher *
+block_dispatcher_create (const char *name)
+{
+  struct block_dispatcher *d = malloc (sizeof *d);
+  if (d == NULL)
+    PANIC ("%s: failed to allocate dispatcher", name);
+
+  lock_init (&d->lock);
+  cond_init (&d->nonempty);
+  list_init (&d->devices);
+  d->last = NULL;
+  if (thread_create (name, PRI_MAX, dispatch_thread, d) == TID_ERROR)
+    PANIC ("%s: failed to create dispatch thread", name);
+  return d;
+}
+
 /* Returns the number of sectors in BLOCK. */
 block_sector_t
 block_size (struct block *block)
@@ -160,10 +684,13 @@ block_type (struct block *block)
   return block->type;
 }
 
-/* Prints statistics for each block device used for a Pintos role. */
+/* Prints statistics for each block device used for a Pintos role,
+   then detailed statistics for each device that has a request
+   queue or whose driver keeps its own. */
 void
 block_print_stats (void)
 {
+  struct list_elem *e;
   int i;
 
   for (i = 0; i < BLOCK_ROLE_CNT; i++)
@@ -176,17 +703,81 @@ block_print_stats (void)
                   block->read_cnt, block->write_cnt);
         }
     }
+
+  for (e = list_begin (&all_blocks); e != list_end (&all_blocks);
+       e = list_next (e))
+    {
+      struct block *block = list_entry (e, struct block, list_elem);
+      if (block->dispatcher != NULL && block->stats.request_cnt > 0)
+        print_iostat (block);
+      if (block->ops->print_stats != NULL)
+        block->ops->print_stats (block->aux);
+    }
+}
+
+/* Prints the statistics kept by queued device BLOCK: data
+   transferred and how fast, how often requests were sequential,
+   how deep the queue got and how long requests waited in it, and
+   a histogram of request latencies. */
+static void
+print_iostat (struct block *block)
+{
+  const struct iostat *s = &block->stats;
+  uint64_t per_us = cycles_per_us ();
+  unsigned long long sectors = s->read_sectors + s->write_sectors;
+  unsigned long long batches = s->seq_batches + s->random_batches;
+  unsigned long long ms = s->busy_cycles / per_us / 1000;
+  unsigned long long submitted = s->request_cnt + s->depth;
+  int i;
+
+  printf ("%s: %llu kB read, %llu kB written, %llu requests "
+          "in %llu batches, %llu%% sequential\n",
+          block->name, s->read_sectors * BLOCK_SECTOR_SIZE / 1024,
+          s->write_sectors * BLOCK_SECTOR_SIZE / 1024, s->request_cnt,
+          batches, batches > 0 ? s->seq_batches * 100 / batches : 0);
+  printf ("%s: %llu ms busy", block->name, ms);
+  if (ms > 0)
+    printf (", %llu kB/s", sectors * BLOCK_SECTOR_SIZE / 1024 * 1000 / ms);
+  if (submitted > 0)
+    printf (", queue depth avg %llu.%llu max %zu",
+            s->depth_sum / submitted, s->depth_sum * 10 / submitted % 10,
+            s->max_depth);
+  if (s->request_cnt > 0)
+    printf (", avg wait %llu us",
+            (unsigned long long) (s->wait_cycles / per_us / s->request_cnt));
+  printf ("\n");
+
+  printf ("%s: latency (us):", block->name);
+  for (i = 0; i < LATENCY_BUCKETS; i++)
+    if (s->latency[i] > 0)
+      printf (" %llu+:%llu", i > 0 ? 1ULL << (i - 1) : 0ULL, s->latency[i]);
+  printf ("\n");
 }
 
 /* Registers a new block device with the given NAME.  If
    EXTRA_INFO is non-null, it is printed as part of a user
    message.  The block device's SIZE in sectors and its TYPE must
    be provided, as well as the it operation functions OPS, which
-   will be passed AUX in each function call. */
+   will be passed AUX in each function call.
+   Unless OPS has a submit operation, the device gets a
+   dispatcher of its own. */
 struct block *
 block_register (const char *name, enum block_type type,
                 const char *extra_info, block_sector_t size,
                 const struct block_operations *ops, void *aux)
+{
+  return block_register_dispatched (name, type, extra_info, size, ops, aux,
+                                    NULL);
+}
+
+/* Registers a new block device as block_register() does, except
+   that its requests are queued for dispatcher D, if D is
+   nonnull. */
+struct block *
+block_register_dispatched (const char *name, enum block_type type,
+                           const char *extra_info, block_sector_t size,
+                           const struct block_operations *ops, void *aux,
+                           struct block_dispatcher *d)
 {
   struct block *block = malloc (sizeof *block);
   if (block == NULL)
@@ -200,6 +791,26 @@ block_register (const char *name, enum block_type type,
   block->aux = aux;
   block->read_cnt = 0;
   block->write_cnt = 0;
+  lock_init (&block->user_lock);
+  block->user_bounce = NULL;
+
+  /* Devices with a submit operation need no queue. */
+  block->dispatcher = NULL;
+  if (ops->submit == NULL)
+    {
+      list_init (&block->sorted_queue);
+      list_init (&block->fifo_queue);
+      block->head = 0;
+      block->bounce = palloc_get_page (0);
+      memset (&block->stats, 0, sizeof block->stats);
+
+      if (d == NULL)
+        d = block_dispatcher_create (block->name);
+      lock_acquire (&d->lock);
+      list_push_back (&d->devices, &block->dispatch_elem);
+      lock_release (&d->lock);
+      block->dispatcher = d;
+    }
 
   printf ("%s: %'"PRDSNu" sectors (", block->name, block->size);
   print_human_readable_size ((uint64_t) block->size * BLOCK_SECTOR_SIZE);
@@ -1,8 +1,11 @@
 #ifndef DEVICES_BLOCK_H
 #define DEVICES_BLOCK_H
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <inttypes.h>
+#include <list.h>
+#include "threads/synch.h"
 
 /* Size of a block device sector in bytes.
    All IDE disks use this sector size, as do most USB and SCSI
@@ -21,6 +24,8 @@ typedef uint32_t block_sector_t;
 /* Higher-level interface for file systems, etc. */
 
 struct block;
+struct block_request;
+struct block_dispatcher;
 
 /* Type of a block device. */
 enum block_type
@@ -53,9 +58,51 @@ struct block *block_next (struct block *);
 block_sector_t block_size (struct block *);
 void block_read (struct block *, block_sector_t, void *);
 void block_write (struct block *, block_sector_t, const void *);
+void block_read_multiple (struct block *, block_sector_t, size_t cnt,
+                          void *);
+void block_write_multiple (struct block *, block_sector_t, size_t cnt,
+                           const void *);
 const char *block_name (struct block *);
 enum block_type block_type (struct block *);
 
+/* Asynchronous requests. */
+
+/* Called when REQ completes, in a block device's dispatch thread
+   or, for a device that carries out requests as they are
+   submitted, in the submitter's.  It must not sleep for long,
+   since the device dispatches no other request until it
+   returns. */
+typedef void block_callback_func (struct block_request *req, void *aux);
+
+/* A request to transfer CNT consecutive sectors between a block
+   device and BUFFER, which must be a kernel virtual address.
+   Fill in with block_request_init(), then pass to
+   block_submit().  The request must stay allocated, and BUFFER
+   untouched, until it completes. */
+struct block_request
+  {
+    bool write;                 /* Write to device, or read from it? */
+    block_sector_t sector;      /* First sector. */
+    size_t cnt;                 /* Number of sectors. */
+    void *buffer;               /* CNT * BLOCK_SECTOR_SIZE bytes. */
+    block_callback_func *callback;      /* Completion callback or null. */
+    void *aux;                  /* Passed to CALLBACK. */
+
+    /* Owned by the block layer. */
+    struct list_elem sort_elem; /* Element in queue sorted by sector. */
+    struct list_elem fifo_elem; /* Element in queue in arrival order. */
+    int64_t deadline;           /* Dispatch ahead of others after this. */
+    uint64_t submitted;         /* timer_cycles() at submission. */
+    struct semaphore done;      /* Up'd on completion if no CALLBACK. */
+  };
+
+void block_request_init (struct block_request *, bool write,
+                         block_sector_t, size_t cnt, void *buffer,
+                         block_callback_func *, void *aux);
+void block_submit (struct block *, struct block_request *);
+void block_wait (struct block_request *);
+void block_complete (struct block_request *);
+
 /* Statistics. */
 void block_print_stats (void);
 
@@ -65,10 +112,35 @@ struct block_operations
   {
     void (*read) (void *aux, block_sector_t, void *buffer);
     void (*write) (void *aux, block_sector_t, const void *buffer);
+
+    /* Optional.  Transfer CNT consecutive sectors at once.  If
+       null, the block layer calls read or write once per
+       sector instead. */
+    void (*read_multiple) (void *aux, block_sector_t, size_t cnt,
+                           void *buffer);
+    void (*write_multiple) (void *aux, block_sector_t, size_t cnt,
+                            const void *buffer);
+
+    /* Optional.  Prints driver-specific statistics. */
+    void (*print_stats) (void *aux);
+
+    /* Optional.  Passes REQ on to another device, after
+       adjusting it as needed, or carries it out at once and
+       calls block_complete(), instead of queuing it for this
+       one.  A device with this operation needs none of the
+       above. */
+    void (*submit) (void *aux, struct block_request *req);
   };
 
 struct block *block_register (const char *name, enum block_type,
                               const char *extra_info, block_sector_t size,
                               const struct block_operations *, void *aux);
+struct block *block_register_dispatched (const char *name, enum block_type,
+                                         const char *extra_info,
+                                         block_sector_t size,
+                                         const struct block_operations *,
+                                         void *aux,
+                                         struct block_dispatcher *);
+struct block_dispatcher *block_dispatcher_create (const char *name);
 
 #endif /* devices/block.h */
@@ -3,12 +3,16 @@
 #include <debug.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 #include "devices/block.h"
 #include "devices/partition.h"
+#include "devices/pci.h"
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
+#include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/vaddr.h"
 
 /* The code in this file is an interface to an ATA (IDE)
    controller.  It attempts to comply to [ATA-3]. */
@@ -30,10 +34,27 @@
 #define reg_ctl(CHANNEL) ((CHANNEL)->reg_base + 0x206)  /* Control (w/o). */
 #define reg_alt_status(CHANNEL) reg_ctl (CHANNEL)       /* Alt Status (r/o). */
 
+/* Bus master IDE port addresses, as found on the Intel PIIX
+   family of controllers.  A channel with bm_base 0 has no bus
+   master. */
+#define reg_bm_command(CHANNEL) ((CHANNEL)->bm_base + 0) /* Command. */
+#define reg_bm_status(CHANNEL) ((CHANNEL)->bm_base + 2)  /* Status. */
+#define reg_bm_prdt(CHANNEL) ((CHANNEL)->bm_base + 4)    /* PRD table. */
+
+/* Bus Master Command Register bits. */
+#define BM_START 0x01           /* Start transfer. */
+#define BM_READ 0x08            /* Transfer direction: 1=to memory. */
+
+/* Bus Master Status Register bits. */
+#define BM_ACTIVE 0x01          /* Transfer in progress. */
+#define BM_ERROR 0x02           /* Transfer failed. */
+#define BM_INTR 0x04            /* Disk raised its interrupt. */
+
 /* Alternate Status Register bits. */
 #define STA_BSY 0x80            /* Busy. */
 #define STA_DRDY 0x40           /* Device Ready. */
 #define STA_DRQ 0x08            /* Data Request. */
+#define STA_ERR 0x01            /* Error. */
 
 /* Control Register bits. */
 #define CTL_SRST 0x04           /* Software Reset. */
@@ -49,6 +70,36 @@
 #define CMD_IDENTIFY_DEVICE 0xec        /* IDENTIFY DEVICE. */
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
+#define CMD_READ_MULTIPLE 0xc4          /* READ MULTIPLE. */
+#define CMD_WRITE_MULTIPLE 0xc5         /* WRITE MULTIPLE. */
+#define CMD_SET_MULTIPLE_MODE 0xc6      /* SET MULTIPLE MODE. */
+#define CMD_READ_DMA 0xc8               /* READ DMA. */
+#define CMD_WRITE_DMA 0xca              /* WRITE DMA. */
+
+/* Most sectors a single READ or WRITE command can transfer. */
+#define MAX_COMMAND_SECTORS 256
+
+/* Most sectors per interrupt we ask for with SET MULTIPLE MODE. */
+#define MAX_MULTIPLE 16
+
+/* A physical region descriptor: one entry in the table that
+   tells a bus master where in memory to move a DMA transfer. */
+struct prd
+  {
+    uint32_t addr;              /* Physical address of region. */
+    uint16_t size;              /* Size in bytes, 0 meaning 64 kB. */
+    uint16_t flags;             /* PRD_EOT on the table's last entry. */
+  };
+
+#define PRD_EOT 0x8000          /* End of table. */
+#define PRD_BOUNDARY 0x10000    /* A region must not cross this. */
+
+/* Transfers of up to MAX_COMMAND_SECTORS sectors can straddle
+   this many PRD_BOUNDARYs, plus one. */
+#define PRD_CNT (MAX_COMMAND_SECTORS * BLOCK_SECTOR_SIZE / PRD_BOUNDARY + 1)
+
+/* -nodma: Use PIO even for disks that can do DMA? */
+bool ide_use_dma = true;
 
 /* An ATA device. */
 struct ata_disk
@@ -57,6 +108,15 @@ struct ata_disk
     struct channel *channel;    /* Channel that disk is attached to. */
     int dev_no;                 /* Device 0 or 1 for master or slave. */
     bool is_ata;                /* Is device an ATA disk? */
+    int multiple;               /* Sectors per interrupt for READ/WRITE
+                                   MULTIPLE, or 0 if not supported. */
+    bool dma;                   /* Transfer by bus master DMA? */
+
+    /* Statistics. */
+    unsigned long long dma_bytes;       /* Bytes moved by DMA. */
+    unsigned long long pio_bytes;       /* Bytes moved by PIO. */
+    unsigned long long dma_cycles;      /* CPU cycles spent on DMA. */
+    unsigned long long pio_cycles;      /* CPU cycles spent on PIO. */
   };
 
 /* An ATA channel (aka controller).
@@ -71,6 +131,15 @@ struct channel
     bool expecting_interrupt;   /* True if an interrupt is expected, false if
                                    any interrupt would be spurious. */
     struct semaphore completion_wait;   /* Up'd by interrupt handler. */
+    uint64_t asleep;            /* Cycles spent waiting for interrupts. */
+
+    uint16_t bm_base;           /* Bus master base I/O port, or 0. */
+    struct prd *prdt;           /* Bus master's PRD table. */
+
+    /* Dispatches requests for the disks on this channel, one
+       at a time, independently of the other channel.  Created
+       when the first disk is found. */
+    struct block_dispatcher *dispatcher;
 
     struct ata_disk devices[2];     /* The devices on this channel. */
   };
@@ -84,16 +153,27 @@ static struct block_operations ide_operations;
 static void reset_channel (struct channel *);
 static bool check_device_type (struct ata_disk *);
 static void identify_ata_device (struct ata_disk *);
-
-static void select_sector (struct ata_disk *, block_sector_t);
+static void set_multiple_mode (struct ata_disk *, int sectors);
+static uint16_t find_bus_master (void);
+
+static bool use_dma (const struct ata_disk *, const void *buffer);
+static bool dma_transfer (struct ata_disk *, block_sector_t, size_t cnt,
+                          void *buffer, bool read);
+static void pio_read (struct ata_disk *, block_sector_t, size_t cnt,
+                      void *buffer);
+static void pio_write (struct ata_disk *, block_sector_t, size_t cnt,
+                       const void *buffer);
+
+static void select_sector (struct ata_disk *, block_sector_t, size_t cnt);
 static void issue_pio_command (struct channel *, uint8_t command);
-static void input_sector (struct channel *, void *);
-static void output_sector (struct channel *, const void *);
+static void input_sectors (struct channel *, void *, size_t cnt);
+static void output_sectors (struct channel *, const void *, size_t cnt);
 
 static void wait_until_idle (const struct ata_disk *);
 static bool wait_while_busy (const struct ata_disk *);
 static void select_device (const struct ata_disk *);
 static void select_device_wait (const struct ata_disk *);
+static void wait_for_interrupt (struct channel *);
 
 static void interrupt_handler (struct intr_frame *);
 
@@ -102,6 +182,7 @@ void
 ide_init (void) 
 {
   size_t chan_no;
+  uint16_t bm_base = ide_use_dma ? find_bus_master () : 0;
 
   for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++)
     {
@@ -126,6 +207,18 @@ ide_init (void)
       lock_init (&c->lock);
       c->expecting_interrupt = false;
       sema_init (&c->completion_wait, 0);
+      c->asleep = 0;
+      c->dispatcher = NULL;
+
+      /* Each channel has 8 bus master ports and a PRD table. */
+      c->bm_base = 0;
+      c->prdt = NULL;
+      if (bm_base != 0)
+        {
+          c->prdt = palloc_get_page (0);
+          if (c->prdt != NULL)
+            c->bm_base = bm_base + chan_no * 8;
+        }
  
       /* Initialize devices. */
       for (dev_no = 0; dev_no < 2; dev_no++)
@@ -136,6 +229,10 @@ ide_init (void)
           d->channel = c;
           d->dev_no = dev_no;
           d->is_ata = false;
+          d->multiple = 0;
+          d->dma = false;
+          d->dma_bytes = d->pio_bytes = 0;
+          d->dma_cycles = d->pio_cycles = 0;
         }
 
       /* Register interrupt handler. */
@@ -262,6 +359,7 @@ identify_ata_device (struct ata_disk *d)
   struct channel *c = d->channel;
   char id[BLOCK_SECTOR_SIZE];
   block_sector_t capacity;
+  int max_multiple;
   char *model, *serial;
   char extra_info[128];
   struct block *block;
@@ -279,7 +377,7 @@ identify_ata_device (struct ata_disk *d)
       d->is_ata = false;
       return;
     }
-  input_sector (c, id);
+  input_sectors (c, id, 1);
 
   /* Calculate capacity.
      Read model name and serial number. */
@@ -303,12 +401,72 @@ identify_ata_device (struct ata_disk *d)
       return;
     }
 
+  /* Let the disk transfer several sectors per interrupt, if it
+     can.  The low byte of word 47 is the most it supports. */
+  max_multiple = (uint8_t) id[47 * 2];
+  if (max_multiple > 0)
+    set_multiple_mode (d, max_multiple < MAX_MULTIPLE
+                          ? max_multiple : MAX_MULTIPLE);
+
+  /* Use DMA if the channel has a bus master and the disk
+     supports DMA, as bit 8 of word 49 says. */
+  d->dma = c->bm_base != 0 && (id[49 * 2 + 1] & 0x01) != 0;
+  if (d->dma)
+    strlcat (extra_info, ", DMA", sizeof extra_info);
+
   /* Register. */
-  block = block_register (d->name, BLOCK_RAW, extra_info, capacity,
-                          &ide_operations, d);
+  if (c->dispatcher == NULL)
+    c->dispatcher = block_dispatcher_create (c->name);
+  block = block_register_dispatched (d->name, BLOCK_RAW, extra_info,
+                                     capacity, &ide_operations, d,
+                                     c->dispatcher);
   partition_scan (block);
 }
 
+/* Asks disk D to transfer SECTORS sectors per interrupt under
+   READ MULTIPLE and WRITE MULTIPLE, and records the setting in D
+   if the disk accepts it. */
+static void
+set_multiple_mode (struct ata_disk *d, int sectors)
+{
+  struct channel *c = d->channel;
+
+  select_device_wait (d);
+  outb (reg_nsect (c), sectors);
+  issue_pio_command (c, CMD_SET_MULTIPLE_MODE);
+  sema_down (&c->completion_wait);
+  wait_while_busy (d);
+  if ((inb (reg_status (c)) & STA_ERR) == 0)
+    d->multiple = sectors;
+}
+
+/* Looks for a PCI IDE controller that can act as bus master
+   and enables it to do so.  Returns the I/O port base of its bus
+   master registers, or 0 if there is none. */
+static uint16_t
+find_bus_master (void)
+{
+  struct pci_dev pci;
+  uint32_t bar4;
+
+  if (!pci_find_class (0x01, 0x01, &pci))
+    return 0;
+
+  /* Bit 7 of the programming interface says the controller can
+     be a bus master.  Base address register 4 must then point to
+     its registers in I/O space. */
+  if ((pci_read_config (&pci, PCI_REG_CLASS) & 0x8000) == 0)
+    return 0;
+  bar4 = pci_read_config (&pci, PCI_REG_BAR0 + 4 * 4);
+  if ((bar4 & 1) == 0 || (bar4 & 0xfffc) == 0)
+    return 0;
+
+  pci_write_config (&pci, PCI_REG_COMMAND,
+                    (pci_read_config (&pci, PCI_REG_COMMAND) & 0xffff)
+                    | PCI_CMD_IO | PCI_CMD_MASTER);
+  return bar4 & 0xfffc;
+}
+
 /* Translates STRING, which consists of SIZE bytes in a funky
    format, into a null-terminated string in-place.  Drops
    trailing whitespace and null bytes.  Returns STRING.  */
@@ -337,25 +495,71 @@ descramble_ata_string (char *string, int size)
   return string;
 }
 
-/* Reads sector SEC_NO from disk D into BUFFER, which must have
-   room for BLOCK_SECTOR_SIZE bytes.
+/* Reads the CNT sectors starting at SEC_NO from disk D into
+   BUFFER, which must have room for CNT * BLOCK_SECTOR_SIZE bytes.
+   Issues one command per MAX_COMMAND_SECTORS sectors, by DMA if
+   the disk supports it and otherwise by PIO.
    Internally synchronizes accesses to disks, so external
    per-disk locking is unneeded. */
 static void
-ide_read (void *d_, block_sector_t sec_no, void *buffer)
+ide_read_multiple (void *d_, block_sector_t sec_no, size_t cnt, void *buffer)
 {
   struct ata_disk *d = d_;
   struct channel *c = d->channel;
-  lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-  sema_down (&c->completion_wait);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
-  input_sector (c, buffer);
+  uint8_t *p = buffer;
+
+  lock_acquire (&d->channel->lock);
+  while (cnt > 0)
+    {
+      size_t n = cnt < MAX_COMMAND_SECTORS ? cnt : MAX_COMMAND_SECTORS;
+
+      if (!use_dma (d, p) || !dma_transfer (d, sec_no, n, p, true))
+        pio_read (d, sec_no, n, p);
+      p += n * BLOCK_SECTOR_SIZE;
+      sec_no += n;
+      cnt -= n;
+    }
+  lock_release (&c->lock);
+}
+
+/* Writes the CNT sectors starting at SEC_NO to disk D from
+   BUFFER, which must contain CNT * BLOCK_SECTOR_SIZE bytes.
+   Returns after the disk has acknowledged receiving the data.
+   Chooses between DMA and PIO as ide_read_multiple() does.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+static void
+ide_write_multiple (void *d_, block_sector_t sec_no, size_t cnt,
+                    const void *buffer)
+{
+  struct ata_disk *d = d_;
+  struct channel *c = d->channel;
+  const uint8_t *p = buffer;
+
+  lock_acquire (&d->channel->lock);
+  while (cnt > 0)
+    {
+      size_t n = cnt < MAX_COMMAND_SECTORS ? cnt : MAX_COMMAND_SECTORS;
+
+      if (!use_dma (d, p) || !dma_transfer (d, sec_no, n, (void *) p, false))
+        pio_write (d, sec_no, n, p);
+      p += n * BLOCK_SECTOR_SIZE;
+      sec_no += n;
+      cnt -= n;
+    }
   lock_release (&c->lock);
 }
 
+/* Reads sector SEC_NO from disk D into BUFFER, which must have
+   room for BLOCK_SECTOR_SIZE bytes.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+static void
+ide_read (void *d_, block_sector_t sec_no, void *buffer)
+{
+  ide_read_multiple (d_, sec_no, 1, buffer);
+}
+
 /* Write sector SEC_NO to disk D from BUFFER, which must contain
    BLOCK_SECTOR_SIZE bytes.  Returns after the disk has
    acknowledged receiving the data.
@@ -363,37 +567,201 @@ ide_read (void *d_, block_sector_t sec_no, void *buffer)
    per-disk locking is unneeded. */
 static void
 ide_write (void *d_, block_sector_t sec_no, const void *buffer)
+{
+  ide_write_multiple (d_, sec_no, 1, buffer);
+}
+
+/* Prints how many bytes disk D has moved by DMA and by PIO, and
+   how much CPU time each took, not counting time spent asleep
+   waiting for interrupts.  The block layer reports how long
+   requests waited in the channel's queue. */
+static void
+ide_print_stats (void *d_)
 {
   struct ata_disk *d = d_;
-  struct channel *c = d->channel;
-  lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
-  output_sector (c, buffer);
-  sema_down (&c->completion_wait);
-  lock_release (&c->lock);
+
+  printf ("%s: %llu bytes by DMA in %llu kcycles, "
+          "%llu bytes by PIO in %llu kcycles\n",
+          d->name, d->dma_bytes, d->dma_cycles / 1000,
+          d->pio_bytes, d->pio_cycles / 1000);
 }
 
 static struct block_operations ide_operations =
   {
     ide_read,
-    ide_write
+    ide_write,
+    ide_read_multiple,
+    ide_write_multiple,
+    ide_print_stats,
+    NULL
   };
 
+/* Bus master DMA. */
+
+/* Returns true if a transfer between disk D and BUFFER should
+   use DMA.  The bus master needs a physical address, which we
+   can only compute for kernel virtual addresses, so user buffers
+   always go by PIO. */
+static bool
+use_dma (const struct ata_disk *d, const void *buffer)
+{
+  return d->dma && is_kernel_vaddr (buffer);
+}
+
+/* Fills in channel C's PRD table to describe the SIZE bytes at
+   kernel virtual address BUFFER, splitting it wherever a region
+   would cross a PRD_BOUNDARY or a page with a discontiguous
+   physical address would follow. */
+static void
+setup_prdt (struct channel *c, void *buffer, size_t size)
+{
+  uint8_t *p = buffer;
+  struct prd *prd = c->prdt;
+
+  for (;;)
+    {
+      uintptr_t addr = vtop (p);
+      size_t n = PRD_BOUNDARY - addr % PRD_BOUNDARY;
+      if (n > size)
+        n = size;
+
+      ASSERT (prd < c->prdt + PRD_CNT);
+      prd->addr = addr;
+      prd->size = n % PRD_BOUNDARY;
+      prd->flags = 0;
+      p += n;
+      size -= n;
+      if (size == 0)
+        break;
+      prd++;
+    }
+  prd->flags = PRD_EOT;
+}
+
+/* Transfers the CNT sectors starting at SEC_NO between disk D and
+   BUFFER by bus master DMA: into BUFFER if READ, otherwise out of
+   it.  CNT must be between 1 and MAX_COMMAND_SECTORS, BUFFER must
+   be a kernel virtual address, and the caller must hold D's
+   channel lock.
+   Returns true if successful.  On failure, turns off DMA for D,
+   so that the caller and later requests fall back to PIO. */
+static bool
+dma_transfer (struct ata_disk *d, block_sector_t sec_no, size_t cnt,
+              void *buffer, bool read)
+{
+  struct channel *c = d->channel;
+  uint8_t direction = read ? BM_READ : 0;
+  uint8_t bm_status, status;
+  uint64_t start = timer_cycles ();
+
+  c->asleep = 0;
+  setup_prdt (c, buffer, cnt * BLOCK_SECTOR_SIZE);
+  outl (reg_bm_prdt (c), vtop (c->prdt));
+  outb (reg_bm_status (c), BM_ERROR | BM_INTR);   /* Write 1s to clear. */
+  outb (reg_bm_command (c), direction);
+
+  select_sector (d, sec_no, cnt);
+  issue_pio_command (c, read ? CMD_READ_DMA : CMD_WRITE_DMA);
+  outb (reg_bm_command (c), direction | BM_START);
+  wait_for_interrupt (c);
+  outb (reg_bm_command (c), direction);
+
+  bm_status = inb (reg_bm_status (c));
+  outb (reg_bm_status (c), BM_ERROR | BM_INTR);
+  status = inb (reg_status (c));
+  d->dma_cycles += timer_cycles () - start - c->asleep;
+  if ((bm_status & BM_ERROR) || (status & (STA_ERR | STA_BSY)))
+    {
+      printf ("%s: DMA %s failed, sector=%"PRDSNu"; using PIO\n",
+              d->name, read ? "read" : "write", sec_no);
+      d->dma = false;
+      return false;
+    }
+  d->dma_bytes += cnt * BLOCK_SECTOR_SIZE;
+  return true;
+}
+
+/* Programmed I/O. */
+
+/* Reads the CNT sectors starting at SEC_NO from disk D into
+   BUFFER by PIO, with one command.  CNT must be between 1 and
+   MAX_COMMAND_SECTORS, and the caller must hold D's channel lock.
+   Takes one interrupt per D->multiple sectors if the disk
+   supports READ MULTIPLE, otherwise one per sector. */
+static void
+pio_read (struct ata_disk *d, block_sector_t sec_no, size_t cnt,
+          void *buffer)
+{
+  struct channel *c = d->channel;
+  size_t per_intr = d->multiple > 0 ? (size_t) d->multiple : 1;
+  uint8_t *p = buffer;
+  uint64_t start = timer_cycles ();
+  size_t i;
+
+  c->asleep = 0;
+  select_sector (d, sec_no, cnt);
+  issue_pio_command (c, d->multiple > 0
+                        ? CMD_READ_MULTIPLE : CMD_READ_SECTOR_RETRY);
+  for (i = 0; i < cnt; i += per_intr)
+    {
+      size_t m = cnt - i < per_intr ? cnt - i : per_intr;
+
+      wait_for_interrupt (c);
+      if (!wait_while_busy (d))
+        PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no + i);
+      input_sectors (c, p, m);
+      p += m * BLOCK_SECTOR_SIZE;
+    }
+  d->pio_cycles += timer_cycles () - start - c->asleep;
+  d->pio_bytes += cnt * BLOCK_SECTOR_SIZE;
+}
+
+/* Writes the CNT sectors starting at SEC_NO to disk D from
+   BUFFER by PIO, with one command, under the same conditions as
+   pio_read(). */
+static void
+pio_write (struct ata_disk *d, block_sector_t sec_no, size_t cnt,
+           const void *buffer)
+{
+  struct channel *c = d->channel;
+  size_t per_intr = d->multiple > 0 ? (size_t) d->multiple : 1;
+  const uint8_t *p = buffer;
+  uint64_t start = timer_cycles ();
+  size_t i;
+
+  c->asleep = 0;
+  select_sector (d, sec_no, cnt);
+  issue_pio_command (c, d->multiple > 0
+                        ? CMD_WRITE_MULTIPLE : CMD_WRITE_SECTOR_RETRY);
+  for (i = 0; i < cnt; i += per_intr)
+    {
+      size_t m = cnt - i < per_intr ? cnt - i : per_intr;
+
+      if (!wait_while_busy (d))
+        PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no + i);
+      output_sectors (c, p, m);
+      p += m * BLOCK_SECTOR_SIZE;
+      wait_for_interrupt (c);
+    }
+  d->pio_cycles += timer_cycles () - start - c->asleep;
+  d->pio_bytes += cnt * BLOCK_SECTOR_SIZE;
+}
+
+
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+   writes SEC_NO and the number of sectors CNT to transfer, which
+   must be between 1 and MAX_COMMAND_SECTORS, to the disk's sector
+   selection registers.  (We use LBA mode.) */
 static void
-select_sector (struct ata_disk *d, block_sector_t sec_no)
+select_sector (struct ata_disk *d, block_sector_t sec_no, size_t cnt)
 {
   struct channel *c = d->channel;
 
   ASSERT (sec_no < (1UL << 28));
+  ASSERT (cnt >= 1 && cnt <= MAX_COMMAND_SECTORS);
   
   select_device_wait (d);
-  outb (reg_nsect (c), 1);
+  outb (reg_nsect (c), cnt == MAX_COMMAND_SECTORS ? 0 : cnt);
   outb (reg_lbal (c), sec_no);
   outb (reg_lbam (c), sec_no >> 8);
   outb (reg_lbah (c), (sec_no >> 16));
@@ -414,20 +782,21 @@ issue_pio_command (struct channel *c, uint8_t command)
   outb (reg_command (c), command);
 }
 
-/* Reads a sector from channel C's data register in PIO mode into
-   SECTOR, which must have room for BLOCK_SECTOR_SIZE bytes. */
+/* Reads CNT sectors from channel C's data register in PIO mode
+   into SECTORS, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes. */
 static void
-input_sector (struct channel *c, void *sector) 
+input_sectors (struct channel *c, void *sectors, size_t cnt) 
 {
-  insw (reg_data (c), sector, BLOCK_SECTOR_SIZE / 2);
+  insw (reg_data (c), sectors, cnt * BLOCK_SECTOR_SIZE / 2);
 }
 
-/* Writes SECTOR to channel C's data register in PIO mode.
-   SECTOR must contain BLOCK_SECTOR_SIZE bytes. */
+/* Writes CNT sectors from SECTORS to channel C's data register in
+   PIO mode.  SECTORS must contain CNT * BLOCK_SECTOR_SIZE bytes. */
 static void
-output_sector (struct channel *c, const void *sector) 
+output_sectors (struct channel *c, const void *sectors, size_t cnt) 
 {
-  outsw (reg_data (c), sector, BLOCK_SECTOR_SIZE / 2);
+  outsw (reg_data (c), sectors, cnt * BLOCK_SECTOR_SIZE / 2);
 }
 
 /* Low-level ATA primitives. */
@@ -501,6 +870,17 @@ select_device_wait (const struct ata_disk *d)
   select_device (d);
   wait_until_idle (d);
 }
+
+/* Sleeps until channel C's completion interrupt arrives, adding
+   the time spent asleep to C->asleep so that it can be left out
+   of the driver's CPU time. */
+static void
+wait_for_interrupt (struct channel *c)
+{
+  uint64_t start = timer_cycles ();
+  sema_down (&c->completion_wait);
+  c->asleep += timer_cycles () - start;
+}
 
 /* ATA interrupt handler. */
 static void
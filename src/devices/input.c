@@ -6,6 +6,16 @@
 /* Stores keys from the keyboard and serial port. */
 static struct intq buffer;
 
+/* Line-editing keys for input_read(). */
+#define ERASE_KEY '\b'                 /* Erases the last key. */
+#define DELETE_KEY '\177'              /* Same, as many terminals send. */
+#define KILL_KEY ('U' - 'A' + 1)        /* Ctrl+U: erases the line. */
+
+/* True if the last line input_read() returned ended in a carriage
+   return, so that a new-line right after it belongs to the same
+   CRLF terminator instead of being a line of its own. */
+static bool skip_lf;
+
 /* Initializes the input buffer. */
 void
 input_init (void) 
@@ -41,6 +51,62 @@ input_getc (void)
   return key;
 }
 
+/* Reads up to N keys from the input buffer into DST and returns
+   the number read.  Takes keys that are already buffered all in
+   one go, and waits for more only while it has neither reached
+   the end of a line (a new-line or carriage return, which is
+   included) nor read N keys.  A carriage return followed by a
+   new-line ends just one line, so the new-line is dropped.
+
+   Backspace or delete erases the last key read and Ctrl+U all of
+   them.  With nothing to erase, these keys are read like any
+   other, so that programs that read a key at a time can do their
+   own editing.  DST must not page fault. */
+size_t
+input_read (void *dst_, size_t n) 
+{
+  uint8_t *dst = dst_;
+  enum intr_level old_level;
+  size_t i = 0;
+
+  old_level = intr_disable ();
+  while (i < n) 
+    {
+      uint8_t key;
+
+      /* The serial port stops receiving while the buffer is
+         full, so let it resume before we wait. */
+      if (intq_empty (&buffer))
+        serial_notify ();
+
+      key = intq_getc (&buffer);
+      if (skip_lf) 
+        {
+          skip_lf = false;
+          if (key == '\n')
+            continue;
+        }
+
+      if ((key == ERASE_KEY || key == DELETE_KEY) && i > 0)
+        i--;
+      else if (key == KILL_KEY && i > 0)
+        i = 0;
+      else 
+        {
+          dst[i++] = key;
+          if (key == '\n' || key == '\r') 
+            {
+              skip_lf = key == '\r';
+              break;
+            }
+        }
+    }
+  serial_notify ();
+  intr_set_level (old_level);
+
+  return i;
+}
+
 /* Returns true if the input buffer is full,
    false otherwise.
    Interrupts must be off. */
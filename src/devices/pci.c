@@ -0,0 +1,88 @@
+#include "devices/pci.h"
+#include <debug.h>
+#include "threads/io.h"
+
+/* Minimal access to PCI configuration space, through
+   configuration mechanism #1, which every PC chipset that QEMU
+   and Bochs emulate provides.  Only bus 0 is scanned, which is
+   where all of their devices are. */
+
+/* Configuration mechanism #1 I/O ports. */
+#define CONFIG_ADDRESS 0xcf8
+#define CONFIG_DATA 0xcfc
+
+/* Number of devices per bus and functions per device. */
+#define DEV_CNT 32
+#define FUNC_CNT 8
+
+/* Selects register REG of D for the next access to CONFIG_DATA. */
+static void
+select_reg (const struct pci_dev *d, uint8_t reg)
+{
+  ASSERT (reg % 4 == 0);
+  outl (CONFIG_ADDRESS, (0x80000000u | (d->bus << 16) | (d->dev << 11)
+                         | (d->func << 8) | reg));
+}
+
+/* Returns the 32-bit configuration register REG of D. */
+uint32_t
+pci_read_config (const struct pci_dev *d, uint8_t reg)
+{
+  select_reg (d, reg);
+  return inl (CONFIG_DATA);
+}
+
+/* Sets the 32-bit configuration register REG of D to VALUE. */
+void
+pci_write_config (const struct pci_dev *d, uint8_t reg, uint32_t value)
+{
+  select_reg (d, reg);
+  outl (CONFIG_DATA, value);
+}
+
+/* Searches bus 0 for the IDX'th function, counting from 0, whose
+   configuration register REG has VALUE in the bits set in MASK.
+   If one is found, stores its location in *D and returns true;
+   otherwise, returns false. */
+static bool
+find (uint8_t reg, uint32_t mask, uint32_t value, int idx,
+      struct pci_dev *d)
+{
+  d->bus = 0;
+  for (d->dev = 0; d->dev < DEV_CNT; d->dev++)
+    for (d->func = 0; d->func < FUNC_CNT; d->func++)
+      {
+        if ((pci_read_config (d, PCI_REG_ID) & 0xffff) == 0xffff)
+          {
+            /* No function here.  If function 0 is absent, so is
+               the whole device. */
+            if (d->func == 0)
+              break;
+            continue;
+          }
+
+        if ((pci_read_config (d, reg) & mask) == value && idx-- == 0)
+          return true;
+      }
+  return false;
+}
+
+/* Searches bus 0 for a function with the given CLASS and
+   SUBCLASS codes.  If one is found, stores its location in *D
+   and returns true; otherwise, returns false. */
+bool
+pci_find_class (uint8_t class, uint8_t subclass, struct pci_dev *d)
+{
+  return find (PCI_REG_CLASS, 0xffff0000,
+               ((uint32_t) class << 24) | ((uint32_t) subclass << 16), 0, d);
+}
+
+/* Searches bus 0 for the IDX'th function, counting from 0, with
+   the given VENDOR and DEVICE IDs.  If one is found, stores its
+   location in *D and returns true; otherwise, returns false. */
+bool
+pci_find_id (uint16_t vendor, uint16_t device, int idx, struct pci_dev *d)
+{
+  return find (PCI_REG_ID, 0xffffffff,
+               ((uint32_t) device << 16) | vendor, idx, d);
+}
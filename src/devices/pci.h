@@ -0,0 +1,33 @@
+#ifndef DEVICES_PCI_H
+#define DEVICES_PCI_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Location of a PCI function. */
+struct pci_dev
+  {
+    uint8_t bus;                /* Bus number. */
+    uint8_t dev;                /* Device number on the bus. */
+    uint8_t func;               /* Function number within the device. */
+  };
+
+/* Standard configuration space registers. */
+#define PCI_REG_ID 0x00         /* Vendor ID (15:0), device ID (31:16). */
+#define PCI_REG_COMMAND 0x04    /* Command (15:0), status (31:16). */
+#define PCI_REG_CLASS 0x08      /* Revision (7:0), class code (31:8). */
+#define PCI_REG_BAR0 0x10       /* First of six base address registers. */
+#define PCI_REG_INTR 0x3c       /* Interrupt line (7:0). */
+
+/* Command register bits. */
+#define PCI_CMD_IO 0x0001       /* Respond to I/O space accesses. */
+#define PCI_CMD_MEMORY 0x0002   /* Respond to memory space accesses. */
+#define PCI_CMD_MASTER 0x0004   /* May act as bus master. */
+
+uint32_t pci_read_config (const struct pci_dev *, uint8_t reg);
+void pci_write_config (const struct pci_dev *, uint8_t reg, uint32_t);
+bool pci_find_class (uint8_t class, uint8_t subclass, struct pci_dev *);
+bool pci_find_id (uint16_t vendor, uint16_t device, int idx,
+                  struct pci_dev *);
+
+#endif /* devices/pci.h */
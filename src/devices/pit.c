@@ -11,9 +11,6 @@
 #define PIT_PORT_CONTROL          0x43                /* Control port. */
 #define PIT_PORT_COUNTER(CHANNEL) (0x40 + (CHANNEL))  /* Counter port. */
 
-/* PIT cycles per second. */
-#define PIT_HZ 1193180
-
 /* Configure the given CHANNEL in the PIT.  In a PC, the PIT's
    three output channels are hooked up like this:
 
@@ -81,3 +78,74 @@ pit_configure_channel (int channel, int mode, int frequency)
   outb (PIT_PORT_COUNTER (channel), count >> 8);
   intr_set_level (old_level);
 }
+
+/* Starts the given CHANNEL counting down COUNT PIT cycles, where
+   1 <= COUNT <= 65536, in mode 0 ("interrupt on terminal
+   count"): its output rises once, when the count runs out, and
+   then stays high.  For channel 0, that raises a single timer
+   interrupt.  Use pit_configure_channel() to go back to a
+   periodic mode. */
+void
+pit_start_oneshot (int channel, unsigned count)
+{
+  enum intr_level old_level;
+
+  ASSERT (channel == 0 || channel == 2);
+  ASSERT (count >= 1 && count <= 65536);
+
+  /* A count of 0 stands for 65536, which conveniently is what
+     the truncation to 16 bits below produces. */
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, (channel << 6) | 0x30);
+  outb (PIT_PORT_COUNTER (channel), count);
+  outb (PIT_PORT_COUNTER (channel), count >> 8);
+  intr_set_level (old_level);
+}
+
+/* Returns the current value of the given CHANNEL's counter, that
+   is, the number of PIT cycles left in its count. */
+unsigned
+pit_read_count (int channel)
+{
+  enum intr_level old_level;
+  uint8_t lo, hi;
+
+  ASSERT (channel == 0 || channel == 2);
+
+  /* Latch the counter so that the two bytes are consistent. */
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, channel << 6);
+  lo = inb (PIT_PORT_COUNTER (channel));
+  hi = inb (PIT_PORT_COUNTER (channel));
+  intr_set_level (old_level);
+
+  return lo | (hi << 8);
+}
+
+/* Latches the given CHANNEL's status and counter together, with
+   the 8254 read-back command, so that neither can change between
+   the two.  Stores the number of PIT cycles left in its count in
+   *COUNT and returns the level of the channel's output.  In mode
+   0 the output goes high when the count runs out, after which
+   the counter wraps around and keeps counting down, so that the
+   count alone cannot tell whether it has run out. */
+bool
+pit_read_back (int channel, unsigned *count)
+{
+  enum intr_level old_level;
+  uint8_t status, lo, hi;
+
+  ASSERT (channel == 0 || channel == 2);
+
+  /* Read-back of one channel's status and count.  The status
+     byte comes out first, then the count as usual. */
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, 0xc0 | (2 << channel));
+  status = inb (PIT_PORT_COUNTER (channel));
+  lo = inb (PIT_PORT_COUNTER (channel));
+  hi = inb (PIT_PORT_COUNTER (channel));
+  intr_set_level (old_level);
+
+  *count = lo | (hi << 8);
+  return (status & 0x80) != 0;
+}
@@ -0,0 +1,123 @@
+#include "devices/ramdisk.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* A RAM disk: a block device whose contents live in pages taken
+   from the kernel pool.  The pages need not be contiguous, so
+   that even a large RAM disk can be carved out of a fragmented
+   pool. */
+struct ramdisk
+  {
+    size_t page_cnt;            /* Number of pages. */
+    uint8_t **pages;            /* The pages themselves. */
+  };
+
+/* Number of sectors in a page. */
+#define SECTORS_PER_PAGE (PGSIZE / BLOCK_SECTOR_SIZE)
+
+static struct block_operations ramdisk_operations;
+
+/* Creates and registers a RAM disk named NAME of the given TYPE,
+   with room for at least SIZE bytes, all initially zero.
+   Returns the new block device, or a null pointer if it would
+   take more than half of the kernel pool's free pages, which the
+   rest of the kernel needs. */
+struct block *
+ramdisk_create (const char *name, enum block_type type, size_t size)
+{
+  size_t page_cnt = size / PGSIZE + (size % PGSIZE != 0);
+  struct ramdisk *rd;
+  char extra_info[32];
+  size_t i;
+
+  if (page_cnt > palloc_free_cnt (0) / 2)
+    {
+      printf ("%s: %zu kB is more than half of the %zu kB free "
+              "in the kernel pool\n", name, size / 1024,
+              palloc_free_cnt (0) * PGSIZE / 1024);
+      return NULL;
+    }
+
+  rd = malloc (sizeof *rd);
+  if (rd == NULL)
+    return NULL;
+  rd->page_cnt = page_cnt;
+  rd->pages = calloc (rd->page_cnt, sizeof *rd->pages);
+  if (rd->pages == NULL)
+    {
+      free (rd);
+      return NULL;
+    }
+
+  for (i = 0; i < rd->page_cnt; i++)
+    {
+      rd->pages[i] = palloc_get_page (PAL_ZERO);
+      if (rd->pages[i] == NULL)
+        {
+          printf ("%s: out of kernel pages after %zu kB\n",
+                  name, i * PGSIZE / 1024);
+          while (i-- > 0)
+            palloc_free_page (rd->pages[i]);
+          free (rd->pages);
+          free (rd);
+          return NULL;
+        }
+    }
+
+  snprintf (extra_info, sizeof extra_info, "RAM disk, %zu pages",
+            rd->page_cnt);
+  return block_register (name, type, extra_info,
+                         rd->page_cnt * SECTORS_PER_PAGE,
+                         &ramdisk_operations, rd);
+}
+
+/* Copies between the CNT sectors starting at SECTOR on RAM disk
+   RD and BUFFER: into BUFFER if TO_BUFFER, otherwise out of it.
+   The block layer has already checked that the sectors exist. */
+static void
+ramdisk_copy (struct ramdisk *rd, block_sector_t sector, size_t cnt,
+              uint8_t *buffer, bool to_buffer)
+{
+  while (cnt > 0)
+    {
+      size_t ofs = sector % SECTORS_PER_PAGE;
+      size_t n = SECTORS_PER_PAGE - ofs;
+      uint8_t *p;
+
+      if (n > cnt)
+        n = cnt;
+      p = rd->pages[sector / SECTORS_PER_PAGE] + ofs * BLOCK_SECTOR_SIZE;
+      if (to_buffer)
+        memcpy (buffer, p, n * BLOCK_SECTOR_SIZE);
+      else
+        memcpy (p, buffer, n * BLOCK_SECTOR_SIZE);
+      buffer += n * BLOCK_SECTOR_SIZE;
+      sector += n;
+      cnt -= n;
+    }
+}
+
+/* Carries out REQ on RAM disk RD at once, in the caller's
+   thread.  A RAM disk has no seeks for the elevator to save, so
+   queuing its requests for a dispatch thread would only add two
+   context switches to each. */
+static void
+ramdisk_submit (void *rd, struct block_request *req)
+{
+  ramdisk_copy (rd, req->sector, req->cnt, req->buffer, !req->write);
+  block_complete (req);
+}
+
+static struct block_operations ramdisk_operations =
+  {
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    ramdisk_submit
+  };
@@ -0,0 +1,9 @@
+#ifndef DEVICES_RAMDISK_H
+#define DEVICES_RAMDISK_H
+
+#include <stddef.h>
+#include "devices/block.h"
+
+struct block *ramdisk_create (const char *name, enum block_type, size_t size);
+
+#endif /* devices/ramdisk.h */
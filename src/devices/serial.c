@@ -1,7 +1,7 @@
 #include "devices/serial.h"
 #include <debug.h>
+#include <string.h>
 #include "devices/input.h"
-#include "devices/intq.h"
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
@@ -33,6 +33,14 @@
 #define MCR_REG (IO_BASE + 4)   /* MODEM Control Register. */
 #define LSR_REG (IO_BASE + 5)   /* Line Status Register (read-only). */
 
+/* FIFO Control Register bits. */
+#define FCR_ENABLE 0x01         /* Enable both FIFOs. */
+#define FCR_CLEAR_RECV 0x02     /* Clear receive FIFO. */
+#define FCR_CLEAR_XMIT 0x04     /* Clear transmit FIFO. */
+
+/* Interrupt Identification Register bits. */
+#define IIR_FIFO 0xc0           /* Both set if FIFOs are enabled. */
+
 /* Interrupt Enable Register bits. */
 #define IER_RECV 0x01           /* Interrupt when data received. */
 #define IER_XMIT 0x02           /* Interrupt when transmit finishes. */
@@ -46,16 +54,39 @@
 
 /* Line Status Register. */
 #define LSR_DR 0x01             /* Data Ready: received data byte is in RBR. */
-#define LSR_THRE 0x20           /* THR Empty. */
+#define LSR_THRE 0x20           /* THR Empty (with FIFO: FIFO empty). */
 
+/* Size of the 16550A's transmit FIFO. */
+#define XMIT_FIFO_SIZE 16
+
+/* Size of the transmit ring, in bytes.  Must be a power of 2.
+   Output that fits goes out in the background, so a burst of
+   console output only stalls the kernel once the ring fills. */
+#ifndef SERIAL_TXBUF_SIZE
+#define SERIAL_TXBUF_SIZE 8192
+#endif
+
 /* Transmission mode. */
 static enum { UNINIT, POLL, QUEUE } mode;
 
-/* Data to be transmitted. */
-static struct intq txq;
+/* Transmit ring.  TX_HEAD and TX_TAIL count bytes ever put into
+   and taken out of it, so TX_HEAD - TX_TAIL bytes are waiting,
+   at index TX_TAIL % SERIAL_TXBUF_SIZE onward. */
+static uint8_t txbuf[SERIAL_TXBUF_SIZE];
+static size_t tx_head, tx_tail;
+
+/* Bytes we may write to THR each time it is empty: the FIFO
+   size if the UART has a working FIFO, otherwise 1. */
+static size_t xmit_burst;
+
+/* Threads waiting for room in the transmit ring. */
+static int tx_waiters;
+static struct semaphore tx_room;
 
 static void set_serial (int bps);
 static void putc_poll (uint8_t);
+static void fill_fifo (void);
+static void drain_poll (void);
 static void write_ier (void);
 static intr_handler_func serial_interrupt;
 
@@ -68,10 +99,17 @@ init_poll (void)
 {
   ASSERT (mode == UNINIT);
   outb (IER_REG, 0);                    /* Turn off all interrupts. */
-  outb (FCR_REG, 0);                    /* Disable FIFO. */
+  outb (FCR_REG, FCR_ENABLE | FCR_CLEAR_RECV | FCR_CLEAR_XMIT);
+  if ((inb (IIR_REG) & IIR_FIFO) == IIR_FIFO)
+    xmit_burst = XMIT_FIFO_SIZE;
+  else
+    {
+      outb (FCR_REG, 0);                /* No working FIFO: disable. */
+      xmit_burst = 1;
+    }
   set_serial (9600);                    /* 9.6 kbps, N-8-1. */
   outb (MCR_REG, MCR_OUT2);             /* Required to enable interrupts. */
-  intq_init (&txq);
+  sema_init (&tx_room, 0);
   mode = POLL;
 } 
 
@@ -98,34 +136,64 @@ serial_init_queue (void)
 void
 serial_putc (uint8_t byte) 
 {
+  serial_write (&byte, 1);
+}
+
+/* Sends the N bytes in BUFFER to the serial port.  Copies as much
+   as fits into the transmit ring at a time and returns once all
+   of it has been queued.  If the ring is full, waits for the
+   interrupt handler to make room, or, if interrupts are off,
+   sends bytes by polling instead. */
+void
+serial_write (const void *buffer, size_t n)
+{
+  const uint8_t *p = buffer;
   enum intr_level old_level = intr_disable ();
 
   if (mode != QUEUE)
     {
       /* If we're not set up for interrupt-driven I/O yet,
-         use dumb polling to transmit a byte. */
+         use dumb polling to transmit. */
       if (mode == UNINIT)
         init_poll ();
-      putc_poll (byte); 
+      while (n-- > 0)
+        putc_poll (*p++);
     }
-  else 
-    {
-      /* Otherwise, queue a byte and update the interrupt enable
-         register. */
-      if (old_level == INTR_OFF && intq_full (&txq)) 
-        {
-          /* Interrupts are off and the transmit queue is full.
-             If we wanted to wait for the queue to empty,
-             we'd have to reenable interrupts.
-             That's impolite, so we'll send a character via
-             polling instead. */
-          putc_poll (intq_getc (&txq)); 
-        }
-
-      intq_putc (&txq, byte); 
-      write_ier ();
-    }
-  
+  else
+    while (n > 0)
+      {
+        size_t room = SERIAL_TXBUF_SIZE - (tx_head - tx_tail);
+        size_t ofs = tx_head % SERIAL_TXBUF_SIZE;
+        size_t chunk;
+
+        if (room == 0)
+          {
+            /* Waiting would require reenabling interrupts, which
+               is impolite if they're off, so poll instead. */
+            if (old_level == INTR_OFF)
+              drain_poll ();
+            else
+              {
+                tx_waiters++;
+                sema_down (&tx_room);
+              }
+            continue;
+          }
+
+        /* Copy up to the end of the ring or of what fits. */
+        chunk = n < room ? n : room;
+        if (chunk > SERIAL_TXBUF_SIZE - ofs)
+          chunk = SERIAL_TXBUF_SIZE - ofs;
+        memcpy (txbuf + ofs, p, chunk);
+        tx_head += chunk;
+        p += chunk;
+        n -= chunk;
+
+        /* Start transmitting if the UART is idle. */
+        fill_fifo ();
+        write_ier ();
+      }
+
   intr_set_level (old_level);
 }
 
@@ -135,8 +203,8 @@ void
 serial_flush (void) 
 {
   enum intr_level old_level = intr_disable ();
-  while (!intq_empty (&txq))
-    putc_poll (intq_getc (&txq));
+  while (tx_head != tx_tail)
+    drain_poll ();
   intr_set_level (old_level);
 }
 
@@ -182,7 +250,7 @@ write_ier (void)
 
   /* Enable transmit interrupt if we have any characters to
      transmit. */
-  if (!intq_empty (&txq))
+  if (tx_head != tx_tail)
     ier |= IER_XMIT;
 
   /* Enable receive interrupt if we have room to store any
@@ -205,6 +273,33 @@ putc_poll (uint8_t byte)
   outb (THR_REG, byte);
 }
 
+/* If the UART's transmitter is empty, refills it with as many
+   bytes from the transmit ring as it can hold. */
+static void
+fill_fifo (void)
+{
+  size_t i;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if ((inb (LSR_REG) & LSR_THRE) == 0)
+    return;
+  for (i = 0; i < xmit_burst && tx_head != tx_tail; i++)
+    outb (THR_REG, txbuf[tx_tail++ % SERIAL_TXBUF_SIZE]);
+}
+
+/* Waits for the UART's transmitter to empty, then refills it from
+   the transmit ring. */
+static void
+drain_poll (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while ((inb (LSR_REG) & LSR_THRE) == 0)
+    continue;
+  fill_fifo ();
+}
+
 /* Serial interrupt handler. */
 static void
 serial_interrupt (struct intr_frame *f UNUSED) 
@@ -218,10 +313,15 @@ serial_interrupt (struct intr_frame *f UNUSED)
   while (!input_full () && (inb (LSR_REG) & LSR_DR) != 0)
     input_putc (inb (RBR_REG));
 
-  /* As long as we have a byte to transmit, and the hardware is
-     ready to accept a byte for transmission, transmit a byte. */
-  while (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0) 
-    outb (THR_REG, intq_getc (&txq));
+  /* If the transmitter is empty, refill it, a FIFO's worth at a
+     time. */
+  fill_fifo ();
+
+  /* Wake writers waiting for room once the ring is half empty,
+     so that each wakeup lets them queue a good amount. */
+  if (tx_waiters > 0 && tx_head - tx_tail <= SERIAL_TXBUF_SIZE / 2)
+    for (; tx_waiters > 0; tx_waiters--)
+      sema_up (&tx_room);
 
   /* Update interrupt enable register based on queue status. */
   write_ier ();
@@ -1,6 +1,7 @@
 #include "devices/timer.h"
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stdio.h>
 #include "devices/pit.h"
@@ -17,14 +18,46 @@
 #error TIMER_FREQ <= 1000 recommended
 #endif
 
+/* PIT cycles per timer tick, as pit_configure_channel() rounds
+   it, and the largest number of whole ticks that a one-shot
+   count can cover. */
+#define PIT_TICK ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+#define MAX_ONESHOT_TICKS (65536 / PIT_TICK)
+
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/* Number of timer interrupts taken. */
+static int64_t interrupt_cnt;
+
+/* Threads blocked in timer_sleep(), in order of wakeup time. */
+static struct list sleep_list;
+
+/* If true, then while only the idle thread can run, the timer
+   interrupts once, when the next sleeper is due, instead of on
+   every tick.  Controlled by kernel command-line option
+   "-notickless". */
+bool timer_tickless = true;
+
+/* While the idle thread waits tickless, the number of ticks
+   ending when the one-shot count runs out, and the PIT cycles
+   of the current tick that had already passed when it was
+   started.  ONESHOT_TICKS is 0 while the timer is periodic. */
+static int oneshot_ticks;
+static unsigned oneshot_phase;
+
+/* CPU cycle counter at timer_init(), when ticks was 0. */
+static uint64_t boot_cycles;
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
 static intr_handler_func timer_interrupt;
+static bool wakeup_less (const struct list_elem *, const struct list_elem *,
+                         void *aux);
+static void wake_sleepers (void);
+static void end_oneshot (int64_t passed);
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
@@ -35,8 +68,10 @@ static void real_time_delay (int64_t num, int32_t denom);
 void
 timer_init (void) 
 {
+  list_init (&sleep_list);
   pit_configure_channel (0, 2, TIMER_FREQ);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
+  boot_cycles = timer_cycles ();
 }
 
 /* Calibrates loops_per_tick, used to implement brief delays. */
@@ -84,16 +119,116 @@ timer_elapsed (int64_t then)
   return timer_ticks () - then;
 }
 
+/* Returns the CPU's time-stamp counter, which counts cycles at a
+   fixed rate.  Cheap enough to time short stretches of code. */
+uint64_t
+timer_cycles (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Returns the approximate number of timer_cycles() per second,
+   measured against the timer since boot, or 0 if not even one
+   tick has passed yet. */
+uint64_t
+timer_cycle_freq (void)
+{
+  int64_t t = timer_ticks ();
+  return t > 0 ? (timer_cycles () - boot_cycles) * TIMER_FREQ / t : 0;
+}
+
 /* Sleeps for approximately TICKS timer ticks.  Interrupts must
    be turned on. */
 void
 timer_sleep (int64_t ticks) 
 {
-  int64_t start = timer_ticks ();
+  struct thread *t = thread_current ();
+  enum intr_level old_level;
 
   ASSERT (intr_get_level () == INTR_ON);
-  while (timer_elapsed (start) < ticks) 
-    thread_yield ();
+  if (ticks <= 0)
+    return;
+
+  old_level = intr_disable ();
+  t->wakeup = timer_ticks () + ticks;
+  list_insert_ordered (&sleep_list, &t->elem, wakeup_less, NULL);
+  thread_block ();
+  intr_set_level (old_level);
+}
+
+/* Waits for an interrupt, on behalf of the idle thread.  Called,
+   and returns, with interrupts off.
+
+   If tickless idle is enabled, first reprograms the timer to
+   interrupt only once, at the tick when the first sleeper is
+   due, or as late as the PIT allows if there is none.  Any
+   interrupt that wakes us up earlier, e.g. from a disk, ends
+   this early, since the thread it readies needs time slices.
+   Either way, the ticks that passed are added to the count and
+   the timer goes back to interrupting every tick.  If the count
+   is still running out from a previous call, just waits for it. */
+void
+timer_idle (void) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (timer_tickless && oneshot_ticks == 0) 
+    {
+      int64_t wait = MAX_ONESHOT_TICKS;
+
+      if (!list_empty (&sleep_list)) 
+        {
+          struct thread *t = list_entry (list_front (&sleep_list),
+                                         struct thread, elem);
+          if (t->wakeup - ticks < wait)
+            wait = t->wakeup - ticks;
+        }
+
+      /* Not worth it for the very next tick.  Otherwise, end the
+         count on a tick boundary, taking into account how far
+         into the current tick we are. */
+      if (wait > 1) 
+        {
+          unsigned left = pit_read_count (0);
+          oneshot_phase = left < PIT_TICK ? PIT_TICK - left : 0;
+          oneshot_ticks = wait;
+          pit_start_oneshot (0, wait * PIT_TICK - oneshot_phase);
+        }
+    }
+
+  /* Re-enable interrupts and wait for the next one.
+
+     The `sti' instruction disables interrupts until the
+     completion of the next instruction, so these two
+     instructions are executed atomically.  This atomicity is
+     important; otherwise, an interrupt could be handled
+     between re-enabling interrupts and waiting for the next
+     one to occur, wasting as much as one clock tick worth of
+     time.
+
+     See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
+     7.11.1 "HLT Instruction". */
+  asm volatile ("sti; hlt" : : : "memory");
+  intr_disable ();
+
+  if (oneshot_ticks > 0) 
+    {
+      /* Some other interrupt woke us up.  If the count has run
+         out since then, the timer interrupt is pending and will
+         end tickless idle with all of its ticks as soon as
+         interrupts are turned back on.  Otherwise, count the
+         whole ticks that have passed; the rest of the current
+         one is lost. */
+      unsigned count = oneshot_ticks * PIT_TICK - oneshot_phase;
+      unsigned left;
+      if (pit_read_back (0, &left))
+        return;
+      if (left > count)
+        left = count;
+      end_oneshot ((oneshot_phase + count - left) / PIT_TICK);
+    }
 }
 
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
@@ -163,15 +298,65 @@ timer_ndelay (int64_t ns)
 void
 timer_print_stats (void) 
 {
-  printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+  printf ("Timer: %"PRId64" ticks, %"PRId64" interrupts\n",
+          timer_ticks (), interrupt_cnt);
 }
 
 /* Timer interrupt handler. */
 static void
 timer_interrupt (struct intr_frame *args UNUSED)
 {
-  ticks++;
-  thread_tick ();
+  interrupt_cnt++;
+  if (oneshot_ticks > 0)
+    end_oneshot (oneshot_ticks);
+  else
+    {
+      ticks++;
+      thread_tick ();
+    }
+  wake_sleepers ();
+}
+
+/* Returns true if sleeping thread A wakes up before B. */
+static bool
+wakeup_less (const struct list_elem *a_, const struct list_elem *b_,
+             void *aux UNUSED) 
+{
+  const struct thread *a = list_entry (a_, struct thread, elem);
+  const struct thread *b = list_entry (b_, struct thread, elem);
+
+  return a->wakeup < b->wakeup;
+}
+
+/* Unblocks the sleeping threads that are due. */
+static void
+wake_sleepers (void) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (!list_empty (&sleep_list)) 
+    {
+      struct thread *t = list_entry (list_front (&sleep_list),
+                                     struct thread, elem);
+      if (t->wakeup > ticks)
+        break;
+      list_pop_front (&sleep_list);
+      thread_unblock (t);
+    }
+}
+
+/* Ends tickless idle, during which PASSED ticks went by, and
+   restarts the periodic timer. */
+static void
+end_oneshot (int64_t passed) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  oneshot_ticks = 0;
+  pit_configure_channel (0, 2, TIMER_FREQ);
+  ticks += passed;
+  thread_tick_idle (passed);
+  wake_sleepers ();
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
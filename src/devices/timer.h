@@ -2,17 +2,26 @@
 #define DEVICES_TIMER_H
 
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/* Stop the periodic tick while idle?  Cleared by -notickless. */
+extern bool timer_tickless;
+
 void timer_init (void);
 void timer_calibrate (void);
+void timer_idle (void);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
 
+/* CPU cycle counter. */
+uint64_t timer_cycles (void);
+uint64_t timer_cycle_freq (void);
+
 /* Sleep and yield the CPU to other threads. */
 void timer_sleep (int64_t ticks);
 void timer_msleep (int64_t milliseconds);
@@ -0,0 +1,423 @@
+#include "devices/virtio-blk.h"
+#include <debug.h>
+#include <round.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "devices/block.h"
+#include "devices/partition.h"
+#include "devices/pci.h"
+#include "threads/interrupt.h"
+#include "threads/io.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* The code in this file drives virtio block devices, as QEMU
+   provides with "-drive if=virtio", through the legacy ("virtio
+   0.9.5") PCI interface.  Each device has one virtqueue, through
+   which we pass one request at a time. */
+
+/* PCI IDs of a legacy virtio block device. */
+#define VIRTIO_VENDOR 0x1af4
+#define VIRTIO_BLK_DEVICE 0x1001
+
+/* Legacy virtio registers, as offsets from the I/O port in base
+   address register 0. */
+#define REG_HOST_FEATURES 0x00  /* Features device offers (32 bits). */
+#define REG_GUEST_FEATURES 0x04 /* Features driver accepts (32 bits). */
+#define REG_QUEUE_PFN 0x08      /* Page number of queue (32 bits). */
+#define REG_QUEUE_SIZE 0x0c     /* Entries in queue (16 bits, r/o). */
+#define REG_QUEUE_SELECT 0x0e   /* Queue to configure (16 bits). */
+#define REG_QUEUE_NOTIFY 0x10   /* Queue with new requests (16 bits). */
+#define REG_STATUS 0x12         /* Device status (8 bits). */
+#define REG_ISR 0x13            /* Interrupt status (8 bits, r/o). */
+#define REG_CAPACITY 0x14       /* Capacity in sectors (64 bits, r/o). */
+
+/* Device status bits. */
+#define STATUS_ACKNOWLEDGE 0x01 /* We found the device. */
+#define STATUS_DRIVER 0x02      /* We know how to drive it. */
+#define STATUS_DRIVER_OK 0x04   /* We are ready to use it. */
+#define STATUS_FAILED 0x80      /* We gave up on it. */
+
+/* Feature bits. */
+#define VIRTIO_BLK_F_RO (1u << 5)       /* Device is read-only. */
+
+/* ISR status bits. */
+#define ISR_QUEUE 0x01          /* A queue has completed requests. */
+
+/* A virtqueue descriptor: one buffer of a request. */
+struct vring_desc
+  {
+    uint64_t addr;              /* Physical address. */
+    uint32_t len;               /* Length in bytes. */
+    uint16_t flags;             /* VRING_DESC_F_*. */
+    uint16_t next;              /* Next descriptor, with F_NEXT. */
+  };
+
+#define VRING_DESC_F_NEXT 1     /* Request continues in NEXT. */
+#define VRING_DESC_F_WRITE 2    /* Device writes, not reads, buffer. */
+
+/* Ring of requests made available to the device. */
+struct vring_avail
+  {
+    uint16_t flags;
+    uint16_t idx;               /* Where we put the next request. */
+    uint16_t ring[];            /* First descriptor of each request. */
+  };
+
+/* Ring of requests the device has completed. */
+struct vring_used_elem
+  {
+    uint32_t id;                /* First descriptor of request. */
+    uint32_t len;               /* Bytes written by device. */
+  };
+
+struct vring_used
+  {
+    uint16_t flags;
+    uint16_t idx;               /* Where device puts the next one. */
+    struct vring_used_elem ring[];
+  };
+
+/* The legacy interface aligns the used ring to this. */
+#define VRING_ALIGN 4096
+
+/* Header of a virtio block request. */
+struct request_header
+  {
+    uint32_t type;              /* VIRTIO_BLK_T_*. */
+    uint32_t reserved;
+    uint64_t sector;            /* First sector. */
+  };
+
+#define VIRTIO_BLK_T_IN 0       /* Read. */
+#define VIRTIO_BLK_T_OUT 1      /* Write. */
+#define VIRTIO_BLK_S_OK 0       /* Request status: success. */
+
+/* Most sectors we transfer with one request. */
+#define MAX_REQUEST_SECTORS 256
+
+/* Times to check for completion before sleeping until the
+   completion interrupt.  QEMU often finishes a request within
+   this long, and polling saves an interrupt and two context
+   switches. */
+#define POLL_CNT 1000
+
+/* A virtio block device. */
+struct vblk
+  {
+    char name[8];               /* Name, e.g. "vda". */
+    uint16_t io_base;           /* Base I/O port. */
+    uint8_t irq;                /* Interrupt vector. */
+    bool read_only;             /* Device refuses writes? */
+
+    /* Virtqueue. */
+    uint16_t queue_size;        /* Number of descriptors. */
+    struct vring_desc *desc;    /* Descriptor table. */
+    struct vring_avail *avail;  /* Available ring. */
+    volatile struct vring_used *used;   /* Used ring. */
+    uint16_t last_used;         /* used->idx after last completion. */
+
+    /* The request being carried out. */
+    struct request_header *header;      /* Request header. */
+    volatile uint8_t *status;   /* Status byte written by device. */
+    bool waiting;               /* Is a thread sleeping on DONE? */
+    struct semaphore done;      /* Up'd by interrupt handler. */
+  };
+
+/* We support up to this many devices. */
+#define VBLK_CNT 4
+static struct vblk vblks[VBLK_CNT];
+static size_t vblk_cnt;
+
+static struct block_operations vblk_operations;
+
+static bool init_device (struct vblk *, const struct pci_dev *);
+static bool init_queue (struct vblk *);
+static void interrupt_handler (struct intr_frame *);
+
+/* Finds virtio block devices on the PCI bus, sets them up, and
+   registers them with the block layer. */
+void
+virtio_blk_init (void)
+{
+  struct pci_dev pci;
+  int i;
+
+  for (i = 0; vblk_cnt < VBLK_CNT
+              && pci_find_id (VIRTIO_VENDOR, VIRTIO_BLK_DEVICE, i, &pci); i++)
+    {
+      struct vblk *v = &vblks[vblk_cnt];
+      uint64_t capacity;
+      struct block *block;
+      size_t j;
+
+      snprintf (v->name, sizeof v->name, "vd%c", 'a' + (int) vblk_cnt);
+      if (!init_device (v, &pci))
+        continue;
+
+      /* Devices may share an interrupt line.  Register the
+         handler only once per line; it checks every device. */
+      for (j = 0; j < vblk_cnt; j++)
+        if (vblks[j].irq == v->irq)
+          break;
+      if (j == vblk_cnt)
+        intr_register_ext (v->irq, interrupt_handler, "virtio-blk");
+      vblk_cnt++;
+
+      capacity = inl (v->io_base + REG_CAPACITY);
+      capacity |= (uint64_t) inl (v->io_base + REG_CAPACITY + 4) << 32;
+      if (capacity > UINT32_MAX)
+        capacity = UINT32_MAX;
+      block = block_register (v->name, BLOCK_RAW,
+                              v->read_only ? "virtio, read-only" : "virtio",
+                              capacity, &vblk_operations, v);
+      partition_scan (block);
+    }
+}
+
+/* Resets the device found at PCI and sets up V to drive it.
+   Returns true if successful, false on failure. */
+static bool
+init_device (struct vblk *v, const struct pci_dev *pci)
+{
+  uint32_t bar0 = pci_read_config (pci, PCI_REG_BAR0);
+  uint32_t features;
+
+  if ((bar0 & 1) == 0)
+    {
+      printf ("%s: base address register 0 is not in I/O space\n",
+              v->name);
+      return false;
+    }
+  v->io_base = bar0 & 0xfffc;
+  v->irq = (pci_read_config (pci, PCI_REG_INTR) & 0xff) + 0x20;
+  pci_write_config (pci, PCI_REG_COMMAND,
+                    (pci_read_config (pci, PCI_REG_COMMAND) & 0xffff)
+                    | PCI_CMD_IO | PCI_CMD_MASTER);
+
+  /* Reset, then announce ourselves.  We use none of the
+     optional features, but must respect a read-only device. */
+  outb (v->io_base + REG_STATUS, 0);
+  outb (v->io_base + REG_STATUS, STATUS_ACKNOWLEDGE | STATUS_DRIVER);
+  features = inl (v->io_base + REG_HOST_FEATURES);
+  v->read_only = (features & VIRTIO_BLK_F_RO) != 0;
+  outl (v->io_base + REG_GUEST_FEATURES, 0);
+
+  if (!init_queue (v))
+    {
+      outb (v->io_base + REG_STATUS, STATUS_FAILED);
+      return false;
+    }
+
+  v->waiting = false;
+  sema_init (&v->done, 0);
+  outb (v->io_base + REG_STATUS,
+        STATUS_ACKNOWLEDGE | STATUS_DRIVER | STATUS_DRIVER_OK);
+  return true;
+}
+
+/* Allocates V's virtqueue, in the layout the legacy interface
+   requires, and tells the device where it is.  Returns true if
+   successful, false on failure. */
+static bool
+init_queue (struct vblk *v)
+{
+  size_t avail_end, used_ofs, size;
+  uint8_t *queue, *request;
+
+  outw (v->io_base + REG_QUEUE_SELECT, 0);
+  v->queue_size = inw (v->io_base + REG_QUEUE_SIZE);
+  if (v->queue_size < 3)
+    {
+      printf ("%s: queue too small\n", v->name);
+      return false;
+    }
+
+  /* The descriptor table and available ring come first, then
+     the used ring, at the next VRING_ALIGN boundary. */
+  avail_end = (sizeof *v->desc * v->queue_size
+               + sizeof *v->avail + sizeof *v->avail->ring * v->queue_size
+               + sizeof (uint16_t));
+  used_ofs = ROUND_UP (avail_end, VRING_ALIGN);
+  size = (used_ofs + sizeof *v->used
+          + sizeof *v->used->ring * v->queue_size + sizeof (uint16_t));
+  queue = palloc_get_multiple (PAL_ZERO, DIV_ROUND_UP (size, PGSIZE));
+  request = palloc_get_page (PAL_ZERO);
+  if (queue == NULL || request == NULL)
+    {
+      printf ("%s: out of memory for queue\n", v->name);
+      if (queue != NULL)
+        palloc_free_multiple (queue, DIV_ROUND_UP (size, PGSIZE));
+      if (request != NULL)
+        palloc_free_page (request);
+      return false;
+    }
+
+  v->desc = (struct vring_desc *) queue;
+  v->avail = (struct vring_avail *) (queue
+                                     + sizeof *v->desc * v->queue_size);
+  v->used = (struct vring_used *) (queue + used_ofs);
+  v->last_used = 0;
+  v->header = (struct request_header *) request;
+  v->status = request + sizeof *v->header;
+
+  outl (v->io_base + REG_QUEUE_PFN, vtop (queue) / VRING_ALIGN);
+  return true;
+}
+
+/* Waits for V's device to complete the request most recently
+   made available: first by polling, then by sleeping until the
+   completion interrupt. */
+static void
+wait_for_completion (struct vblk *v)
+{
+  enum intr_level old_level;
+  int i;
+
+  for (i = 0; i < POLL_CNT; i++)
+    if (v->used->idx != v->last_used)
+      goto done;
+
+  /* The handler only ups DONE for a sleeping thread, so a late
+     interrupt for a request we already saw by polling cannot
+     leave DONE up for the next one. */
+  old_level = intr_disable ();
+  while (v->used->idx == v->last_used)
+    {
+      v->waiting = true;
+      sema_down (&v->done);
+    }
+  intr_set_level (old_level);
+
+ done:
+  v->last_used++;
+}
+
+/* Transfers the CNT sectors starting at SECTOR between V and
+   BUFFER, a kernel virtual address: to the device if WRITE,
+   otherwise from it.  CNT must be between 1 and
+   MAX_REQUEST_SECTORS.  Descriptors 0, 1, and 2 hold the request
+   header, the data, and the status byte. */
+static void
+transfer (struct vblk *v, block_sector_t sector, size_t cnt, void *buffer,
+          bool write)
+{
+  ASSERT (cnt >= 1 && cnt <= MAX_REQUEST_SECTORS);
+
+  if (write && v->read_only)
+    PANIC ("%s: write to read-only device, sector=%"PRDSNu,
+           v->name, sector);
+
+  v->header->type = write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN;
+  v->header->reserved = 0;
+  v->header->sector = sector;
+  *v->status = 0xff;
+
+  v->desc[0].addr = vtop (v->header);
+  v->desc[0].len = sizeof *v->header;
+  v->desc[0].flags = VRING_DESC_F_NEXT;
+  v->desc[0].next = 1;
+  v->desc[1].addr = vtop (buffer);
+  v->desc[1].len = cnt * BLOCK_SECTOR_SIZE;
+  v->desc[1].flags = VRING_DESC_F_NEXT | (write ? 0 : VRING_DESC_F_WRITE);
+  v->desc[1].next = 2;
+  v->desc[2].addr = vtop ((void *) v->status);
+  v->desc[2].len = 1;
+  v->desc[2].flags = VRING_DESC_F_WRITE;
+  v->desc[2].next = 0;
+
+  /* Publish the descriptors before the ring entry, and the ring
+     entry before the index. */
+  v->avail->ring[v->avail->idx % v->queue_size] = 0;
+  barrier ();
+  v->avail->idx++;
+  barrier ();
+  outw (v->io_base + REG_QUEUE_NOTIFY, 0);
+
+  wait_for_completion (v);
+  if (*v->status != VIRTIO_BLK_S_OK)
+    PANIC ("%s: disk %s failed, sector=%"PRDSNu", status=%d",
+           v->name, write ? "write" : "read", sector, *v->status);
+}
+
+/* Reads the CNT sectors starting at SECTOR from device V_ into
+   BUFFER.  The block layer's dispatcher already serializes
+   requests to each device. */
+static void
+vblk_read_multiple (void *v_, block_sector_t sector, size_t cnt,
+                    void *buffer)
+{
+  uint8_t *p = buffer;
+
+  while (cnt > 0)
+    {
+      size_t n = cnt < MAX_REQUEST_SECTORS ? cnt : MAX_REQUEST_SECTORS;
+      transfer (v_, sector, n, p, false);
+      p += n * BLOCK_SECTOR_SIZE;
+      sector += n;
+      cnt -= n;
+    }
+}
+
+/* Writes the CNT sectors starting at SECTOR to device V_ from
+   BUFFER. */
+static void
+vblk_write_multiple (void *v_, block_sector_t sector, size_t cnt,
+                     const void *buffer)
+{
+  const uint8_t *p = buffer;
+
+  while (cnt > 0)
+    {
+      size_t n = cnt < MAX_REQUEST_SECTORS ? cnt : MAX_REQUEST_SECTORS;
+      transfer (v_, sector, n, (void *) p, true);
+      p += n * BLOCK_SECTOR_SIZE;
+      sector += n;
+      cnt -= n;
+    }
+}
+
+/* Reads sector SECTOR from device V_ into BUFFER. */
+static void
+vblk_read (void *v_, block_sector_t sector, void *buffer)
+{
+  vblk_read_multiple (v_, sector, 1, buffer);
+}
+
+/* Writes sector SECTOR to device V_ from BUFFER. */
+static void
+vblk_write (void *v_, block_sector_t sector, const void *buffer)
+{
+  vblk_write_multiple (v_, sector, 1, buffer);
+}
+
+static struct block_operations vblk_operations =
+  {
+    vblk_read,
+    vblk_write,
+    vblk_read_multiple,
+    vblk_write_multiple,
+    NULL,
+    NULL
+  };
+
+/* Virtio interrupt handler.  Reading a device's ISR status
+   acknowledges its interrupt. */
+static void
+interrupt_handler (struct intr_frame *f)
+{
+  size_t i;
+
+  for (i = 0; i < vblk_cnt; i++)
+    {
+      struct vblk *v = &vblks[i];
+      if (f->vec_no == v->irq
+          && (inb (v->io_base + REG_ISR) & ISR_QUEUE) != 0
+          && v->waiting)
+        {
+          v->waiting = false;
+          sema_up (&v->done);
+        }
+    }
+}
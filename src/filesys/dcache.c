@@ -0,0 +1,176 @@
+#include "filesys/dcache.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <string.h>
+#include "filesys/directory.h"
+#include "threads/synch.h"
+
+/* Directory entry cache.
+
+   Maps a (directory inode sector, name) pair to the sector of
+   the inode that the name refers to, so that resolving a path
+   does not have to scan every directory along the way.  Only
+   names that exist are cached.  The directory code keeps the
+   cache coherent by dropping an entry whenever the name it
+   describes is removed. */
+
+/* Number of cached names. */
+#define DCACHE_SIZE 64
+
+/* A cached name. */
+struct dcache_entry
+  {
+    struct hash_elem hash_elem;         /* Element in dcache. */
+    struct list_elem lru_elem;          /* Element in lru_list. */
+    block_sector_t dir;                 /* Sector of containing directory. */
+    char name[NAME_MAX + 1];            /* Null terminated file name. */
+    block_sector_t sector;              /* Sector of the named inode. */
+  };
+
+static struct dcache_entry entries[DCACHE_SIZE];
+
+/* Entries in use, indexed by DIR and NAME. */
+static struct hash dcache;
+
+/* Entries in use, least recently used first. */
+static struct list lru_list;
+
+/* Entries not in use. */
+static struct list free_list;
+
+/* Protects all of the above. */
+static struct lock dcache_lock;
+
+static hash_hash_func dcache_hash_func;
+static hash_less_func dcache_less_func;
+static struct dcache_entry *find (block_sector_t dir, const char *name);
+
+/* Initializes the directory entry cache. */
+void
+dcache_init (void)
+{
+  size_t i;
+
+  hash_init (&dcache, dcache_hash_func, dcache_less_func, NULL);
+  list_init (&lru_list);
+  list_init (&free_list);
+  lock_init (&dcache_lock);
+  for (i = 0; i < DCACHE_SIZE; i++)
+    list_push_back (&free_list, &entries[i].lru_elem);
+}
+
+/* Looks up NAME in the directory whose inode is in sector DIR.
+   If it is cached, stores the sector of its inode in *SECTOR and
+   returns true.  Otherwise returns false. */
+bool
+dcache_lookup (block_sector_t dir, const char *name, block_sector_t *sector)
+{
+  struct dcache_entry *e;
+
+  lock_acquire (&dcache_lock);
+  e = find (dir, name);
+  if (e != NULL)
+    {
+      *sector = e->sector;
+      list_remove (&e->lru_elem);
+      list_push_back (&lru_list, &e->lru_elem);
+    }
+  lock_release (&dcache_lock);
+
+  return e != NULL;
+}
+
+/* Records that NAME in the directory whose inode is in sector
+   DIR refers to the inode in SECTOR, evicting the least recently
+   used name if the cache is full.  Names too long to be valid
+   are ignored. */
+void
+dcache_insert (block_sector_t dir, const char *name, block_sector_t sector)
+{
+  struct dcache_entry *e;
+
+  if (strlen (name) > NAME_MAX)
+    return;
+
+  lock_acquire (&dcache_lock);
+  e = find (dir, name);
+  if (e == NULL)
+    {
+      if (!list_empty (&free_list))
+        e = list_entry (list_pop_front (&free_list),
+                        struct dcache_entry, lru_elem);
+      else
+        {
+          e = list_entry (list_pop_front (&lru_list),
+                          struct dcache_entry, lru_elem);
+          hash_delete (&dcache, &e->hash_elem);
+        }
+      e->dir = dir;
+      strlcpy (e->name, name, sizeof e->name);
+      hash_insert (&dcache, &e->hash_elem);
+    }
+  else
+    list_remove (&e->lru_elem);
+  e->sector = sector;
+  list_push_back (&lru_list, &e->lru_elem);
+  lock_release (&dcache_lock);
+}
+
+/* Forgets any cached entry for NAME in the directory whose
+   inode is in sector DIR. */
+void
+dcache_remove (block_sector_t dir, const char *name)
+{
+  struct dcache_entry *e;
+
+  lock_acquire (&dcache_lock);
+  e = find (dir, name);
+  if (e != NULL)
+    {
+      hash_delete (&dcache, &e->hash_elem);
+      list_remove (&e->lru_elem);
+      list_push_back (&free_list, &e->lru_elem);
+    }
+  lock_release (&dcache_lock);
+}
+
+/* Returns the cached entry for NAME in DIR, or a null pointer if
+   there is none.  The caller must hold dcache_lock. */
+static struct dcache_entry *
+find (block_sector_t dir, const char *name)
+{
+  struct dcache_entry key;
+  struct hash_elem *e;
+
+  if (strlen (name) > NAME_MAX)
+    return NULL;
+
+  key.dir = dir;
+  strlcpy (key.name, name, sizeof key.name);
+  e = hash_find (&dcache, &key.hash_elem);
+  return e != NULL ? hash_entry (e, struct dcache_entry, hash_elem) : NULL;
+}
+
+/* Returns a hash value for dcache entry E. */
+static unsigned
+dcache_hash_func (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct dcache_entry *d = hash_entry (e, struct dcache_entry,
+                                             hash_elem);
+  return hash_string (d->name) ^ hash_int (d->dir);
+}
+
+/* Returns true if dcache entry A precedes dcache entry B. */
+static bool
+dcache_less_func (const struct hash_elem *a, const struct hash_elem *b,
+                  void *aux UNUSED)
+{
+  const struct dcache_entry *x = hash_entry (a, struct dcache_entry,
+                                             hash_elem);
+  const struct dcache_entry *y = hash_entry (b, struct dcache_entry,
+                                             hash_elem);
+  if (x->dir != y->dir)
+    return x->dir < y->dir;
+  return strcmp (x->name, y->name) < 0;
+}
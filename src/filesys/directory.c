@@ -1,10 +1,15 @@
 #include "filesys/directory.h"
 #include <stdio.h>
 #include <string.h>
+#include <hash.h>
 #include <list.h>
+#include <round.h>
+#include "filesys/dcache.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "filesys/journal.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
 /* A directory. */
 struct dir 
@@ -21,21 +26,157 @@ struct dir_entry
     bool in_use;                        /* In use or free? */
   };
 
+/* Directories start out in a linear format, an array of
+   dir_entry slots that is scanned in order.  A linear directory
+   always fits in one sector.  When it fills up it is converted to
+   a hashed format, which is how every directory longer than one
+   sector is laid out:
+
+     sector 0:          struct dir_header
+     sectors 1...N:     N buckets, each a struct dir_bucket
+
+   A name lives in bucket hash_string (NAME) % N, where N is a
+   power of 2, so a lookup reads a single sector however large
+   the directory grows.  When a bucket overflows, N doubles and
+   each entry in bucket B either stays or moves to B + N / 2.
+
+   The header, not the inode's length, says which format a
+   directory is in and how many buckets it has, and rewriting it
+   is the last step of every conversion or split.  Until then the
+   directory reads as it did before, so one that fails partway,
+   e.g. for lack of memory, is left as it was.  A split copies the
+   moving entries but leaves the originals behind, so an in-use
+   entry only counts if it is in its own bucket; the others are
+   treated as free slots. */
+
+/* Identifies a hashed directory. */
+#define DIR_HASH_MAGIC 0x48524944
+
+/* Number of entries per bucket. */
+#define BUCKET_ENTRIES (BLOCK_SECTOR_SIZE / sizeof (struct dir_entry))
+
+/* Bucket counts when a directory is first hashed and at most.
+
+   A split is part of a single journal transaction, which must
+   hold all of the new buckets along with the header and the
+   inode and free-map sectors that growing the directory touches,
+   and still leave room for other operations sharing it.  Capping
+   the largest split at half a log's worth of buckets does that.
+   A directory therefore holds at most MAX_BUCKETS * BUCKET_ENTRIES
+   entries, and in practice fewer: once it has MAX_BUCKETS
+   buckets, a create fails as soon as its own bucket is full. */
+#define MIN_BUCKETS 4
+#define MAX_BUCKETS 64
+#if MAX_BUCKETS > JOURNAL_SECTORS / 2
+#error MAX_BUCKETS buckets do not fit in one journal transaction
+#endif
+
+/* The part of a dir_header that is in use. */
+struct dir_info
+  {
+    unsigned magic;                     /* DIR_HASH_MAGIC. */
+    uint32_t bucket_cnt;                /* Number of buckets. */
+  };
+
+/* First sector of a hashed directory.
+   Must be exactly BLOCK_SECTOR_SIZE bytes long. */
+struct dir_header
+  {
+    struct dir_info info;               /* Magic and bucket count. */
+    uint32_t unused[126];               /* Not used. */
+  };
+
+/* Result of lookup(). */
+enum lookup_result
+  {
+    LOOKUP_FOUND,                       /* Name is in the directory. */
+    LOOKUP_NOT_FOUND,                   /* Name is not in the directory. */
+    LOOKUP_ERROR                        /* Out of memory or disk error. */
+  };
+
+/* A bucket of a hashed directory.
+   Must be exactly BLOCK_SECTOR_SIZE bytes long. */
+struct dir_bucket
+  {
+    struct dir_entry entries[BUCKET_ENTRIES];
+    uint8_t unused[BLOCK_SECTOR_SIZE
+                   - BUCKET_ENTRIES * sizeof (struct dir_entry)];
+  };
+
+/* Serializes directory reads and updates, so that two threads
+   adding names cannot claim the same free slot and a lookup
+   never sees a half-written entry.  File data is protected
+   separately, by each inode's own lock. */
+static struct lock dir_lock;
+
+/* Name of the entry that every directory keeps, in its first
+   slot, for its parent.  dir_readdir() never returns it. */
+#define PARENT_NAME ".."
+
+static bool is_empty (struct inode *);
+static bool read_bucket_cnt (struct inode *, size_t *cnt);
+static off_t bucket_ofs (size_t b);
+static bool is_live (const struct dir_entry *, size_t b, size_t cnt);
+static bool add_linear (struct inode *, const struct dir_entry *,
+                        bool *full);
+static bool reserve_buckets (struct inode *, size_t cnt);
+static bool split (struct inode *, size_t cnt);
+static bool add_hashed (struct inode *, const struct dir_entry *,
+                        size_t cnt);
+static bool convert_to_hashed (struct inode *);
+static bool next_slot (struct inode *, off_t *pos, struct dir_entry *);
+
+/* Initializes the directory module. */
+void
+dir_init (void)
+{
+  lock_init (&dir_lock);
+  dcache_init ();
+}
+
 /* Creates a directory with space for ENTRY_CNT entries in the
-   given SECTOR.  Returns true if successful, false on failure. */
+   given SECTOR, whose parent is the directory in PARENT_SECTOR.
+   The root directory is its own parent.  The directory starts
+   out linear, so ENTRY_CNT entries plus the parent link must fit
+   in a sector; it grows as needed once they are used up.
+   Returns true if successful, false on failure. */
 bool
-dir_create (block_sector_t sector, size_t entry_cnt)
+dir_create (block_sector_t sector, size_t entry_cnt,
+            block_sector_t parent_sector)
 {
-  return inode_create (sector, entry_cnt * sizeof (struct dir_entry));
+  struct dir_entry e;
+  struct inode *inode;
+  bool success;
+
+  ASSERT (sizeof (struct dir_header) == BLOCK_SECTOR_SIZE);
+  ASSERT (sizeof (struct dir_bucket) == BLOCK_SECTOR_SIZE);
+  ASSERT (entry_cnt < BUCKET_ENTRIES);
+
+  if (!inode_create (sector, (entry_cnt + 1) * sizeof e, true))
+    return false;
+  inode = inode_open (sector);
+  if (inode == NULL)
+    return false;
+
+  e.inode_sector = parent_sector;
+  strlcpy (e.name, PARENT_NAME, sizeof e.name);
+  e.in_use = true;
+  success = inode_write_at (inode, &e, sizeof e, 0) == sizeof e;
+  inode_close (inode);
+  return success;
 }
 
 /* Opens and returns the directory for the given INODE, of which
-   it takes ownership.  Returns a null pointer on failure. */
+   it takes ownership.  Returns a null pointer on failure,
+   including if INODE's header is not that of a directory in
+   either format. */
 struct dir *
 dir_open (struct inode *inode) 
 {
   struct dir *dir = calloc (1, sizeof *dir);
-  if (inode != NULL && dir != NULL)
+  size_t cnt;
+
+  if (inode != NULL && dir != NULL && read_bucket_cnt (inode, &cnt))
     {
       dir->inode = inode;
       dir->pos = 0;
@@ -84,50 +225,104 @@ dir_get_inode (struct dir *dir)
 }
 
 /* Searches DIR for a file with the given NAME.
-   If successful, returns true, sets *EP to the directory entry
-   if EP is non-null, and sets *OFSP to the byte offset of the
-   directory entry if OFSP is non-null.
-   otherwise, returns false and ignores EP and OFSP. */
-static bool
+   If successful, returns LOOKUP_FOUND, sets *EP to the directory
+   entry if EP is non-null, and sets *OFSP to the byte offset of
+   the directory entry if OFSP is non-null.
+   Otherwise, returns LOOKUP_NOT_FOUND, or LOOKUP_ERROR if the
+   directory could not be searched, and ignores EP and OFSP. */
+static enum lookup_result
 lookup (const struct dir *dir, const char *name,
         struct dir_entry *ep, off_t *ofsp) 
 {
+  struct dir_bucket *bucket;
   struct dir_entry e;
-  size_t ofs;
+  size_t cnt, i;
+  off_t ofs;
+  enum lookup_result result = LOOKUP_NOT_FOUND;
   
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
-  for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-       ofs += sizeof e) 
-    if (e.in_use && !strcmp (name, e.name)) 
-      {
-        if (ep != NULL)
-          *ep = e;
-        if (ofsp != NULL)
-          *ofsp = ofs;
-        return true;
-      }
-  return false;
+  if (!read_bucket_cnt (dir->inode, &cnt))
+    return LOOKUP_ERROR;
+  if (cnt == 0)
+    {
+      for (ofs = 0; ofs < BLOCK_SECTOR_SIZE
+             && inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+           ofs += sizeof e) 
+        if (e.in_use && !strcmp (name, e.name)) 
+          {
+            result = LOOKUP_FOUND;
+            break;
+          }
+    }
+  else
+    {
+      /* Read NAME's whole bucket with one sector read. */
+      bucket = malloc (sizeof *bucket);
+      if (bucket == NULL)
+        return LOOKUP_ERROR;
+      ofs = bucket_ofs (hash_string (name) & (cnt - 1));
+      if (inode_read_at (dir->inode, bucket, sizeof *bucket, ofs)
+          != sizeof *bucket)
+        result = LOOKUP_ERROR;
+      else
+        for (i = 0; i < BUCKET_ENTRIES; i++)
+          if (bucket->entries[i].in_use
+              && !strcmp (name, bucket->entries[i].name))
+            {
+              e = bucket->entries[i];
+              ofs += i * sizeof e;
+              result = LOOKUP_FOUND;
+              break;
+            }
+      free (bucket);
+    }
+
+  if (result == LOOKUP_FOUND)
+    {
+      if (ep != NULL)
+        *ep = e;
+      if (ofsp != NULL)
+        *ofsp = ofs;
+    }
+  return result;
 }
 
 /* Searches DIR for a file with the given NAME
    and returns true if one exists, false otherwise.
    On success, sets *INODE to an inode for the file, otherwise to
-   a null pointer.  The caller must close *INODE. */
+   a null pointer.  The caller must close *INODE.
+   Always fails if DIR has been removed. */
 bool
 dir_lookup (const struct dir *dir, const char *name,
             struct inode **inode) 
 {
   struct dir_entry e;
+  block_sector_t dir_sector;
+  block_sector_t sector;
 
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
-  if (lookup (dir, name, &e, NULL))
-    *inode = inode_open (e.inode_sector);
-  else
-    *inode = NULL;
+  dir_sector = inode_get_inumber (dir->inode);
+  *inode = NULL;
+
+  lock_acquire (&dir_lock);
+  if (!inode_is_removed (dir->inode))
+    {
+      if (dcache_lookup (dir_sector, name, &sector))
+        *inode = inode_open (sector);
+      else if (lookup (dir, name, &e, NULL) == LOOKUP_FOUND)
+        {
+          /* The parent link is not cached, so that it never has
+             to be invalidated when its directory is removed. */
+          if (strcmp (name, PARENT_NAME))
+            dcache_insert (dir_sector, name, e.inode_sector);
+          *inode = inode_open (e.inode_sector);
+        }
+    }
+  lock_release (&dir_lock);
 
   return *inode != NULL;
 }
@@ -136,51 +331,60 @@ dir_lookup (const struct dir *dir, const char *name,
    file by that name.  The file's inode is in sector
    INODE_SECTOR.
    Returns true if successful, false on failure.
-   Fails if NAME is invalid (i.e. too long) or a disk or memory
-   error occurs. */
+   Fails if NAME is invalid (i.e. too long), if DIR has been
+   removed, or if a disk or memory error occurs, including one
+   that keeps DIR from being searched for NAME. */
 bool
 dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
 {
   struct dir_entry e;
-  off_t ofs;
   bool success = false;
+  size_t cnt;
+  bool full;
 
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
   /* Check NAME for validity. */
-  if (*name == '\0' || strlen (name) > NAME_MAX)
+  if (*name == '\0' || strlen (name) > NAME_MAX
+      || !strcmp (name, ".") || !strcmp (name, PARENT_NAME))
     return false;
 
-  /* Check that NAME is not in use. */
-  if (lookup (dir, name, NULL, NULL))
-    goto done;
+  lock_acquire (&dir_lock);
 
-  /* Set OFS to offset of free slot.
-     If there are no free slots, then it will be set to the
-     current end-of-file.
-     
-     inode_read_at() will only return a short read at end of file.
-     Otherwise, we'd need to verify that we didn't get a short
-     read due to something intermittent such as low memory. */
-  for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-       ofs += sizeof e) 
-    if (!e.in_use)
-      break;
+  /* Check that DIR is still linked and NAME is not in use. */
+  if (inode_is_removed (dir->inode)
+      || lookup (dir, name, NULL, NULL) != LOOKUP_NOT_FOUND
+      || !read_bucket_cnt (dir->inode, &cnt))
+    goto done;
 
-  /* Write slot. */
+  /* Write slot, switching to the hashed format if a linear
+     directory has no free slot left. */
   e.in_use = true;
   strlcpy (e.name, name, sizeof e.name);
   e.inode_sector = inode_sector;
-  success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+  if (cnt == 0)
+    {
+      success = add_linear (dir->inode, &e, &full);
+      if (!success && full && convert_to_hashed (dir->inode))
+        success = add_hashed (dir->inode, &e, MIN_BUCKETS);
+    }
+  else
+    success = add_hashed (dir->inode, &e, cnt);
+  if (success)
+    dcache_insert (inode_get_inumber (dir->inode), name, inode_sector);
 
  done:
+  lock_release (&dir_lock);
   return success;
 }
 
 /* Removes any entry for NAME in DIR.
-   Returns true if successful, false on failure,
-   which occurs only if there is no file with the given NAME. */
+   Returns true if successful, false on failure, which occurs if
+   there is no file with the given NAME or if NAME is a directory
+   that is not empty.  A removed directory that is still open,
+   e.g. as some process's working directory, can no longer be
+   looked up in or added to. */
 bool
 dir_remove (struct dir *dir, const char *name) 
 {
@@ -192,13 +396,18 @@ dir_remove (struct dir *dir, const char *name)
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
-  /* Find directory entry. */
-  if (!lookup (dir, name, &e, &ofs))
+  lock_acquire (&dir_lock);
+
+  /* Find directory entry.  The parent link cannot be removed. */
+  if (!strcmp (name, PARENT_NAME)
+      || lookup (dir, name, &e, &ofs) != LOOKUP_FOUND)
     goto done;
 
-  /* Open inode. */
+  /* Open inode.  Directories must be empty to be removed. */
   inode = inode_open (e.inode_sector);
-  if (inode == NULL)
+  if (inode == NULL
+      || (inode_is_dir (inode)
+          && (e.inode_sector == ROOT_DIR_SECTOR || !is_empty (inode))))
     goto done;
 
   /* Erase directory entry. */
@@ -207,30 +416,310 @@ dir_remove (struct dir *dir, const char *name)
     goto done;
 
   /* Remove inode. */
+  dcache_remove (inode_get_inumber (dir->inode), name);
   inode_remove (inode);
   success = true;
 
  done:
+  lock_release (&dir_lock);
   inode_close (inode);
   return success;
 }
 
 /* Reads the next directory entry in DIR and stores the name in
    NAME.  Returns true if successful, false if the directory
-   contains no more entries. */
+   contains no more entries.  The parent link is skipped. */
 bool
 dir_readdir (struct dir *dir, char name[NAME_MAX + 1])
 {
   struct dir_entry e;
+  bool success = false;
 
-  while (inode_read_at (dir->inode, &e, sizeof e, dir->pos) == sizeof e) 
+  lock_acquire (&dir_lock);
+  while (next_slot (dir->inode, &dir->pos, &e))
     {
-      dir->pos += sizeof e;
-      if (e.in_use)
+      if (e.in_use && strcmp (e.name, PARENT_NAME))
         {
           strlcpy (name, e.name, NAME_MAX + 1);
-          return true;
+          success = true;
+          break;
         } 
     }
+  lock_release (&dir_lock);
+  return success;
+}
+
+/* Sets the position of DIR, as used by dir_readdir(), to POS
+   bytes from the start of the directory. */
+void
+dir_seek (struct dir *dir, off_t pos)
+{
+  ASSERT (dir != NULL);
+  ASSERT (pos >= 0);
+  dir->pos = pos;
+}
+
+/* Returns the position of DIR, as used by dir_readdir(). */
+off_t
+dir_tell (const struct dir *dir)
+{
+  ASSERT (dir != NULL);
+  return dir->pos;
+}
+
+/* Returns true if directory INODE has no entries other than its
+   parent link.  The caller must hold dir_lock. */
+static bool
+is_empty (struct inode *inode)
+{
+  struct dir_entry e;
+  off_t pos = 0;
+
+  while (next_slot (inode, &pos, &e))
+    if (e.in_use && strcmp (e.name, PARENT_NAME))
+      return false;
+  return true;
+}
+
+/* Reads the header of directory INODE and sets *CNT to its
+   number of buckets, or to 0 if it is in the linear format.
+   Returns false if the header cannot be read or is that of a
+   hashed directory with an impossible bucket count. */
+static bool
+read_bucket_cnt (struct inode *inode, size_t *cnt)
+{
+  struct dir_info info;
+
+  /* A linear directory starts with its parent link, whose sector
+     number is never as large as DIR_HASH_MAGIC. */
+  if (inode_read_at (inode, &info, sizeof info, 0) != sizeof info)
+    return false;
+  if (info.magic != DIR_HASH_MAGIC)
+    {
+      *cnt = 0;
+      return true;
+    }
+
+  *cnt = info.bucket_cnt;
+  return (*cnt >= MIN_BUCKETS && *cnt <= MAX_BUCKETS
+          && (*cnt & (*cnt - 1)) == 0
+          && bucket_ofs (*cnt) <= inode_length (inode));
+}
+
+/* Returns the byte offset of bucket B in a hashed directory. */
+static off_t
+bucket_ofs (size_t b)
+{
+  return (b + 1) * BLOCK_SECTOR_SIZE;
+}
+
+/* Returns true if E, which is in bucket B of a directory with
+   CNT buckets, is a live entry: in use and in its own bucket. */
+static bool
+is_live (const struct dir_entry *e, size_t b, size_t cnt)
+{
+  return e->in_use && (hash_string (e->name) & (cnt - 1)) == b;
+}
+
+/* Writes E into the first free slot of linear directory INODE.
+   Returns true if successful.  On failure, sets *FULL to true if
+   the reason was that there is no free slot. */
+static bool
+add_linear (struct inode *inode, const struct dir_entry *e, bool *full)
+{
+  struct dir_entry slot;
+  off_t ofs;
+
+  /* inode_read_at() will only return a short read at end of file.
+     Otherwise, we'd need to verify that we didn't get a short
+     read due to something intermittent such as low memory.
+     Past the first sector are only the buckets of a conversion
+     that did not finish. */
+  for (ofs = 0; ofs + sizeof slot <= BLOCK_SECTOR_SIZE
+         && inode_read_at (inode, &slot, sizeof slot, ofs) == sizeof slot;
+       ofs += sizeof slot)
+    if (!slot.in_use)
+      {
+        *full = false;
+        return inode_write_at (inode, e, sizeof *e, ofs) == sizeof *e;
+      }
+  *full = true;
   return false;
 }
+
+/* Grows directory INODE, if necessary, to hold CNT buckets. */
+static bool
+reserve_buckets (struct inode *inode, size_t cnt)
+{
+  return (inode_length (inode) >= bucket_ofs (cnt)
+          || inode_extend (inode, bucket_ofs (cnt)));
+}
+
+/* Doubles the number of buckets in hashed directory INODE, which
+   has CNT buckets, copying each entry that moves into its new
+   bucket and then publishing the new count in the header.
+   Returns true if successful, false if the directory is at its
+   maximum size or out of disk space or memory, in which case it
+   still has CNT buckets. */
+static bool
+split (struct inode *inode, size_t cnt)
+{
+  struct dir_header *header;
+  struct dir_bucket *lo, *hi;
+  bool success = false;
+  size_t b, i;
+
+  if (cnt * 2 > MAX_BUCKETS)
+    return false;
+
+  header = calloc (1, sizeof *header);
+  lo = malloc (sizeof *lo);
+  hi = malloc (sizeof *hi);
+  if (header == NULL || lo == NULL || hi == NULL
+      || !reserve_buckets (inode, cnt * 2))
+    goto done;
+
+  /* The new buckets are past the end of the published ones, so
+     nothing looks at them until the header is rewritten. */
+  for (b = 0; b < cnt; b++)
+    {
+      if (inode_read_at (inode, lo, sizeof *lo, bucket_ofs (b)) != sizeof *lo)
+        goto done;
+      memset (hi, 0, sizeof *hi);
+      for (i = 0; i < BUCKET_ENTRIES; i++)
+        if (is_live (&lo->entries[i], b, cnt)
+            && !is_live (&lo->entries[i], b, cnt * 2))
+          hi->entries[i] = lo->entries[i];
+      if (inode_write_at (inode, hi, sizeof *hi, bucket_ofs (b + cnt))
+          != sizeof *hi)
+        goto done;
+    }
+
+  header->info.magic = DIR_HASH_MAGIC;
+  header->info.bucket_cnt = cnt * 2;
+  success = inode_write_at (inode, header, sizeof *header, 0) == sizeof *header;
+
+ done:
+  free (header);
+  free (lo);
+  free (hi);
+  return success;
+}
+
+/* Writes E into a free slot of its bucket in hashed directory
+   INODE, which has CNT buckets, splitting buckets until there is
+   one.  Returns true if successful, false on failure. */
+static bool
+add_hashed (struct inode *inode, const struct dir_entry *e, size_t cnt)
+{
+  struct dir_bucket *bucket = malloc (sizeof *bucket);
+  bool success = false;
+  size_t i;
+
+  if (bucket == NULL)
+    return false;
+
+  for (;;)
+    {
+      size_t b = hash_string (e->name) & (cnt - 1);
+      off_t ofs = bucket_ofs (b);
+
+      if (inode_read_at (inode, bucket, sizeof *bucket, ofs) != sizeof *bucket)
+        break;
+      for (i = 0; i < BUCKET_ENTRIES; i++)
+        if (!is_live (&bucket->entries[i], b, cnt))
+          break;
+      if (i < BUCKET_ENTRIES)
+        {
+          ofs += i * sizeof *e;
+          success = inode_write_at (inode, e, sizeof *e, ofs) == sizeof *e;
+          break;
+        }
+      if (!split (inode, cnt))
+        break;
+      cnt *= 2;
+    }
+
+  free (bucket);
+  return success;
+}
+
+/* Converts linear directory INODE to the hashed format with
+   MIN_BUCKETS buckets.  A linear directory holds no more entries
+   than a single bucket, so each bucket has room for all of the
+   entries that hash to it.  The buckets are filled in first and
+   the header, which replaces the linear entries, is written last.
+   Returns true if successful, false on failure, in which case the
+   directory is still linear. */
+static bool
+convert_to_hashed (struct inode *inode)
+{
+  struct dir_bucket *old, *bucket;
+  struct dir_header *header;
+  off_t length = inode_length (inode);
+  bool success = false;
+  size_t b, i, j;
+
+  if (length > BLOCK_SECTOR_SIZE)
+    length = BLOCK_SECTOR_SIZE;
+  old = calloc (1, sizeof *old);
+  bucket = malloc (sizeof *bucket);
+  header = calloc (1, sizeof *header);
+  if (old == NULL || bucket == NULL || header == NULL
+      || inode_read_at (inode, old, length, 0) != length
+      || !reserve_buckets (inode, MIN_BUCKETS))
+    goto done;
+
+  for (b = 0; b < MIN_BUCKETS; b++)
+    {
+      memset (bucket, 0, sizeof *bucket);
+      for (i = j = 0; i < length / sizeof *old->entries; i++)
+        if (is_live (&old->entries[i], b, MIN_BUCKETS))
+          bucket->entries[j++] = old->entries[i];
+      if (inode_write_at (inode, bucket, sizeof *bucket, bucket_ofs (b))
+          != sizeof *bucket)
+        goto done;
+    }
+
+  header->info.magic = DIR_HASH_MAGIC;
+  header->info.bucket_cnt = MIN_BUCKETS;
+  success = inode_write_at (inode, header, sizeof *header, 0) == sizeof *header;
+
+ done:
+  free (old);
+  free (bucket);
+  free (header);
+  return success;
+}
+
+/* Reads the slot at *POS in directory INODE into *E and advances
+   *POS to the next slot.  In a hashed directory, positions in the
+   header or in the padding at the end of a bucket are skipped
+   over, and an entry that is not live reads as a free slot.
+   Returns false at the end of the directory. */
+static bool
+next_slot (struct inode *inode, off_t *pos, struct dir_entry *e)
+{
+  size_t cnt;
+
+  if (!read_bucket_cnt (inode, &cnt))
+    return false;
+  if (cnt > 0)
+    {
+      if (*pos < bucket_ofs (0))
+        *pos = bucket_ofs (0);
+      else if ((size_t) (*pos % BLOCK_SECTOR_SIZE)
+               >= BUCKET_ENTRIES * sizeof *e)
+        *pos = ROUND_UP (*pos, BLOCK_SECTOR_SIZE);
+      if (*pos >= bucket_ofs (cnt))
+        return false;
+    }
+  else if (*pos + sizeof *e > BLOCK_SECTOR_SIZE)
+    return false;
+  if (inode_read_at (inode, e, sizeof *e, *pos) != sizeof *e)
+    return false;
+  if (cnt > 0 && !is_live (e, *pos / BLOCK_SECTOR_SIZE - 1, cnt))
+    e->in_use = false;
+  *pos += sizeof *e;
+  return true;
+}
@@ -113,6 +113,27 @@ file_write_at (struct file *file, const void *buffer, off_t size,
   return inode_write_at (file->inode, buffer, size, file_ofs);
 }
 
+/* Copies up to SIZE bytes from IN, starting at offset IN_START,
+   to OUT, starting at offset OUT_START, without the data leaving
+   the kernel.  Neither file's current position changes.  Returns
+   the number of bytes actually copied, which may be less than
+   SIZE if end of file is reached in IN or if OUT cannot be
+   written, or -1 if IN and OUT are the same file and the ranges
+   overlap or if memory is short.  IN_START, OUT_START, and SIZE
+   must not be negative. */
+off_t
+file_copy_range (struct file *in, off_t in_start,
+                 struct file *out, off_t out_start, off_t size)
+{
+  /* Two ranges of SIZE bytes overlap if their starts are less
+     than SIZE apart.  Adding SIZE to either could overflow. */
+  off_t distance = (in_start < out_start
+                    ? out_start - in_start : in_start - out_start);
+  if (in->inode == out->inode && distance < size)
+    return -1;
+  return inode_copy_range (in->inode, in_start, out->inode, out_start, size);
+}
+
 /* Prevents write operations on FILE's underlying inode
    until file_allow_write() is called or FILE is closed. */
 void
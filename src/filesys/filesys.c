@@ -6,11 +6,19 @@
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
 #include "filesys/directory.h"
+#include "filesys/journal.h"
+#include "threads/thread.h"
 
 /* Partition that contains the file system. */
 struct block *fs_device;
 
+/* Number of entries a new directory has room for. */
+#define DIR_ENTRY_CNT 16
+
 static void do_format (void);
+static bool create (const char *path, off_t initial_size, bool is_dir);
+static struct inode *open_inode (const char *path);
+static struct dir *resolve (const char *path, char name[NAME_MAX + 1]);
 
 /* Initializes the file system module.
    If FORMAT is true, reformats the file system. */
@@ -22,7 +30,9 @@ filesys_init (bool format)
     PANIC ("No file system device found, can't initialize file system.");
 
   inode_init ();
+  dir_init ();
   free_map_init ();
+  journal_init (format);
 
   if (format) 
     do_format ();
@@ -36,29 +46,43 @@ void
 filesys_done (void) 
 {
   free_map_close ();
+  journal_done ();
 }
 
 /* Creates a file named NAME with the given INITIAL_SIZE.
+   NAME may be an absolute path or one relative to the current
+   thread's working directory.
    Returns true if successful, false otherwise.
    Fails if a file named NAME already exists,
    or if internal memory allocation fails. */
 bool
 filesys_create (const char *name, off_t initial_size) 
 {
-  block_sector_t inode_sector = 0;
-  struct dir *dir = dir_open_root ();
-  bool success = (dir != NULL
-                  && free_map_allocate (1, &inode_sector)
-                  && inode_create (inode_sector, initial_size)
-                  && dir_add (dir, name, inode_sector));
-  if (!success && inode_sector != 0) 
-    free_map_release (inode_sector, 1);
-  dir_close (dir);
+  bool success;
+
+  journal_begin ();
+  success = create (name, initial_size, false);
+  journal_end ();
+  return success;
+}
+
+/* Creates an empty directory named NAME.
+   Returns true if successful, false otherwise.
+   Fails if a file named NAME already exists, if any directory
+   leading up to it does not exist, or if internal memory
+   allocation fails. */
+bool
+filesys_mkdir (const char *name)
+{
+  bool success;
 
+  journal_begin ();
+  success = create (name, 0, true);
+  journal_end ();
   return success;
 }
 
-/* Opens the file with the given NAME.
+/* Opens the file or directory with the given NAME.
    Returns the new file if successful or a null pointer
    otherwise.
    Fails if no file named NAME exists,
@@ -66,38 +90,217 @@ filesys_create (const char *name, off_t initial_size)
 struct file *
 filesys_open (const char *name)
 {
-  struct dir *dir = dir_open_root ();
-  struct inode *inode = NULL;
-
-  if (dir != NULL)
-    dir_lookup (dir, name, &inode);
-  dir_close (dir);
-
-  return file_open (inode);
+  return file_open (open_inode (name));
 }
 
-/* Deletes the file named NAME.
+/* Deletes the file or empty directory named NAME.
    Returns true if successful, false on failure.
-   Fails if no file named NAME exists,
-   or if an internal memory allocation fails. */
+   Fails if no file named NAME exists, if NAME is a directory
+   that is not empty, or if an internal memory allocation
+   fails. */
 bool
 filesys_remove (const char *name) 
 {
-  struct dir *dir = dir_open_root ();
-  bool success = dir != NULL && dir_remove (dir, name);
+  char part[NAME_MAX + 1];
+  struct dir *dir;
+  bool success;
+
+  journal_begin ();
+  dir = resolve (name, part);
+  success = dir != NULL && dir_remove (dir, part);
   dir_close (dir); 
+  journal_end ();
 
   return success;
 }
+
+/* Makes the directory named NAME the current thread's working
+   directory.  Returns true if successful, false if NAME does not
+   exist or is not a directory. */
+bool
+filesys_chdir (const char *name)
+{
+  struct thread *t = thread_current ();
+  struct inode *inode = open_inode (name);
+  struct dir *dir;
+
+  if (inode == NULL || !inode_is_dir (inode))
+    {
+      inode_close (inode);
+      return false;
+    }
+  dir = dir_open (inode);
+  if (dir == NULL)
+    return false;
+
+  dir_close (t->cwd);
+  t->cwd = dir;
+  return true;
+}
 
 /* Formats the file system. */
 static void
 do_format (void)
 {
   printf ("Formatting file system...");
+  journal_begin ();
   free_map_create ();
-  if (!dir_create (ROOT_DIR_SECTOR, 16))
+  if (!dir_create (ROOT_DIR_SECTOR, DIR_ENTRY_CNT, ROOT_DIR_SECTOR))
     PANIC ("root directory creation failed");
+  journal_end ();
   free_map_close ();
   printf ("done.\n");
 }
+
+/* Creates a file, or a directory if IS_DIR is true, at PATH.
+   Files get INITIAL_SIZE bytes of zeros. */
+static bool
+create (const char *path, off_t initial_size, bool is_dir)
+{
+  char name[NAME_MAX + 1];
+  block_sector_t inode_sector = 0;
+  struct dir *dir = resolve (path, name);
+  bool success = false;
+
+  if (dir != NULL && free_map_allocate (1, &inode_sector))
+    {
+      block_sector_t parent_sector = inode_get_inumber (dir_get_inode (dir));
+      if (is_dir
+          ? dir_create (inode_sector, DIR_ENTRY_CNT, parent_sector)
+          : inode_create (inode_sector, initial_size, false))
+        {
+          success = dir_add (dir, name, inode_sector);
+          if (!success)
+            {
+              /* Removing the inode releases its data as well as
+                 INODE_SECTOR itself. */
+              struct inode *inode = inode_open (inode_sector);
+              if (inode != NULL)
+                {
+                  inode_remove (inode);
+                  inode_close (inode);
+                }
+            }
+        }
+      else
+        free_map_release (inode_sector, 1);
+    }
+  dir_close (dir);
+
+  return success;
+}
+
+/* Opens and returns the inode for the file or directory at PATH,
+   or a null pointer if there is none. */
+static struct inode *
+open_inode (const char *path)
+{
+  char name[NAME_MAX + 1];
+  struct dir *dir = resolve (path, name);
+  struct inode *inode = NULL;
+
+  if (dir != NULL)
+    {
+      if (!strcmp (name, "."))
+        {
+          if (!inode_is_removed (dir_get_inode (dir)))
+            inode = inode_reopen (dir_get_inode (dir));
+        }
+      else
+        dir_lookup (dir, name, &inode);
+    }
+  dir_close (dir);
+
+  return inode;
+}
+
+/* Extracts a file name part from *SRCP into PART, and updates
+   *SRCP so that the next call will return the next file name
+   part.  Returns 1 if successful, 0 at end of string, -1 for a
+   too-long file name part. */
+static int
+get_next_part (char part[NAME_MAX + 1], const char **srcp)
+{
+  const char *src = *srcp;
+  char *dst = part;
+
+  /* Skip leading slashes.  If it's all slashes, we're done. */
+  while (*src == '/')
+    src++;
+  if (*src == '\0')
+    return 0;
+
+  /* Copy up to NAME_MAX characters from SRC to DST.  Add null
+     terminator. */
+  while (*src != '/' && *src != '\0')
+    {
+      if (dst < part + NAME_MAX)
+        *dst++ = *src;
+      else
+        return -1;
+      src++;
+    }
+  *dst = '\0';
+
+  /* Advance source pointer. */
+  *srcp = src;
+  return 1;
+}
+
+/* Looks up PATH, which is absolute or relative to the current
+   thread's working directory, and opens the directory that
+   contains its last component.  Stores the last component in
+   NAME, or "." if PATH has none (e.g. "/").  Returns the opened
+   directory, which the caller must close, or a null pointer if
+   PATH is empty or a directory along the way does not exist. */
+static struct dir *
+resolve (const char *path, char name[NAME_MAX + 1])
+{
+  struct thread *t = thread_current ();
+  char part[NAME_MAX + 1];
+  bool have_name = false;
+  struct dir *dir;
+  int result;
+
+  if (*path == '\0')
+    return NULL;
+
+  if (*path == '/' || t->cwd == NULL)
+    dir = dir_open_root ();
+  else
+    dir = dir_reopen (t->cwd);
+  if (dir == NULL)
+    return NULL;
+
+  while ((result = get_next_part (part, &path)) > 0)
+    {
+      /* Descend into the previous component, now that we know
+         it is not the last one. */
+      if (have_name && strcmp (name, "."))
+        {
+          struct inode *inode;
+
+          if (!dir_lookup (dir, name, &inode) || !inode_is_dir (inode))
+            {
+              inode_close (inode);
+              dir_close (dir);
+              return NULL;
+            }
+          dir_close (dir);
+          dir = dir_open (inode);
+          if (dir == NULL)
+            return NULL;
+        }
+      strlcpy (name, part, NAME_MAX + 1);
+      have_name = true;
+    }
+
+  if (result < 0)
+    {
+      dir_close (dir);
+      return NULL;
+    }
+  if (!have_name)
+    strlcpy (name, ".", NAME_MAX + 1);
+  return dir;
+}
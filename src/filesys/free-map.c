@@ -1,22 +1,51 @@
 #include "filesys/free-map.h"
 #include <bitmap.h>
 #include <debug.h>
+#include <list.h>
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "filesys/journal.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
 
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per sector. */
+static struct bitmap *busy_map;      /* Sectors that may not be allocated. */
+static struct list pending_list;     /* Releases not yet committed. */
+static struct lock free_map_lock;    /* Guards all of the above. */
+
+/* Sectors released by a journal transaction that has not
+   committed yet.  They are free in free_map, which is what goes
+   to disk, but stay set in busy_map until the release commits:
+   otherwise a crash could leave their old owner, still on disk,
+   sharing them with a new one. */
+struct pending_release
+  {
+    struct list_elem elem;           /* Element in pending_list. */
+    block_sector_t sector;           /* First sector released. */
+    size_t cnt;                      /* Number of sectors released. */
+    uint32_t seq;                    /* Releasing transaction. */
+  };
+
+static void reclaim_released (void);
 
 /* Initializes the free map. */
 void
 free_map_init (void) 
 {
   free_map = bitmap_create (block_size (fs_device));
-  if (free_map == NULL)
+  busy_map = bitmap_create (block_size (fs_device));
+  if (free_map == NULL || busy_map == NULL)
     PANIC ("bitmap creation failed--file system device is too large");
   bitmap_mark (free_map, FREE_MAP_SECTOR);
   bitmap_mark (free_map, ROOT_DIR_SECTOR);
+  bitmap_set_multiple (free_map, JOURNAL_SECTOR, JOURNAL_SECTORS, true);
+  bitmap_mark (busy_map, FREE_MAP_SECTOR);
+  bitmap_mark (busy_map, ROOT_DIR_SECTOR);
+  bitmap_set_multiple (busy_map, JOURNAL_SECTOR, JOURNAL_SECTORS, true);
+  list_init (&pending_list);
+  lock_init (&free_map_lock);
 }
 
 /* Allocates CNT consecutive sectors from the free map and stores
@@ -27,26 +56,75 @@ free_map_init (void)
 bool
 free_map_allocate (size_t cnt, block_sector_t *sectorp)
 {
-  block_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
-  if (sector != BITMAP_ERROR
-      && free_map_file != NULL
-      && !bitmap_write (free_map, free_map_file))
+  block_sector_t sector;
+
+  lock_acquire (&free_map_lock);
+  reclaim_released ();
+  sector = bitmap_scan_and_flip (busy_map, 0, cnt, false);
+  if (sector != BITMAP_ERROR)
     {
-      bitmap_set_multiple (free_map, sector, cnt, false); 
-      sector = BITMAP_ERROR;
+      bitmap_set_multiple (free_map, sector, cnt, true);
+      if (free_map_file != NULL && !bitmap_write (free_map, free_map_file))
+        {
+          bitmap_set_multiple (free_map, sector, cnt, false); 
+          bitmap_set_multiple (busy_map, sector, cnt, false); 
+          sector = BITMAP_ERROR;
+        }
     }
+  lock_release (&free_map_lock);
   if (sector != BITMAP_ERROR)
     *sectorp = sector;
   return sector != BITMAP_ERROR;
 }
 
-/* Makes CNT sectors starting at SECTOR available for use. */
+/* Makes CNT sectors starting at SECTOR available for use once
+   the running journal transaction commits. */
 void
 free_map_release (block_sector_t sector, size_t cnt)
 {
+  struct pending_release *p;
+
+  if (cnt == 0)
+    return;
+
+  lock_acquire (&free_map_lock);
   ASSERT (bitmap_all (free_map, sector, cnt));
+  journal_revoke (sector, cnt);
   bitmap_set_multiple (free_map, sector, cnt, false);
   bitmap_write (free_map, free_map_file);
+
+  /* If there is no memory to remember the release, the sectors
+     just stay busy until the free map is next read from disk. */
+  p = malloc (sizeof *p);
+  if (p != NULL)
+    {
+      p->sector = sector;
+      p->cnt = cnt;
+      p->seq = journal_seq ();
+      list_push_back (&pending_list, &p->elem);
+    }
+  lock_release (&free_map_lock);
+}
+
+/* Makes the sectors of every committed release allocatable.
+   The caller must hold free_map_lock. */
+static void
+reclaim_released (void)
+{
+  struct list_elem *e = list_begin (&pending_list);
+
+  while (e != list_end (&pending_list))
+    {
+      struct pending_release *p = list_entry (e, struct pending_release,
+                                              elem);
+      e = list_next (e);
+      if (journal_is_committed (p->seq))
+        {
+          bitmap_set_multiple (busy_map, p->sector, p->cnt, false);
+          list_remove (&p->elem);
+          free (p);
+        }
+    }
 }
 
 /* Opens the free map file and reads it from disk. */
@@ -56,7 +134,8 @@ free_map_open (void)
   free_map_file = file_open (inode_open (FREE_MAP_SECTOR));
   if (free_map_file == NULL)
     PANIC ("can't open free map");
-  if (!bitmap_read (free_map, free_map_file))
+  if (!bitmap_read (free_map, free_map_file)
+      || !bitmap_read (busy_map, free_map_file))
     PANIC ("can't read free map");
 }
 
@@ -73,7 +152,7 @@ void
 free_map_create (void) 
 {
   /* Create inode. */
-  if (!inode_create (FREE_MAP_SECTOR, bitmap_file_size (free_map)))
+  if (!inode_create (FREE_MAP_SECTOR, bitmap_file_size (free_map), false))
     PANIC ("free map creation failed");
 
   /* Write bitmap to file. */
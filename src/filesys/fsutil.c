@@ -1,5 +1,6 @@
 #include "filesys/fsutil.h"
 #include <debug.h>
+#include <round.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -79,7 +80,7 @@ fsutil_extract (char **argv UNUSED)
 
   /* Allocate buffers. */
   header = malloc (BLOCK_SECTOR_SIZE);
-  data = malloc (BLOCK_SECTOR_SIZE);
+  data = malloc (PGSIZE);
   if (header == NULL || data == NULL)
     PANIC ("couldn't allocate buffers");
 
@@ -110,7 +111,11 @@ fsutil_extract (char **argv UNUSED)
           break;
         }
       else if (type == USTAR_DIRECTORY)
-        printf ("ignoring directory %s\n", file_name);
+        {
+          printf ("Creating directory '%s'...\n", file_name);
+          if (!filesys_mkdir (file_name))
+            PANIC ("%s: mkdir failed", file_name);
+        }
       else if (type == USTAR_REGULAR)
         {
           struct file *dst;
@@ -124,13 +129,14 @@ fsutil_extract (char **argv UNUSED)
           if (dst == NULL)
             PANIC ("%s: open failed", file_name);
 
-          /* Do copy. */
+          /* Do copy, up to a page at a time. */
           while (size > 0)
             {
-              int chunk_size = (size > BLOCK_SECTOR_SIZE
-                                ? BLOCK_SECTOR_SIZE
-                                : size);
-              block_read (src, sector++, data);
+              int chunk_size = size > PGSIZE ? PGSIZE : size;
+              size_t chunk_sectors = DIV_ROUND_UP (chunk_size,
+                                                   BLOCK_SECTOR_SIZE);
+              block_read_multiple (src, sector, chunk_sectors, data);
+              sector += chunk_sectors;
               if (file_write (dst, data, chunk_size) != chunk_size)
                 PANIC ("%s: write failed with %d bytes unwritten",
                        file_name, size);
@@ -1,11 +1,15 @@
 #include "filesys/inode.h"
-#include <list.h>
+#include <hash.h>
 #include <debug.h>
 #include <round.h>
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "filesys/journal.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -17,9 +21,13 @@ struct inode_disk
     block_sector_t start;               /* First data sector. */
     off_t length;                       /* File size in bytes. */
     unsigned magic;                     /* Magic number. */
-    uint32_t unused[125];               /* Not used. */
+    uint32_t is_dir;                    /* 1 if a directory, 0 if a file. */
+    uint32_t unused[124];               /* Not used. */
   };
 
+static bool is_metadata (const struct inode *);
+static off_t read_at (struct inode *, uint8_t *, off_t size, off_t offset);
+
 /* Returns the number of sectors to allocate for an inode SIZE
    bytes long. */
 static inline size_t
@@ -28,14 +36,24 @@ bytes_to_sectors (off_t size)
   return DIV_ROUND_UP (size, BLOCK_SECTOR_SIZE);
 }
 
+/* What open_inodes indexes an inode by.  Kept apart from the
+   rest of the inode so that lookups can use a small key. */
+struct inode_key
+  {
+    struct hash_elem elem;              /* Element in open_inodes. */
+    block_sector_t sector;              /* Sector number of disk location. */
+  };
+
 /* In-memory inode. */
 struct inode 
   {
-    struct list_elem elem;              /* Element in inode list. */
-    block_sector_t sector;              /* Sector number of disk location. */
+    struct inode_key key;               /* Hash element and sector. */
+    bool loading;                       /* DATA not read in yet? */
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+    struct rwlock rw;                   /* Guards data, length and
+                                           deny_write_cnt. */
     struct inode_disk data;             /* Inode content. */
   };
 
@@ -53,24 +71,35 @@ byte_to_sector (const struct inode *inode, off_t pos)
     return -1;
 }
 
-/* List of open inodes, so that opening a single inode twice
-   returns the same `struct inode'. */
-static struct list open_inodes;
+/* Open inodes, hashed by sector, so that opening a single inode
+   twice returns the same `struct inode'. */
+static struct hash open_inodes;
+
+/* Protects open_inodes and every inode's open_cnt and loading. */
+static struct lock open_inodes_lock;
+
+/* Signaled when an inode has been read in. */
+static struct condition inode_loaded;
+
+static hash_hash_func inode_hash_func;
+static hash_less_func inode_less_func;
 
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
-  list_init (&open_inodes);
+  hash_init (&open_inodes, inode_hash_func, inode_less_func, NULL);
+  lock_init (&open_inodes_lock);
+  cond_init (&inode_loaded);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
    writes the new inode to sector SECTOR on the file system
-   device.
+   device.  IS_DIR marks the inode as holding a directory.
    Returns true if successful.
    Returns false if memory or disk allocation fails. */
 bool
-inode_create (block_sector_t sector, off_t length)
+inode_create (block_sector_t sector, off_t length, bool is_dir)
 {
   struct inode_disk *disk_inode = NULL;
   bool success = false;
@@ -87,18 +116,22 @@ inode_create (block_sector_t sector, off_t length)
       size_t sectors = bytes_to_sectors (length);
       disk_inode->length = length;
       disk_inode->magic = INODE_MAGIC;
+      disk_inode->is_dir = is_dir;
       if (free_map_allocate (sectors, &disk_inode->start)) 
         {
-          block_write (fs_device, sector, disk_inode);
           if (sectors > 0) 
             {
               static char zeros[BLOCK_SECTOR_SIZE];
               size_t i;
               
+              /* Nothing refers to the new data until the inode
+                 itself commits, so it need not be logged. */
               for (i = 0; i < sectors; i++) 
-                block_write (fs_device, disk_inode->start + i, zeros);
+                journal_write (disk_inode->start + i, zeros, false);
             }
-          success = true; 
+          success = journal_write (sector, disk_inode, true);
+          if (!success)
+            free_map_release (disk_inode->start, sectors);
         } 
       free (disk_inode);
     }
@@ -111,33 +144,53 @@ inode_create (block_sector_t sector, off_t length)
 struct inode *
 inode_open (block_sector_t sector)
 {
-  struct list_elem *e;
+  struct inode_key key;
+  struct hash_elem *e;
   struct inode *inode;
 
-  /* Check whether this inode is already open. */
-  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-       e = list_next (e)) 
+  lock_acquire (&open_inodes_lock);
+
+  /* Check whether this inode is already open, waiting for it
+     if another thread is still reading it in. */
+  key.sector = sector;
+  e = hash_find (&open_inodes, &key.elem);
+  if (e != NULL)
     {
-      inode = list_entry (e, struct inode, elem);
-      if (inode->sector == sector) 
-        {
-          inode_reopen (inode);
-          return inode; 
-        }
+      inode = hash_entry (e, struct inode, key.elem);
+      inode->open_cnt++;
+      while (inode->loading)
+        cond_wait (&inode_loaded, &open_inodes_lock);
+      lock_release (&open_inodes_lock);
+      return inode;
     }
 
   /* Allocate memory. */
   inode = malloc (sizeof *inode);
   if (inode == NULL)
-    return NULL;
+    {
+      lock_release (&open_inodes_lock);
+      return NULL;
+    }
 
-  /* Initialize. */
-  list_push_front (&open_inodes, &inode->elem);
-  inode->sector = sector;
+  /* Initialize.  The inode goes into the table marked as
+     loading and is read in without the lock, so that other opens
+     need not wait for the disk; openers of the same sector wait
+     above until it is done. */
+  inode->key.sector = sector;
+  inode->loading = true;
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
-  block_read (fs_device, inode->sector, &inode->data);
+  rwlock_init (&inode->rw);
+  hash_insert (&open_inodes, &inode->key.elem);
+  lock_release (&open_inodes_lock);
+
+  journal_read (sector, &inode->data, true);
+
+  lock_acquire (&open_inodes_lock);
+  inode->loading = false;
+  cond_broadcast (&inode_loaded, &open_inodes_lock);
+  lock_release (&open_inodes_lock);
   return inode;
 }
 
@@ -146,7 +199,11 @@ struct inode *
 inode_reopen (struct inode *inode)
 {
   if (inode != NULL)
-    inode->open_cnt++;
+    {
+      lock_acquire (&open_inodes_lock);
+      inode->open_cnt++;
+      lock_release (&open_inodes_lock);
+    }
   return inode;
 }
 
@@ -154,7 +211,7 @@ inode_reopen (struct inode *inode)
 block_sector_t
 inode_get_inumber (const struct inode *inode)
 {
-  return inode->sector;
+  return inode->key.sector;
 }
 
 /* Closes INODE and writes it to disk.
@@ -168,21 +225,27 @@ inode_close (struct inode *inode)
     return;
 
   /* Release resources if this was the last opener. */
+  lock_acquire (&open_inodes_lock);
   if (--inode->open_cnt == 0)
     {
-      /* Remove from inode list and release lock. */
-      list_remove (&inode->elem);
+      /* Remove from inode table and release lock. */
+      hash_delete (&open_inodes, &inode->key.elem);
+      lock_release (&open_inodes_lock);
  
       /* Deallocate blocks if removed. */
       if (inode->removed) 
         {
-          free_map_release (inode->sector, 1);
+          journal_begin ();
+          free_map_release (inode->key.sector, 1);
           free_map_release (inode->data.start,
                             bytes_to_sectors (inode->data.length)); 
+          journal_end ();
         }
 
       free (inode); 
     }
+  else
+    lock_release (&open_inodes_lock);
 }
 
 /* Marks INODE to be deleted when it is closed by the last caller who
@@ -194,16 +257,72 @@ inode_remove (struct inode *inode)
   inode->removed = true;
 }
 
+/* Returns true if INODE has been removed but is still open. */
+bool
+inode_is_removed (const struct inode *inode)
+{
+  return inode->removed;
+}
+
+/* Returns true if INODE holds a directory, false if it holds an
+   ordinary file.  This never changes after creation, so no lock
+   is needed. */
+bool
+inode_is_dir (const struct inode *inode)
+{
+  return inode->data.is_dir != 0;
+}
+
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
    Returns the number of bytes actually read, which may be less
-   than SIZE if an error occurs or end of file is reached. */
+   than SIZE if an error occurs or end of file is reached.
+
+   A page fault on BUFFER while INODE is locked could need INODE
+   itself, to write back an evicted page of a shared mapping of
+   it, so a user BUFFER is filled a page at a time from a kernel
+   page after the lock is dropped.  The system calls also pin
+   their buffers, so if no page is free the read goes straight
+   to BUFFER. */
 off_t
 inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) 
 {
   uint8_t *buffer = buffer_;
+  off_t bytes_read = 0;
+  uint8_t *page;
+
+  if (!is_user_vaddr (buffer)
+      || (page = palloc_get_page (0)) == NULL)
+    return read_at (inode, buffer, size, offset);
+
+  while (size > 0)
+    {
+      off_t chunk_size = size < PGSIZE ? size : PGSIZE;
+      off_t chunk_read = read_at (inode, page, chunk_size, offset);
+
+      memcpy (buffer + bytes_read, page, chunk_read);
+      bytes_read += chunk_read;
+      if (chunk_read < chunk_size)
+        break;
+
+      /* Advance. */
+      size -= chunk_size;
+      offset += chunk_size;
+    }
+  palloc_free_page (page);
+
+  return bytes_read;
+}
+
+/* Does the work of inode_read_at(), with INODE locked for
+   reading throughout. */
+static off_t
+read_at (struct inode *inode, uint8_t *buffer, off_t size, off_t offset)
+{
   off_t bytes_read = 0;
   uint8_t *bounce = NULL;
+  bool metadata = is_metadata (inode);
 
+  rwlock_acquire_read (&inode->rw);
   while (size > 0) 
     {
       /* Disk sector to read, starting byte offset within sector. */
@@ -211,7 +330,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
 
       /* Bytes left in inode, bytes left in sector, lesser of the two. */
-      off_t inode_left = inode_length (inode) - offset;
+      off_t inode_left = inode->data.length - offset;
       int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
       int min_left = inode_left < sector_left ? inode_left : sector_left;
 
@@ -222,8 +341,15 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
 
       if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
         {
-          /* Read full sector directly into caller's buffer. */
-          block_read (fs_device, sector_idx, buffer + bytes_read);
+          /* Read as many full sectors as possible directly into
+             caller's buffer.  An inode's data is contiguous, so
+             they form a single request. */
+          off_t left = size < inode_left ? size : inode_left;
+          size_t cnt = left / BLOCK_SECTOR_SIZE;
+
+          journal_read_multiple (sector_idx, cnt, buffer + bytes_read,
+                                 metadata);
+          chunk_size = cnt * BLOCK_SECTOR_SIZE;
         }
       else 
         {
@@ -235,7 +361,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
               if (bounce == NULL)
                 break;
             }
-          block_read (fs_device, sector_idx, bounce);
+          journal_read (sector_idx, bounce, metadata);
           memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
         }
       
@@ -244,6 +370,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       offset += chunk_size;
       bytes_read += chunk_size;
     }
+  rwlock_release_read (&inode->rw);
   free (bounce);
 
   return bytes_read;
@@ -261,9 +388,14 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
   const uint8_t *buffer = buffer_;
   off_t bytes_written = 0;
   uint8_t *bounce = NULL;
+  bool metadata = is_metadata (inode);
 
+  rwlock_acquire_write (&inode->rw);
   if (inode->deny_write_cnt)
-    return 0;
+    {
+      rwlock_release_write (&inode->rw);
+      return 0;
+    }
 
   while (size > 0) 
     {
@@ -272,7 +404,7 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
 
       /* Bytes left in inode, bytes left in sector, lesser of the two. */
-      off_t inode_left = inode_length (inode) - offset;
+      off_t inode_left = inode->data.length - offset;
       int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
       int min_left = inode_left < sector_left ? inode_left : sector_left;
 
@@ -283,8 +415,21 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 
       if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
         {
-          /* Write full sector directly to disk. */
-          block_write (fs_device, sector_idx, buffer + bytes_written);
+          /* Write as many full sectors as possible directly to
+             disk, as a single request.  Only a metadata write can
+             fall short, if the journal refuses it. */
+          off_t left = size < inode_left ? size : inode_left;
+          size_t cnt = left / BLOCK_SECTOR_SIZE;
+          size_t written = journal_write_multiple (sector_idx, cnt,
+                                                   buffer + bytes_written,
+                                                   metadata);
+
+          bytes_written += written * BLOCK_SECTOR_SIZE;
+          if (written < cnt)
+            break;
+          size -= cnt * BLOCK_SECTOR_SIZE;
+          offset += cnt * BLOCK_SECTOR_SIZE;
+          continue;
         }
       else 
         {
@@ -300,11 +445,12 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
              we're writing, then we need to read in the sector
              first.  Otherwise we start with a sector of all zeros. */
           if (sector_ofs > 0 || chunk_size < sector_left) 
-            block_read (fs_device, sector_idx, bounce);
+            journal_read (sector_idx, bounce, metadata);
           else
             memset (bounce, 0, BLOCK_SECTOR_SIZE);
           memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-          block_write (fs_device, sector_idx, bounce);
+          if (!journal_write (sector_idx, bounce, metadata))
+            break;
         }
 
       /* Advance. */
@@ -312,18 +458,68 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       offset += chunk_size;
       bytes_written += chunk_size;
     }
+  rwlock_release_write (&inode->rw);
   free (bounce);
 
   return bytes_written;
 }
 
+/* Copies up to SIZE bytes from IN, starting at offset IN_OFS, to
+   OUT, starting at offset OUT_OFS, a page at a time through a
+   kernel buffer.  Stops early at the end of IN or if OUT cannot
+   be written.  Returns the number of bytes copied, or -1 if no
+   buffer could be allocated.
+
+   If IN and OUT are the same inode, the two ranges must not
+   overlap. */
+off_t
+inode_copy_range (struct inode *in, off_t in_ofs,
+                  struct inode *out, off_t out_ofs, off_t size)
+{
+  uint8_t *buffer;
+  off_t bytes_copied = 0;
+
+  ASSERT (in != out || (in_ofs < out_ofs
+                        ? out_ofs - in_ofs : in_ofs - out_ofs) >= size);
+
+  /* A whole, page-aligned buffer lets sector-aligned chunks go
+     straight to and from the device in multi-sector requests. */
+  buffer = palloc_get_page (0);
+  if (buffer == NULL)
+    return -1;
+
+  while (size > 0)
+    {
+      off_t chunk_size = size < PGSIZE ? size : PGSIZE;
+      off_t bytes_read = inode_read_at (in, buffer, chunk_size, in_ofs);
+      off_t bytes_written;
+
+      if (bytes_read == 0)
+        break;
+      bytes_written = inode_write_at (out, buffer, bytes_read, out_ofs);
+      bytes_copied += bytes_written;
+      if (bytes_written < chunk_size)
+        break;
+
+      /* Advance. */
+      size -= chunk_size;
+      in_ofs += chunk_size;
+      out_ofs += chunk_size;
+    }
+  palloc_free_page (buffer);
+
+  return bytes_copied;
+}
+
 /* Disables writes to INODE.
    May be called at most once per inode opener. */
 void
 inode_deny_write (struct inode *inode) 
 {
+  rwlock_acquire_write (&inode->rw);
   inode->deny_write_cnt++;
   ASSERT (inode->deny_write_cnt <= inode->open_cnt);
+  rwlock_release_write (&inode->rw);
 }
 
 /* Re-enables writes to INODE.
@@ -332,14 +528,118 @@ inode_deny_write (struct inode *inode)
 void
 inode_allow_write (struct inode *inode) 
 {
+  rwlock_acquire_write (&inode->rw);
   ASSERT (inode->deny_write_cnt > 0);
   ASSERT (inode->deny_write_cnt <= inode->open_cnt);
   inode->deny_write_cnt--;
+  rwlock_release_write (&inode->rw);
 }
 
 /* Returns the length, in bytes, of INODE's data. */
 off_t
-inode_length (const struct inode *inode)
+inode_length (struct inode *inode)
+{
+  off_t length;
+
+  rwlock_acquire_read (&inode->rw);
+  length = inode->data.length;
+  rwlock_release_read (&inode->rw);
+  return length;
+}
+
+/* Grows INODE to LENGTH bytes, which must not be less than its
+   current length.  The new bytes read as zeros.  Because an
+   inode's data is one contiguous run of sectors, growing past
+   the sectors already allocated moves the data to a new run.
+   Returns true if successful, false if no run of the needed
+   size is free or the journal refuses the update. */
+bool
+inode_extend (struct inode *inode, off_t length)
+{
+  static char zeros[BLOCK_SECTOR_SIZE];
+  block_sector_t old_start;
+  off_t old_length;
+  size_t old_sectors, new_sectors;
+  bool metadata = is_metadata (inode);
+  block_sector_t start;
+  bool success = false;
+  void *buffer = NULL;
+  size_t i;
+
+  rwlock_acquire_write (&inode->rw);
+  ASSERT (length >= inode->data.length);
+
+  old_start = inode->data.start;
+  old_length = inode->data.length;
+  old_sectors = bytes_to_sectors (inode->data.length);
+  new_sectors = bytes_to_sectors (length);
+  if (new_sectors > old_sectors)
+    {
+      if (old_sectors > 0)
+        {
+          buffer = malloc (BLOCK_SECTOR_SIZE);
+          if (buffer == NULL)
+            goto done;
+        }
+      if (!free_map_allocate (new_sectors, &start))
+        goto done;
+
+      /* Nothing refers to the new run until the inode itself
+         commits, so it need not be logged. */
+      for (i = 0; i < old_sectors; i++)
+        {
+          journal_read (inode->data.start + i, buffer, metadata);
+          journal_write (start + i, buffer, false);
+        }
+      for (; i < new_sectors; i++)
+        journal_write (start + i, zeros, false);
+      inode->data.start = start;
+    }
+  inode->data.length = length;
+
+  /* Give up the old run only once the journal has accepted the
+     inode that no longer refers to it. */
+  if (!journal_write (inode->key.sector, &inode->data, true))
+    {
+      if (new_sectors > old_sectors)
+        free_map_release (start, new_sectors);
+      inode->data.start = old_start;
+      inode->data.length = old_length;
+      goto done;
+    }
+  if (new_sectors > old_sectors && old_sectors > 0)
+    free_map_release (old_start, old_sectors);
+  success = true;
+
+ done:
+  rwlock_release_write (&inode->rw);
+  free (buffer);
+  return success;
+}
+
+/* Returns true if INODE's data is file system metadata, which
+   is written through the journal: directories and the free map. */
+static bool
+is_metadata (const struct inode *inode)
+{
+  return inode_is_dir (inode) || inode->key.sector == FREE_MAP_SECTOR;
+}
+
+/* Returns a hash value for the inode key that contains E. */
+static unsigned
+inode_hash_func (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct inode_key *key = hash_entry (e, struct inode_key, elem);
+  return hash_int (key->sector);
+}
+
+/* Returns true if the inode key containing A precedes the one
+   containing B, ordering by sector. */
+static bool
+inode_less_func (const struct hash_elem *a, const struct hash_elem *b,
+                 void *aux UNUSED)
 {
-  return inode->data.length;
+  const struct inode_key *ka = hash_entry (a, struct inode_key, elem);
+  const struct inode_key *kb = hash_entry (b, struct inode_key, elem);
+  return ka->sector < kb->sector;
 }
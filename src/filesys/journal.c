@@ -0,0 +1,704 @@
+#include "filesys/journal.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/filesys.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+
+/* Write-ahead metadata journal.
+
+   Inode sectors, directory data and the free map are never
+   written in place directly.  The writes made between
+   journal_begin() and journal_end() form a transaction, which is
+   appended to a log in the JOURNAL_SECTORS sectors starting at
+   JOURNAL_SECTOR and reaches its home locations only at the next
+   checkpoint.  Until then the latest image of each logged sector
+   is kept in memory, and journal_read() returns it instead of the
+   stale copy on disk.  Regular file data is not journaled at all
+   and goes straight to the device.
+
+   Concurrent callers share one running transaction, which
+   commits when the last of them calls journal_end(), so updates
+   made together reach the log together.  Committing first copies
+   the transaction into a log buffer and starts the next one, and
+   only then writes the buffer out, so journal_lock is never held
+   during disk I/O.  A checkpoint happens only when the log fills
+   up or the file system is shut down.  It replays the log exactly
+   as recovery does at mount time, so mounting costs at most one
+   log's worth of I/O.
+
+   A transaction is never split or written in place: once it has
+   MAX_TXN_SECTORS sectors, further metadata writes to new sectors
+   are refused, and the operation making them fails.
+
+   When a logged sector is freed, it may next hold file data,
+   which replaying an older copy of it would overwrite.  Freeing
+   therefore logs a revocation, and replay skips every copy of a
+   sector logged no later than its revocation.
+
+   Layout of the log:
+
+     sector 0:          struct journal_header
+     then, for each committed transaction:
+       one or more DESC records, each followed by the sectors
+         it lists
+       zero or more REVOKE records, each listing sectors that
+         the transaction revoked
+       a COMMIT record
+
+   A transaction is replayed only if its COMMIT record reached
+   the disk.  Transactions are numbered consecutively from the
+   header's sequence number, so a record left over from before
+   the last checkpoint has an older number and marks the end of
+   the log. */
+
+/* Magic numbers identifying journal sectors. */
+#define JOURNAL_MAGIC 0x4c4e524a
+#define DESC_MAGIC 0x43534544
+#define REVOKE_MAGIC 0x4b564552
+#define COMMIT_MAGIC 0x54494d43
+
+/* Number of sectors a single DESC or REVOKE record can list. */
+#define RECORD_SECTORS 125
+
+/* Maximum number of sectors a transaction may write.  Leaves room
+   in the log for the header, a COMMIT record, a DESC record, and
+   REVOKE records for every other sector that can be logged. */
+#define MAX_TXN_SECTORS (JOURNAL_SECTORS - 6)
+
+/* First sector of the journal.
+   Must be exactly BLOCK_SECTOR_SIZE bytes long. */
+struct journal_header
+  {
+    unsigned magic;                     /* JOURNAL_MAGIC. */
+    uint32_t seq;                       /* First transaction in the log. */
+    uint32_t unused[126];               /* Not used. */
+  };
+
+/* A DESC, REVOKE or COMMIT record.
+   Must be exactly BLOCK_SECTOR_SIZE bytes long. */
+struct journal_record
+  {
+    unsigned magic;                     /* DESC, REVOKE or COMMIT_MAGIC. */
+    uint32_t seq;                       /* Transaction's sequence number. */
+    uint32_t cnt;                       /* Number of sectors listed. */
+    block_sector_t sectors[RECORD_SECTORS]; /* Their home locations. */
+  };
+
+/* Part of an image that find() looks it up by, so that a lookup
+   key need not include a sector's worth of data. */
+struct image_key
+  {
+    struct hash_elem elem;              /* Element in images. */
+    block_sector_t sector;              /* Home location. */
+  };
+
+/* In-memory image of a sector written since the last
+   checkpoint. */
+struct image
+  {
+    struct image_key key;               /* Hash element and sector. */
+    struct list_elem all_elem;          /* Element in all_list. */
+    struct list_elem run_elem;          /* Element in run_list. */
+    uint32_t seq;                       /* Last transaction to write it. */
+    bool revoked;                       /* Freed by running transaction? */
+    uint8_t data[BLOCK_SECTOR_SIZE];    /* Latest contents. */
+  };
+
+static struct hash images;      /* All images, indexed by sector. */
+static struct list all_list;    /* All images. */
+static struct list run_list;    /* Images written by running transaction. */
+
+static uint32_t running_seq;    /* Running transaction's sequence number. */
+static uint32_t durable_seq;    /* Every earlier transaction committed. */
+static int handle_cnt;          /* Callers between begin and end. */
+
+/* Protects all of the above.  Never held during I/O. */
+static struct lock journal_lock;
+
+/* Signaled when a transaction is frozen for commit or has
+   committed. */
+static struct condition txn_changed;
+
+/* Serializes writing to the log, and protects the following. */
+static struct lock log_lock;
+
+static uint32_t log_seq;        /* First transaction in the log. */
+static block_sector_t log_pos;  /* Next free log sector, from JOURNAL_SECTOR. */
+static uint8_t *log_buf;        /* JOURNAL_SECTORS sectors of scratch. */
+static void *scratch;           /* Scratch sector buffer. */
+
+static hash_hash_func image_hash_func;
+static hash_less_func image_less_func;
+static struct image *find (block_sector_t);
+static void commit (void);
+static size_t freeze (void);
+static void checkpoint (void);
+static uint32_t replay (block_sector_t cnt);
+static bool is_revoked (block_sector_t sector, uint32_t seq,
+                        block_sector_t end);
+static void reset_log (uint32_t seq);
+static void drop_images (uint32_t seq);
+
+/* Initializes the journal.  If FORMAT is true, creates an empty
+   journal; otherwise, replays the transactions committed before
+   the file system was last shut down or crashed. */
+void
+journal_init (bool format)
+{
+  ASSERT (sizeof (struct journal_header) == BLOCK_SECTOR_SIZE);
+  ASSERT (sizeof (struct journal_record) == BLOCK_SECTOR_SIZE);
+
+  hash_init (&images, image_hash_func, image_less_func, NULL);
+  list_init (&all_list);
+  list_init (&run_list);
+  lock_init (&journal_lock);
+  cond_init (&txn_changed);
+  lock_init (&log_lock);
+  handle_cnt = 0;
+
+  log_buf = malloc (JOURNAL_SECTORS * BLOCK_SECTOR_SIZE);
+  scratch = malloc (BLOCK_SECTOR_SIZE);
+  if (log_buf == NULL || scratch == NULL)
+    PANIC ("couldn't allocate journal buffers");
+  if (block_size (fs_device) <= JOURNAL_SECTOR + JOURNAL_SECTORS)
+    PANIC ("file system device too small for journal");
+
+  if (format)
+    {
+      /* Erase any log left by an earlier file system, so that its
+         records cannot be mistaken for ours. */
+      memset (log_buf, 0, JOURNAL_SECTORS * BLOCK_SECTOR_SIZE);
+      block_write_multiple (fs_device, JOURNAL_SECTOR + 1,
+                            JOURNAL_SECTORS - 1, log_buf);
+      running_seq = 0;
+    }
+  else
+    {
+      struct journal_header *header = scratch;
+
+      block_read (fs_device, JOURNAL_SECTOR, header);
+      if (header->magic != JOURNAL_MAGIC)
+        PANIC ("file system has no journal; reformat it with -f");
+      log_seq = header->seq;
+      running_seq = replay (JOURNAL_SECTORS);
+      if (running_seq != log_seq)
+        printf ("journal: replayed %u transaction(s)\n",
+                (unsigned) (running_seq - log_seq));
+    }
+  durable_seq = running_seq;
+  reset_log (running_seq);
+}
+
+/* Commits any pending transaction and checkpoints the log, so
+   that the next mount has nothing to replay. */
+void
+journal_done (void)
+{
+  ASSERT (handle_cnt == 0);
+  commit ();
+  lock_acquire (&log_lock);
+  checkpoint ();
+  lock_release (&log_lock);
+}
+
+/* Joins the running transaction.  Every metadata write until the
+   matching journal_end() commits atomically with it.  Calls may
+   nest.  A transaction that every caller has left is about to
+   commit, so it is not joined; the caller waits for the next. */
+void
+journal_begin (void)
+{
+  lock_acquire (&journal_lock);
+  while (handle_cnt == 0 && !list_empty (&run_list))
+    cond_wait (&txn_changed, &journal_lock);
+  handle_cnt++;
+  lock_release (&journal_lock);
+}
+
+/* Leaves the running transaction, committing it if no other
+   caller is still inside it. */
+void
+journal_end (void)
+{
+  bool last;
+
+  lock_acquire (&journal_lock);
+  ASSERT (handle_cnt > 0);
+  last = --handle_cnt == 0;
+  lock_release (&journal_lock);
+
+  if (last)
+    commit ();
+}
+
+/* Returns the sequence number of the running transaction. */
+uint32_t
+journal_seq (void)
+{
+  uint32_t seq;
+
+  lock_acquire (&journal_lock);
+  seq = running_seq;
+  lock_release (&journal_lock);
+  return seq;
+}
+
+/* Returns true if transaction SEQ has committed, that is, if its
+   COMMIT record is on disk. */
+bool
+journal_is_committed (uint32_t seq)
+{
+  bool committed;
+
+  lock_acquire (&journal_lock);
+  committed = seq < durable_seq;
+  lock_release (&journal_lock);
+  return committed;
+}
+
+/* Reads SECTOR of the file system device into BUFFER.  If
+   METADATA is true, takes any write the journal has not yet
+   checkpointed into account. */
+void
+journal_read (block_sector_t sector, void *buffer, bool metadata)
+{
+  struct image *img = NULL;
+
+  if (metadata)
+    {
+      lock_acquire (&journal_lock);
+      img = find (sector);
+      if (img != NULL && !img->revoked)
+        memcpy (buffer, img->data, BLOCK_SECTOR_SIZE);
+      else
+        img = NULL;
+      lock_release (&journal_lock);
+    }
+
+  if (img == NULL)
+    block_read (fs_device, sector, buffer);
+}
+
+/* Writes BUFFER to SECTOR of the file system device.  If
+   METADATA is true, the write joins the running transaction, or
+   forms one by itself if there is none; otherwise it goes
+   straight to disk.  Returns false, having written nothing, if a
+   metadata write does not fit in the running transaction or
+   there is no memory to log it. */
+bool
+journal_write (block_sector_t sector, const void *buffer, bool metadata)
+{
+  struct image *img;
+  bool commit_now;
+
+  if (!metadata)
+    {
+      block_write (fs_device, sector, buffer);
+      return true;
+    }
+
+  lock_acquire (&journal_lock);
+  img = find (sector);
+  if (img == NULL || img->seq != running_seq)
+    {
+      if (list_size (&run_list) >= MAX_TXN_SECTORS)
+        {
+          lock_release (&journal_lock);
+          return false;
+        }
+      if (img == NULL)
+        {
+          img = malloc (sizeof *img);
+          if (img == NULL)
+            {
+              lock_release (&journal_lock);
+              return false;
+            }
+          img->key.sector = sector;
+          hash_insert (&images, &img->key.elem);
+          list_push_back (&all_list, &img->all_elem);
+        }
+      img->seq = running_seq;
+      list_push_back (&run_list, &img->run_elem);
+    }
+  img->revoked = false;
+  memcpy (img->data, buffer, BLOCK_SECTOR_SIZE);
+  commit_now = handle_cnt == 0;
+  lock_release (&journal_lock);
+
+  if (commit_now)
+    commit ();
+  return true;
+}
+
+/* Reads the CNT sectors starting at SECTOR into BUFFER, as
+   journal_read() would one at a time.  File data, and metadata
+   none of which has been logged, is read with a single
+   request. */
+void
+journal_read_multiple (block_sector_t sector, size_t cnt, void *buffer,
+                       bool metadata)
+{
+  uint8_t *p = buffer;
+  bool logged = false;
+  size_t i;
+
+  if (metadata)
+    {
+      lock_acquire (&journal_lock);
+      for (i = 0; i < cnt && !logged && !hash_empty (&images); i++)
+        logged = find (sector + i) != NULL;
+      lock_release (&journal_lock);
+    }
+
+  if (!logged)
+    block_read_multiple (fs_device, sector, cnt, buffer);
+  else
+    for (i = 0; i < cnt; i++)
+      journal_read (sector + i, p + i * BLOCK_SECTOR_SIZE, true);
+}
+
+/* Writes the CNT sectors starting at SECTOR from BUFFER, as
+   journal_write() would one at a time.  File data goes to disk
+   with a single request.  Returns the number of sectors
+   written, which is less than CNT only if a metadata write is
+   refused. */
+size_t
+journal_write_multiple (block_sector_t sector, size_t cnt,
+                        const void *buffer, bool metadata)
+{
+  const uint8_t *p = buffer;
+  size_t i;
+
+  if (!metadata)
+    {
+      block_write_multiple (fs_device, sector, cnt, buffer);
+      return cnt;
+    }
+
+  for (i = 0; i < cnt; i++)
+    if (!journal_write (sector + i, p + i * BLOCK_SECTOR_SIZE, true))
+      break;
+  return i;
+}
+
+/* Revokes the CNT sectors starting at SECTOR, which the running
+   transaction frees.  Once it commits, no copy of them logged
+   until then is replayed, and they may hold file data. */
+void
+journal_revoke (block_sector_t sector, size_t cnt)
+{
+  size_t i;
+
+  lock_acquire (&journal_lock);
+  for (i = 0; i < cnt && !hash_empty (&images); i++)
+    {
+      struct image *img = find (sector + i);
+      if (img != NULL)
+        {
+          if (img->seq != running_seq)
+            {
+              img->seq = running_seq;
+              list_push_back (&run_list, &img->run_elem);
+            }
+          img->revoked = true;
+        }
+    }
+  lock_release (&journal_lock);
+}
+
+/* Commits the running transaction, unless it is empty or some
+   caller is still inside it.  The transaction is frozen into
+   log_buf under journal_lock, checkpointing first if it might not
+   fit in the log, and then written out without it. */
+static void
+commit (void)
+{
+  struct journal_record *commit_record;
+  uint32_t seq;
+  size_t cnt;
+
+  lock_acquire (&log_lock);
+  for (;;)
+    {
+      lock_acquire (&journal_lock);
+      if (handle_cnt > 0 || list_empty (&run_list))
+        {
+          lock_release (&journal_lock);
+          lock_release (&log_lock);
+          return;
+        }
+      seq = running_seq;
+      cnt = freeze ();
+      lock_release (&journal_lock);
+      if (cnt > 0)
+        break;
+
+      /* A transaction always fits in an empty log. */
+      ASSERT (log_pos > 1);
+      checkpoint ();
+    }
+
+  /* Write everything but the COMMIT record, then the COMMIT
+     record, so that it cannot reach the disk first. */
+  block_write_multiple (fs_device, JOURNAL_SECTOR + log_pos, cnt, log_buf);
+  log_pos += cnt;
+  commit_record = (struct journal_record *) log_buf;
+  memset (commit_record, 0, sizeof *commit_record);
+  commit_record->magic = COMMIT_MAGIC;
+  commit_record->seq = seq;
+  block_write (fs_device, JOURNAL_SECTOR + log_pos++, commit_record);
+
+  lock_acquire (&journal_lock);
+  durable_seq = seq + 1;
+  cond_broadcast (&txn_changed, &journal_lock);
+  lock_release (&journal_lock);
+  lock_release (&log_lock);
+}
+
+/* Copies the running transaction's DESC records, logged sectors
+   and REVOKE records into log_buf, in log order, frees the
+   images of the sectors it revoked, and starts the next
+   transaction.  Returns the number of sectors copied, or 0,
+   copying nothing, if they and a COMMIT record would not fit in
+   the rest of the log.
+   The caller must hold journal_lock and log_lock. */
+static size_t
+freeze (void)
+{
+  size_t data_cnt = 0, revoke_cnt = 0;
+  size_t pos = 0, need;
+  struct journal_record *rec = NULL;
+  struct list_elem *e;
+
+  for (e = list_begin (&run_list); e != list_end (&run_list);
+       e = list_next (e))
+    if (list_entry (e, struct image, run_elem)->revoked)
+      revoke_cnt++;
+    else
+      data_cnt++;
+  need = (data_cnt + DIV_ROUND_UP (data_cnt, RECORD_SECTORS)
+          + DIV_ROUND_UP (revoke_cnt, RECORD_SECTORS));
+  if (log_pos + need + 1 > JOURNAL_SECTORS)
+    return 0;
+
+  /* Logged sectors, each DESC record followed by the sectors it
+     lists. */
+  for (e = list_begin (&run_list); e != list_end (&run_list);
+       e = list_next (e))
+    {
+      struct image *img = list_entry (e, struct image, run_elem);
+      if (img->revoked)
+        continue;
+      if (rec == NULL || rec->cnt == RECORD_SECTORS)
+        {
+          rec = (struct journal_record *) (log_buf + pos * BLOCK_SECTOR_SIZE);
+          memset (rec, 0, sizeof *rec);
+          rec->magic = DESC_MAGIC;
+          rec->seq = running_seq;
+          pos++;
+        }
+      rec->sectors[rec->cnt++] = img->key.sector;
+      memcpy (log_buf + pos++ * BLOCK_SECTOR_SIZE, img->data,
+              BLOCK_SECTOR_SIZE);
+    }
+
+  /* Revoked sectors, whose images are no longer needed. */
+  rec = NULL;
+  e = list_begin (&run_list);
+  while (e != list_end (&run_list))
+    {
+      struct image *img = list_entry (e, struct image, run_elem);
+      e = list_next (e);
+      if (!img->revoked)
+        continue;
+      if (rec == NULL || rec->cnt == RECORD_SECTORS)
+        {
+          rec = (struct journal_record *) (log_buf + pos * BLOCK_SECTOR_SIZE);
+          memset (rec, 0, sizeof *rec);
+          rec->magic = REVOKE_MAGIC;
+          rec->seq = running_seq;
+          pos++;
+        }
+      rec->sectors[rec->cnt++] = img->key.sector;
+      list_remove (&img->all_elem);
+      hash_delete (&images, &img->key.elem);
+      free (img);
+    }
+  ASSERT (pos == need);
+
+  list_init (&run_list);
+  running_seq++;
+  cond_broadcast (&txn_changed, &journal_lock);
+  return need;
+}
+
+/* Writes every transaction in the log to its home locations,
+   empties the log, and forgets the images it covered.  Images
+   written by the running transaction are kept.
+   The caller must hold log_lock, but not journal_lock. */
+static void
+checkpoint (void)
+{
+  uint32_t seq = replay (log_pos);
+  ASSERT (seq == durable_seq);
+  reset_log (seq);
+
+  lock_acquire (&journal_lock);
+  drop_images (seq);
+  lock_release (&journal_lock);
+}
+
+/* Reads the first CNT sectors of the log into log_buf and writes
+   each committed transaction in it, starting from log_seq, to its
+   home locations, skipping revoked sectors.  Returns the sequence
+   number following the last one replayed. */
+static uint32_t
+replay (block_sector_t cnt)
+{
+  uint32_t seq = log_seq;
+  block_sector_t pos, end;
+  uint32_t i;
+
+  block_read_multiple (fs_device, JOURNAL_SECTOR, cnt, log_buf);
+
+  /* Find the end of the last committed transaction. */
+  for (pos = end = 1; pos < cnt; )
+    {
+      struct journal_record *rec
+        = (struct journal_record *) (log_buf + pos * BLOCK_SECTOR_SIZE);
+
+      if (rec->seq != seq || rec->cnt > RECORD_SECTORS)
+        break;
+      if (rec->magic == COMMIT_MAGIC)
+        {
+          end = ++pos;
+          seq++;
+        }
+      else if (rec->magic == DESC_MAGIC && pos + 1 + rec->cnt < cnt)
+        pos += 1 + rec->cnt;
+      else if (rec->magic == REVOKE_MAGIC)
+        pos++;
+      else
+        break;
+    }
+
+  /* Copy the logged sectors home. */
+  for (pos = 1; pos < end; )
+    {
+      struct journal_record *rec
+        = (struct journal_record *) (log_buf + pos * BLOCK_SECTOR_SIZE);
+
+      if (rec->magic == DESC_MAGIC)
+        {
+          for (i = 0; i < rec->cnt; i++)
+            if (!is_revoked (rec->sectors[i], rec->seq, end))
+              block_write (fs_device, rec->sectors[i],
+                           log_buf + (pos + 1 + i) * BLOCK_SECTOR_SIZE);
+          pos += 1 + rec->cnt;
+        }
+      else
+        pos++;
+    }
+  return seq;
+}
+
+/* Returns true if SECTOR is revoked by transaction SEQ or a later
+   one among those in the first END sectors of log_buf. */
+static bool
+is_revoked (block_sector_t sector, uint32_t seq, block_sector_t end)
+{
+  block_sector_t pos;
+  uint32_t i;
+
+  for (pos = 1; pos < end; )
+    {
+      struct journal_record *rec
+        = (struct journal_record *) (log_buf + pos * BLOCK_SECTOR_SIZE);
+
+      if (rec->magic == DESC_MAGIC)
+        pos += 1 + rec->cnt;
+      else
+        {
+          if (rec->magic == REVOKE_MAGIC && rec->seq >= seq)
+            for (i = 0; i < rec->cnt; i++)
+              if (rec->sectors[i] == sector)
+                return true;
+          pos++;
+        }
+    }
+  return false;
+}
+
+/* Empties the log, so that the next transaction committed, which
+   will be SEQ, goes at its start. */
+static void
+reset_log (uint32_t seq)
+{
+  struct journal_header *header = scratch;
+
+  memset (header, 0, sizeof *header);
+  header->magic = JOURNAL_MAGIC;
+  header->seq = seq;
+  block_write (fs_device, JOURNAL_SECTOR, header);
+  log_seq = seq;
+  log_pos = 1;
+}
+
+/* Frees every image last written by a transaction before SEQ,
+   all of which must already be at home on disk.
+   The caller must hold journal_lock. */
+static void
+drop_images (uint32_t seq)
+{
+  struct list_elem *e = list_begin (&all_list);
+
+  while (e != list_end (&all_list))
+    {
+      struct image *img = list_entry (e, struct image, all_elem);
+      e = list_next (e);
+      if (img->seq < seq)
+        {
+          list_remove (&img->all_elem);
+          hash_delete (&images, &img->key.elem);
+          free (img);
+        }
+    }
+}
+
+/* Returns the image of SECTOR, revoked or not, or a null pointer
+   if there is none.  The caller must hold journal_lock. */
+static struct image *
+find (block_sector_t sector)
+{
+  struct image_key key;
+  struct hash_elem *e;
+
+  key.sector = sector;
+  e = hash_find (&images, &key.elem);
+  return e != NULL ? hash_entry (e, struct image, key.elem) : NULL;
+}
+
+/* Returns a hash value for the image key containing E. */
+static unsigned
+image_hash_func (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct image_key *key = hash_entry (e, struct image_key, elem);
+  return hash_int (key->sector);
+}
+
+/* Returns true if the image key containing A precedes the one
+   containing B, ordering by sector. */
+static bool
+image_less_func (const struct hash_elem *a, const struct hash_elem *b,
+                 void *aux UNUSED)
+{
+  const struct image_key *ka = hash_entry (a, struct image_key, elem);
+  const struct image_key *kb = hash_entry (b, struct image_key, elem);
+  return ka->sector < kb->sector;
+}
@@ -0,0 +1,27 @@
+#ifndef FILESYS_JOURNAL_H
+#define FILESYS_JOURNAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "devices/block.h"
+
+/* Sectors reserved for the journal on the file system device. */
+#define JOURNAL_SECTOR 2        /* First journal sector. */
+#define JOURNAL_SECTORS 128     /* Number of journal sectors. */
+
+void journal_init (bool format);
+void journal_done (void);
+void journal_begin (void);
+void journal_end (void);
+uint32_t journal_seq (void);
+bool journal_is_committed (uint32_t seq);
+void journal_read (block_sector_t, void *, bool metadata);
+bool journal_write (block_sector_t, const void *, bool metadata);
+void journal_read_multiple (block_sector_t, size_t cnt, void *,
+                            bool metadata);
+size_t journal_write_multiple (block_sector_t, size_t cnt, const void *,
+                               bool metadata);
+void journal_revoke (block_sector_t, size_t cnt);
+
+#endif /* filesys/journal.h */
@@ -5,10 +5,28 @@
 #include "devices/vga.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Size of a line buffer. */
+#define CONSOLE_LINE_MAX 128
+
+/* A thread's partial line of console output. */
+struct console_line
+  {
+    size_t len;                 /* Number of bytes in buf. */
+    char buf[CONSOLE_LINE_MAX]; /* Output not yet written. */
+  };
 
 static void vprintf_helper (char, void *);
+static void buffer_helper (char, void *);
 static void putchar_have_lock (uint8_t c);
+static void write_have_lock (const char *, size_t);
+static bool use_line_buffer (void);
+static void buffer_putc (char);
+static struct console_line *get_line_buffer (struct thread *);
+static void flush_line_buffer (struct thread *);
 
 /* The console lock.
    Both the vga and serial layers do their own locking, so it's
@@ -30,6 +48,23 @@ static struct lock console_lock;
    likely just recurse. */
 static bool use_console_lock;
 
+/* True once threads can have line buffers, that is, once the
+   heap is up, until a kernel panic.
+
+   Each thread collects its console output in its own line
+   buffer, without locking, and takes the console lock only to
+   write out a whole line at a time (or a full buffer, or on
+   explicit request).  This keeps lines from different threads
+   from interleaving and takes the lock once per line instead of
+   once per call.  A thread's buffer is allocated when it first
+   prints, rather than kept in struct thread, where it would take
+   its room from the kernel stack, and freed when it exits.
+   Output from interrupt handlers, and output produced while a
+   thread is writing out or allocating its buffer, bypasses the
+   buffers, as does output from a thread that could not get
+   one. */
+static bool use_line_buffers;
+
 /* It's possible, if you add enough debug output to Pintos, to
    try to recursively grab console_lock from a single thread.  As
    a real example, I added a printf() call to palloc_free().
@@ -67,13 +102,51 @@ console_init (void)
   use_console_lock = true;
 }
 
+/* Enables line buffering of console output.  Must be called
+   after malloc_init(). */
+void
+console_init_buffers (void) 
+{
+  use_line_buffers = true;
+}
+
+/* Writes out the running thread's partial line of console
+   output, if any. */
+void
+console_flush (void) 
+{
+  if (use_line_buffers && !intr_context ())
+    flush_line_buffer (thread_current ());
+}
+
+/* Writes out and frees the running thread's line buffer.  Called
+   when the thread exits. */
+void
+console_exit (void) 
+{
+  struct thread *t = thread_current ();
+
+  console_flush ();
+  free (t->console_line);
+  t->console_line = NULL;
+}
+
 /* Notifies the console that a kernel panic is underway,
    which warns it to avoid trying to take the console lock from
-   now on. */
+   now on.  Writes out the running thread's partial line first,
+   so that it precedes the panic message. */
 void
 console_panic (void) 
 {
   use_console_lock = false;
+  if (use_line_buffers) 
+    {
+      /* Clear the flag first, in case finding the running thread
+         panics in turn. */
+      use_line_buffers = false;
+      if (!intr_context ())
+        flush_line_buffer (thread_current ());
+    }
 }
 
 /* Prints console statistics. */
@@ -127,9 +200,14 @@ vprintf (const char *format, va_list args)
 {
   int char_cnt = 0;
 
-  acquire_console ();
-  __vprintf (format, args, vprintf_helper, &char_cnt);
-  release_console ();
+  if (use_line_buffer ())
+    __vprintf (format, args, buffer_helper, &char_cnt);
+  else
+    {
+      acquire_console ();
+      __vprintf (format, args, vprintf_helper, &char_cnt);
+      release_console ();
+    }
 
   return char_cnt;
 }
@@ -139,11 +217,20 @@ vprintf (const char *format, va_list args)
 int
 puts (const char *s) 
 {
-  acquire_console ();
-  while (*s != '\0')
-    putchar_have_lock (*s++);
-  putchar_have_lock ('\n');
-  release_console ();
+  if (use_line_buffer ())
+    {
+      while (*s != '\0')
+        buffer_putc (*s++);
+      buffer_putc ('\n');
+    }
+  else
+    {
+      acquire_console ();
+      while (*s != '\0')
+        putchar_have_lock (*s++);
+      putchar_have_lock ('\n');
+      release_console ();
+    }
 
   return 0;
 }
@@ -152,19 +239,31 @@ puts (const char *s)
 void
 putbuf (const char *buffer, size_t n) 
 {
-  acquire_console ();
-  while (n-- > 0)
-    putchar_have_lock (*buffer++);
-  release_console ();
+  if (use_line_buffer ())
+    {
+      while (n-- > 0)
+        buffer_putc (*buffer++);
+    }
+  else
+    {
+      acquire_console ();
+      write_have_lock (buffer, n);
+      release_console ();
+    }
 }
 
 /* Writes C to the vga display and serial port. */
 int
 putchar (int c) 
 {
-  acquire_console ();
-  putchar_have_lock (c);
-  release_console ();
+  if (use_line_buffer ())
+    buffer_putc (c);
+  else
+    {
+      acquire_console ();
+      putchar_have_lock (c);
+      release_console ();
+    }
   
   return c;
 }
@@ -178,6 +277,101 @@ vprintf_helper (char c, void *char_cnt_)
   putchar_have_lock (c);
 }
 
+/* Helper function for vprintf() with line buffering. */
+static void
+buffer_helper (char c, void *char_cnt_) 
+{
+  int *char_cnt = char_cnt_;
+  (*char_cnt)++;
+  buffer_putc (c);
+}
+
+/* Returns true if output from the running thread should go to
+   its line buffer, false if it should be written directly. */
+static bool
+use_line_buffer (void) 
+{
+  return (use_line_buffers
+          && !intr_context ()
+          && !thread_current ()->console_busy);
+}
+
+/* Returns T's line buffer, allocating it if T does not have one
+   yet, or a null pointer if there is no memory for it.  T must
+   be the running thread.  Output produced by malloc() meanwhile
+   is written directly. */
+static struct console_line *
+get_line_buffer (struct thread *t) 
+{
+  if (t->console_line == NULL)
+    {
+      t->console_busy = true;
+      t->console_line = malloc (sizeof *t->console_line);
+      if (t->console_line != NULL)
+        t->console_line->len = 0;
+      t->console_busy = false;
+    }
+  return t->console_line;
+}
+
+/* Appends C to the running thread's line buffer, writing the
+   buffer out at the end of a line or when it fills up.  Writes C
+   directly if the thread has no buffer. */
+static void
+buffer_putc (char c) 
+{
+  struct thread *t = thread_current ();
+  struct console_line *line = get_line_buffer (t);
+
+  if (line == NULL)
+    {
+      acquire_console ();
+      putchar_have_lock (c);
+      release_console ();
+      return;
+    }
+
+  line->buf[line->len++] = c;
+  if (c == '\n' || line->len >= sizeof line->buf)
+    flush_line_buffer (t);
+}
+
+/* Writes out T's line buffer, if it has one, which must belong to
+   the running thread.  Any output produced meanwhile, e.g. by
+   debugging code called from the console or serial layers, is
+   written directly. */
+static void
+flush_line_buffer (struct thread *t) 
+{
+  struct console_line *line = t->console_line;
+
+  if (line == NULL || line->len == 0)
+    return;
+
+  t->console_busy = true;
+  acquire_console ();
+  write_have_lock (line->buf, line->len);
+  release_console ();
+  line->len = 0;
+  t->console_busy = false;
+}
+
+/* Writes the N characters in BUFFER to the vga display and
+   serial port, handing them to the serial port in bulk.  The
+   caller has already acquired the console lock if
+   appropriate. */
+static void
+write_have_lock (const char *buffer, size_t n) 
+{
+  size_t i;
+
+  ASSERT (console_locked_by_current_thread ());
+  write_cnt += n;
+  serial_write (buffer, n);
+  for (i = 0; i < n; i++)
+    vga_putc (buffer[i]);
+}
+
 /* Writes C to the vga display and serial port.
    The caller has already acquired the console lock if
    appropriate. */
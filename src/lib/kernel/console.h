@@ -2,6 +2,9 @@
 #define __LIB_KERNEL_CONSOLE_H
 
 void console_init (void);
+void console_init_buffers (void);
+void console_flush (void);
+void console_exit (void);
 void console_panic (void);
 void console_print_stats (void);
 
@@ -0,0 +1,19 @@
+#ifndef __LIB_MMAN_H
+#define __LIB_MMAN_H
+
+/* Flags for mmap2().  Exactly one of MAP_SHARED and MAP_PRIVATE
+   must be given.  Anonymous memory is never shared between
+   processes, so for it the two mean the same. */
+#define MAP_SHARED 0x1          /* Write changes back to the file. */
+#define MAP_PRIVATE 0x2         /* Keep changes private (copy-on-write). */
+#define MAP_POPULATE 0x4        /* Read in the whole mapping up front. */
+#define MAP_ANONYMOUS 0x8       /* Zeroed memory, not a file.  FD is ignored. */
+
+/* Advice for madvise(). */
+#define MADV_NORMAL 0           /* No special treatment. */
+#define MADV_RANDOM 1           /* Expect random accesses: no readahead. */
+#define MADV_SEQUENTIAL 2       /* Expect sequential accesses. */
+#define MADV_WILLNEED 3         /* Will need these pages: read them in. */
+#define MADV_DONTNEED 4         /* Won't need these pages: drop them. */
+
+#endif /* lib/mman.h */
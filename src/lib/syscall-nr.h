@@ -28,7 +28,21 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_PREAD,                  /* Read from a file at a given offset. */
+    SYS_PWRITE,                 /* Write to a file at a given offset. */
+    SYS_READV,                  /* Read from a file into several buffers. */
+    SYS_WRITEV,                 /* Write to a file from several buffers. */
+    SYS_COPY_FILE_RANGE,        /* Copy between files within the kernel. */
+    SYS_MMAP2,                  /* Map part of a file, with flags. */
+    SYS_MUNMAP_RANGE,           /* Remove mappings from a memory range. */
+    SYS_MSYNC,                  /* Write a mapped range back to its file. */
+    SYS_SBRK,                   /* Grow or shrink the heap. */
+    SYS_MADVISE,                /* Give advice about use of memory. */
+    SYS_FORK,                   /* Duplicate the calling process. */
+    SYS_SETFDLIMIT              /* Set the file descriptor limit. */
   };
 
 #endif /* lib/syscall-nr.h */
@@ -0,0 +1,16 @@
+#ifndef __LIB_UIO_H
+#define __LIB_UIO_H
+
+#include <stddef.h>
+
+/* One buffer of a readv() or writev() request. */
+struct iovec
+  {
+    void *iov_base;             /* Start of buffer. */
+    size_t iov_len;             /* Size of buffer in bytes. */
+  };
+
+/* Most buffers allowed in one request. */
+#define IOV_MAX 1024
+
+#endif /* lib/uio.h */
@@ -0,0 +1,396 @@
+#include <malloc.h>
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+
+/* A simple implementation of malloc() for user programs.
+
+   It works the same way as the kernel's, in threads/malloc.c.
+   Each request is rounded up to a power of 2 and served from the
+   free list of the "descriptor" for blocks of that size.  When
+   the list is empty, a new page, called an "arena", is divided
+   into blocks for it.  When all of an arena's blocks are free
+   again, the page is given back.  Requests too big for that get
+   contiguous pages of their own, with the page count in the
+   arena header.
+
+   Pages come from the heap, which we grow with sbrk() as needed.
+   Pages that are given back go on a list of free runs, sorted by
+   address with neighbors merged, to be reused first.  A run that
+   ends up at the top of the heap is returned to the kernel with a
+   negative sbrk() instead. */
+
+#define PAGE_SIZE 4096
+
+/* Descriptor. */
+struct desc
+  {
+    size_t block_size;          /* Size of each element in bytes. */
+    size_t blocks_per_arena;    /* Number of blocks in an arena. */
+    struct block *free_list;    /* List of free blocks. */
+  };
+
+/* Magic number for detecting arena corruption. */
+#define ARENA_MAGIC 0x9a548eed
+
+/* Arena. */
+struct arena
+  {
+    unsigned magic;             /* Always set to ARENA_MAGIC. */
+    struct desc *desc;          /* Owning descriptor, null for big block. */
+    size_t free_cnt;            /* Free blocks; pages in big block. */
+  };
+
+/* Free block. */
+struct block
+  {
+    struct block *prev;         /* Previous free block in list. */
+    struct block *next;         /* Next free block in list. */
+  };
+
+/* Run of free pages. */
+struct run
+  {
+    size_t page_cnt;            /* Number of pages. */
+    struct run *next;           /* Next run, at a higher address. */
+  };
+
+/* Our set of descriptors. */
+static struct desc descs[10];   /* Descriptors. */
+static size_t desc_cnt;         /* Number of descriptors. */
+
+/* Free pages within the heap. */
+static struct run *free_runs;
+
+static void init (void);
+static void *get_pages (size_t page_cnt);
+static void free_pages (void *, size_t page_cnt);
+static void push_block (struct desc *, struct block *);
+static void remove_block (struct desc *, struct block *);
+static struct arena *block_to_arena (struct block *);
+static struct block *arena_to_block (struct arena *, size_t idx);
+
+/* Obtains and returns a new block of at least SIZE bytes.
+   Returns a null pointer if memory is not available. */
+void *
+malloc (size_t size)
+{
+  struct desc *d;
+  struct block *b;
+  struct arena *a;
+
+  /* A null pointer satisfies a request for 0 bytes. */
+  if (size == 0)
+    return NULL;
+
+  if (desc_cnt == 0)
+    init ();
+
+  /* Find the smallest descriptor that satisfies a SIZE-byte
+     request. */
+  for (d = descs; d < descs + desc_cnt; d++)
+    if (d->block_size >= size)
+      break;
+  if (d == descs + desc_cnt)
+    {
+      /* SIZE is too big for any descriptor.
+         Allocate enough pages to hold SIZE plus an arena. */
+      size_t page_cnt;
+
+      if (size > SIZE_MAX - sizeof *a - PAGE_SIZE)
+        return NULL;
+      page_cnt = DIV_ROUND_UP (size + sizeof *a, PAGE_SIZE);
+      a = get_pages (page_cnt);
+      if (a == NULL)
+        return NULL;
+
+      /* Initialize the arena to indicate a big block of PAGE_CNT
+         pages, and return it. */
+      a->magic = ARENA_MAGIC;
+      a->desc = NULL;
+      a->free_cnt = page_cnt;
+      return a + 1;
+    }
+
+  /* If the free list is empty, create a new arena. */
+  if (d->free_list == NULL)
+    {
+      size_t i;
+
+      a = get_pages (1);
+      if (a == NULL)
+        return NULL;
+
+      /* Initialize arena and add its blocks to the free list. */
+      a->magic = ARENA_MAGIC;
+      a->desc = d;
+      a->free_cnt = d->blocks_per_arena;
+      for (i = d->blocks_per_arena; i-- > 0; )
+        push_block (d, arena_to_block (a, i));
+    }
+
+  /* Get a block from free list and return it. */
+  b = d->free_list;
+  remove_block (d, b);
+  a = block_to_arena (b);
+  a->free_cnt--;
+  return b;
+}
+
+/* Allocates and return A times B bytes initialized to zeroes.
+   Returns a null pointer if memory is not available. */
+void *
+calloc (size_t a, size_t b)
+{
+  void *p;
+  size_t size;
+
+  /* Calculate block size and make sure it fits in size_t. */
+  if (b != 0 && a > SIZE_MAX / b)
+    return NULL;
+  size = a * b;
+
+  /* Allocate and zero memory. */
+  p = malloc (size);
+  if (p != NULL)
+    memset (p, 0, size);
+
+  return p;
+}
+
+/* Returns the number of bytes allocated for BLOCK. */
+static size_t
+block_size (void *block)
+{
+  struct block *b = block;
+  struct arena *a = block_to_arena (b);
+  struct desc *d = a->desc;
+
+  return (d != NULL ? d->block_size
+          : PAGE_SIZE * a->free_cnt - ((uintptr_t) block % PAGE_SIZE));
+}
+
+/* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
+   moving it in the process.
+   If successful, returns the new block; on failure, returns a
+   null pointer.
+   A call with null OLD_BLOCK is equivalent to malloc(NEW_SIZE).
+   A call with zero NEW_SIZE is equivalent to free(OLD_BLOCK). */
+void *
+realloc (void *old_block, size_t new_size)
+{
+  if (new_size == 0)
+    {
+      free (old_block);
+      return NULL;
+    }
+  else if (old_block != NULL && new_size <= block_size (old_block))
+    {
+      /* Still fits. */
+      return old_block;
+    }
+  else
+    {
+      void *new_block = malloc (new_size);
+      if (old_block != NULL && new_block != NULL)
+        {
+          memcpy (new_block, old_block, block_size (old_block));
+          free (old_block);
+        }
+      return new_block;
+    }
+}
+
+/* Frees block P, which must have been previously allocated with
+   malloc(), calloc(), or realloc(). */
+void
+free (void *p)
+{
+  if (p != NULL)
+    {
+      struct block *b = p;
+      struct arena *a = block_to_arena (b);
+      struct desc *d = a->desc;
+
+      if (d != NULL)
+        {
+          /* It's a normal block.  We handle it here. */
+
+#ifndef NDEBUG
+          /* Clear the block to help detect use-after-free bugs. */
+          memset (b, 0xcc, d->block_size);
+#endif
+
+          /* Add block to free list. */
+          push_block (d, b);
+
+          /* If the arena is now entirely unused, free it. */
+          if (++a->free_cnt >= d->blocks_per_arena)
+            {
+              size_t i;
+
+              ASSERT (a->free_cnt == d->blocks_per_arena);
+              for (i = 0; i < d->blocks_per_arena; i++)
+                remove_block (d, arena_to_block (a, i));
+              free_pages (a, 1);
+            }
+        }
+      else
+        {
+          /* It's a big block.  Free its pages. */
+          free_pages (a, a->free_cnt);
+        }
+    }
+}
+
+/* Initializes the descriptors. */
+static void
+init (void)
+{
+  size_t block_size;
+
+  for (block_size = 16; block_size < PAGE_SIZE / 2; block_size *= 2)
+    {
+      struct desc *d = &descs[desc_cnt++];
+      ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
+      d->block_size = block_size;
+      d->blocks_per_arena = (PAGE_SIZE - sizeof (struct arena)) / block_size;
+      d->free_list = NULL;
+    }
+}
+
+/* Returns PAGE_CNT contiguous free pages, or a null pointer if
+   the heap cannot grow enough. */
+static void *
+get_pages (size_t page_cnt)
+{
+  struct run **rp;
+  uint8_t *brk;
+  size_t pad;
+
+  /* Take the pages from the end of the first run that is big
+     enough, if any. */
+  for (rp = &free_runs; *rp != NULL; rp = &(*rp)->next)
+    {
+      struct run *r = *rp;
+      if (r->page_cnt >= page_cnt)
+        {
+          r->page_cnt -= page_cnt;
+          if (r->page_cnt == 0)
+            *rp = r->next;
+          return (uint8_t *) r + r->page_cnt * PAGE_SIZE;
+        }
+    }
+
+  /* Grow the heap, keeping the pages aligned. */
+  brk = sbrk (0);
+  pad = ROUND_UP ((uintptr_t) brk, PAGE_SIZE) - (uintptr_t) brk;
+  if (page_cnt > (INTPTR_MAX - pad) / PAGE_SIZE
+      || sbrk (pad + page_cnt * PAGE_SIZE) == (void *) -1)
+    return NULL;
+  return brk + pad;
+}
+
+/* Gives back the PAGE_CNT pages at PAGES. */
+static void
+free_pages (void *pages, size_t page_cnt)
+{
+  struct run *r = pages;
+  struct run *prev = NULL;
+  struct run *next = free_runs;
+  struct run **rp;
+
+  /* Insert R in order of address, and merge it with its
+     neighbors. */
+  while (next != NULL && next < r)
+    {
+      prev = next;
+      next = next->next;
+    }
+  r->page_cnt = page_cnt;
+  r->next = next;
+  if (prev != NULL)
+    prev->next = r;
+  else
+    free_runs = r;
+  if ((uint8_t *) r + r->page_cnt * PAGE_SIZE == (uint8_t *) next)
+    {
+      r->page_cnt += next->page_cnt;
+      r->next = next->next;
+    }
+  if (prev != NULL
+      && (uint8_t *) prev + prev->page_cnt * PAGE_SIZE == (uint8_t *) r)
+    {
+      prev->page_cnt += r->page_cnt;
+      prev->next = r->next;
+    }
+
+  /* Shrink the heap if the last run is at its top. */
+  for (rp = &free_runs; *rp != NULL && (*rp)->next != NULL;
+       rp = &(*rp)->next)
+    continue;
+  r = *rp;
+  if (r != NULL
+      && (uint8_t *) r + r->page_cnt * PAGE_SIZE == (uint8_t *) sbrk (0)
+      && r->page_cnt <= INTPTR_MAX / PAGE_SIZE)
+    {
+      *rp = NULL;
+      sbrk (-(intptr_t) (r->page_cnt * PAGE_SIZE));
+    }
+}
+
+/* Adds B to the front of D's free list. */
+static void
+push_block (struct desc *d, struct block *b)
+{
+  b->prev = NULL;
+  b->next = d->free_list;
+  if (b->next != NULL)
+    b->next->prev = b;
+  d->free_list = b;
+}
+
+/* Removes B from D's free list. */
+static void
+remove_block (struct desc *d, struct block *b)
+{
+  if (b->prev != NULL)
+    b->prev->next = b->next;
+  else
+    d->free_list = b->next;
+  if (b->next != NULL)
+    b->next->prev = b->prev;
+}
+
+/* Returns the arena that block B is inside. */
+static struct arena *
+block_to_arena (struct block *b)
+{
+  struct arena *a = (struct arena *) ((uintptr_t) b & ~(PAGE_SIZE - 1));
+  size_t ofs = (uintptr_t) b % PAGE_SIZE;
+
+  /* Check that the arena is valid. */
+  ASSERT (a != NULL);
+  ASSERT (a->magic == ARENA_MAGIC);
+
+  /* Check that the block is properly aligned for the arena. */
+  ASSERT (a->desc == NULL
+          || (ofs - sizeof *a) % a->desc->block_size == 0);
+  ASSERT (a->desc != NULL || ofs == sizeof *a);
+
+  return a;
+}
+
+/* Returns the (IDX - 1)'th block within arena A. */
+static struct block *
+arena_to_block (struct arena *a, size_t idx)
+{
+  ASSERT (a != NULL);
+  ASSERT (a->magic == ARENA_MAGIC);
+  ASSERT (idx < a->desc->blocks_per_arena);
+  return (struct block *) ((uint8_t *) a
+                           + sizeof *a
+                           + idx * a->desc->block_size);
+}
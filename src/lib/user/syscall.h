@@ -3,6 +3,9 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <mman.h>
+#include <stdint.h>
+#include <uio.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -45,4 +48,19 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Extensions. */
+int pread (int fd, void *buffer, unsigned length, unsigned offset);
+int pwrite (int fd, const void *buffer, unsigned length, unsigned offset);
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int copy_file_range (int fd_in, unsigned off_in, int fd_out,
+                     unsigned off_out, unsigned length);
+mapid_t mmap2 (int fd, void *addr, size_t length, unsigned offset, int flags);
+int munmap_range (void *addr, size_t length);
+int msync (void *addr, size_t length);
+void *sbrk (intptr_t increment);
+int madvise (void *addr, size_t length, int advice);
+pid_t fork (void);
+bool setfdlimit (int limit);
+
 #endif /* lib/user/syscall.h */
@@ -0,0 +1,24 @@
+#ifndef TESTS_CYCLES_H
+#define TESTS_CYCLES_H
+
+#include <stdint.h>
+
+/* Returns the CPU's time-stamp counter, which counts cycles, for
+   timing benchmarks. */
+static inline uint64_t
+cycles (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Returns a rate of BYTES per CYCLES as bytes per million
+   cycles. */
+static inline uint64_t
+bytes_per_mcycle (uint64_t bytes, uint64_t cycles)
+{
+  return cycles > 0 ? bytes * 1000000 / cycles : 0;
+}
+
+#endif /* tests/cycles.h */
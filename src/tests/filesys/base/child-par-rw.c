@@ -0,0 +1,62 @@
+/* Child process for par-rw test.
+   Repeatedly writes its own file a chunk at a time, reads it
+   back, and reads the shared file, while the other children do
+   the same with theirs. */
+
+#include <random.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/filesys/base/par-rw.h"
+
+static char shared[FILE_SIZE];
+static char data[FILE_SIZE];
+static char buf[FILE_SIZE];
+
+int
+main (int argc, char *argv[])
+{
+  char file_name[16];
+  int child_idx;
+  int fd, shared_fd;
+  size_t ofs;
+  int round;
+
+  test_name = "child-par-rw";
+  quiet = true;
+
+  CHECK (argc == 2, "argc must be 2, actually %d", argc);
+  child_idx = atoi (argv[1]);
+  snprintf (file_name, sizeof file_name, "par%d", child_idx);
+
+  random_init (0);
+  random_bytes (shared, sizeof shared);
+  random_init (child_idx + 1);
+  random_bytes (data, sizeof data);
+
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK ((shared_fd = open (shared_name)) > 1, "open \"%s\"", shared_name);
+  for (round = 0; round < ROUND_CNT; round++)
+    {
+      seek (fd, 0);
+      for (ofs = 0; ofs < FILE_SIZE; ofs += CHUNK_SIZE)
+        CHECK (write (fd, data + ofs, CHUNK_SIZE) == CHUNK_SIZE,
+               "write \"%s\"", file_name);
+
+      seek (fd, 0);
+      CHECK (read (fd, buf, sizeof buf) == (int) sizeof buf,
+             "read \"%s\"", file_name);
+      compare_bytes (buf, data, sizeof buf, 0, file_name);
+
+      seek (shared_fd, 0);
+      for (ofs = 0; ofs < FILE_SIZE; ofs += CHUNK_SIZE)
+        CHECK (read (shared_fd, buf + ofs, CHUNK_SIZE) == CHUNK_SIZE,
+               "read \"%s\"", shared_name);
+      compare_bytes (buf, shared, sizeof buf, 0, shared_name);
+    }
+  close (shared_fd);
+  close (fd);
+
+  return child_idx;
+}
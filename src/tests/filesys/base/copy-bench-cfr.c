@@ -0,0 +1,6 @@
+/* Copies a 64 kB file repeatedly with copy_file_range, without
+   the data leaving the kernel, then with a read/write loop
+   through a user buffer.  copy-bench-cfr.ck compares the two. */
+
+#define COPY_FILE_RANGE
+#include "tests/filesys/base/copy-bench.inc"
@@ -0,0 +1,42 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# Copying inside the kernel saves a copy through user memory and a
+# system call per chunk, so it must not be much slower than
+# reading and writing.
+my ($rw) = map (/read\/write throughput: (\d+)/, @output);
+my ($cfr) = map (/copy_file_range throughput: (\d+)/, @output);
+fail "missing throughput report\n" if !defined ($rw) || !defined ($cfr);
+@output = grep (!/ throughput: /, @output);
+
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(copy-bench-cfr) begin
+(copy-bench-cfr) create "source"
+(copy-bench-cfr) open "source"
+(copy-bench-cfr) write "source"
+(copy-bench-cfr) create "dest-cfr"
+(copy-bench-cfr) open "dest-cfr"
+(copy-bench-cfr) copy "source" to "dest-cfr" 16 times with copy_file_range
+(copy-bench-cfr) close "dest-cfr"
+(copy-bench-cfr) open "dest-cfr" for verification
+(copy-bench-cfr) verified contents of "dest-cfr"
+(copy-bench-cfr) close "dest-cfr"
+(copy-bench-cfr) create "dest-rw"
+(copy-bench-cfr) open "dest-rw"
+(copy-bench-cfr) copy "source" to "dest-rw" 16 times with read and write
+(copy-bench-cfr) close "dest-rw"
+(copy-bench-cfr) open "dest-rw" for verification
+(copy-bench-cfr) verified contents of "dest-rw"
+(copy-bench-cfr) close "dest-rw"
+(copy-bench-cfr) close "source"
+(copy-bench-cfr) end
+EOF
+fail "copy_file_range throughput $cfr is less than 3/4 of read/write "
+  . "throughput $rw bytes per million cycles\n"
+  if $cfr * 4 < $rw * 3;
+pass "read/write $rw, copy_file_range $cfr bytes per million cycles";
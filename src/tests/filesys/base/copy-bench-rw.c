@@ -0,0 +1,5 @@
+/* Copies a 64 kB file repeatedly with a read/write loop through a
+   user buffer, then with copy_file_range.  copy-bench-rw.ck
+   compares the two. */
+
+#include "tests/filesys/base/copy-bench.inc"
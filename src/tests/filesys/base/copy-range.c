@@ -0,0 +1,60 @@
+/* Copies parts of one file into another with copy_file_range and
+   checks the results, including copies that run past the end of
+   the source or the destination and one whose ranges overlap
+   within a single file.  Files do not grow, so both are created
+   at their full size. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SRC_SIZE 5000
+#define DST_SIZE 8000
+
+static char buf[SRC_SIZE];
+static char block[SRC_SIZE];
+
+void
+test_main (void) 
+{
+  int src, dst;
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  CHECK (create ("source", SRC_SIZE), "create \"source\"");
+  CHECK (create ("dest", DST_SIZE), "create \"dest\"");
+  CHECK ((src = open ("source")) > 1, "open \"source\"");
+  CHECK ((dst = open ("dest")) > 1, "open \"dest\"");
+  CHECK (write (src, buf, SRC_SIZE) == SRC_SIZE, "write \"source\"");
+
+  CHECK (copy_file_range (src, 0, dst, 0, SRC_SIZE) == SRC_SIZE,
+         "copy all of \"source\" to \"dest\"");
+  CHECK (pread (dst, block, SRC_SIZE, 0) == SRC_SIZE, "read \"dest\"");
+  compare_bytes (block, buf, SRC_SIZE, 0, "dest");
+
+  CHECK (copy_file_range (src, 1000, dst, 6000, 2000) == 2000,
+         "copy 2000 bytes to end of \"dest\"");
+  CHECK (pread (dst, block, 2000, 6000) == 2000, "read end of \"dest\"");
+  compare_bytes (block, buf + 1000, 2000, 6000, "dest");
+
+  CHECK (copy_file_range (src, 0, dst, 7000, 2000) == 1000,
+         "copy stops at end of \"dest\"");
+  CHECK (filesize (dst) == DST_SIZE, "filesize \"dest\" is %d", DST_SIZE);
+
+  CHECK (copy_file_range (src, 4000, dst, 0, 3000) == 1000,
+         "copy stops at end of \"source\"");
+  CHECK (copy_file_range (src, SRC_SIZE, dst, 0, 100) == 0,
+         "copy from end of \"source\" copies nothing");
+  CHECK (copy_file_range (src, 0, src, 100, 200) == -1,
+         "overlapping copy within \"source\" fails");
+
+  CHECK (tell (src) == SRC_SIZE, "tell \"source\" unchanged");
+  CHECK (tell (dst) == 0, "tell \"dest\" unchanged");
+
+  msg ("close \"source\"");
+  close (src);
+  msg ("close \"dest\"");
+  close (dst);
+}
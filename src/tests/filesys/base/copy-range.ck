@@ -0,0 +1,27 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(copy-range) begin
+(copy-range) create "source"
+(copy-range) create "dest"
+(copy-range) open "source"
+(copy-range) open "dest"
+(copy-range) write "source"
+(copy-range) copy all of "source" to "dest"
+(copy-range) read "dest"
+(copy-range) copy 2000 bytes to end of "dest"
+(copy-range) read end of "dest"
+(copy-range) copy stops at end of "dest"
+(copy-range) filesize "dest" is 8000
+(copy-range) copy stops at end of "source"
+(copy-range) copy from end of "source" copies nothing
+(copy-range) overlapping copy within "source" fails
+(copy-range) tell "source" unchanged
+(copy-range) tell "dest" unchanged
+(copy-range) close "source"
+(copy-range) close "dest"
+(copy-range) end
+EOF
+pass;
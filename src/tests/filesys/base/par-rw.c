@@ -0,0 +1,82 @@
+/* Spawns several child processes that each rewrite and re-read a
+   private file while all of them read one shared file, first one
+   at a time and then all at once, so that file I/O from different
+   processes can proceed in parallel.  Reports the throughput of
+   each run, which par-rw.ck compares, and checks every private
+   file's final contents. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/filesys/base/par-rw.h"
+#include "tests/cycles.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Bytes that all the children read and write in a run. */
+#define RUN_BYTES ((uint64_t) CHILD_CNT * ROUND_CNT * FILE_SIZE * 3)
+
+static char buf1[FILE_SIZE];
+static char buf2[FILE_SIZE];
+
+void
+test_main (void) 
+{
+  pid_t children[CHILD_CNT];
+  uint64_t serial, parallel;
+  size_t i;
+  int fd;
+
+  CHECK (create (shared_name, sizeof buf1), "create \"%s\"", shared_name);
+  CHECK ((fd = open (shared_name)) > 1, "open \"%s\"", shared_name);
+  random_init (0);
+  random_bytes (buf1, sizeof buf1);
+  CHECK (write (fd, buf1, sizeof buf1) > 0, "write \"%s\"", shared_name);
+  msg ("close \"%s\"", shared_name);
+  close (fd);
+
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      char file_name[16];
+      snprintf (file_name, sizeof file_name, "par%zu", i);
+      CHECK (create (file_name, FILE_SIZE), "create \"%s\"", file_name);
+    }
+
+  msg ("run children one at a time");
+  serial = cycles ();
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      char cmd_line[32];
+      pid_t child;
+
+      snprintf (cmd_line, sizeof cmd_line, "child-par-rw %zu", i);
+      if ((child = exec (cmd_line)) == PID_ERROR
+          || wait (child) != (int) i)
+        fail ("run \"%s\"", cmd_line);
+    }
+  serial = cycles () - serial;
+
+  parallel = cycles ();
+  exec_children ("child-par-rw", children, CHILD_CNT);
+  wait_children (children, CHILD_CNT);
+  parallel = cycles () - parallel;
+
+  msg ("serial throughput: %llu bytes per million cycles",
+       bytes_per_mcycle (RUN_BYTES, serial));
+  msg ("parallel throughput: %llu bytes per million cycles",
+       bytes_per_mcycle (RUN_BYTES, parallel));
+
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      char file_name[16];
+      snprintf (file_name, sizeof file_name, "par%zu", i);
+      CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+      CHECK (read (fd, buf1, sizeof buf1) == (int) sizeof buf1,
+             "read \"%s\"", file_name);
+      random_init (i + 1);
+      random_bytes (buf2, sizeof buf2);
+      compare_bytes (buf1, buf2, sizeof buf1, 0, file_name);
+      msg ("close \"%s\"", file_name);
+      close (fd);
+    }
+}
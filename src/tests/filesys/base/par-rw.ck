@@ -0,0 +1,54 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# Running the children side by side must not cost much more than
+# running them one after another, as it would if their file I/O
+# were serialized behind each other's disk waits.
+my ($serial) = map (/serial throughput: (\d+)/, @output);
+my ($parallel) = map (/parallel throughput: (\d+)/, @output);
+fail "missing throughput report\n"
+  if !defined ($serial) || !defined ($parallel);
+@output = grep (!/ throughput: /, @output);
+
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(par-rw) begin
+(par-rw) create "shared"
+(par-rw) open "shared"
+(par-rw) write "shared"
+(par-rw) close "shared"
+(par-rw) create "par0"
+(par-rw) create "par1"
+(par-rw) create "par2"
+(par-rw) create "par3"
+(par-rw) run children one at a time
+(par-rw) exec child 1 of 4: "child-par-rw 0"
+(par-rw) exec child 2 of 4: "child-par-rw 1"
+(par-rw) exec child 3 of 4: "child-par-rw 2"
+(par-rw) exec child 4 of 4: "child-par-rw 3"
+(par-rw) wait for child 1 of 4 returned 0 (expected 0)
+(par-rw) wait for child 2 of 4 returned 1 (expected 1)
+(par-rw) wait for child 3 of 4 returned 2 (expected 2)
+(par-rw) wait for child 4 of 4 returned 3 (expected 3)
+(par-rw) open "par0"
+(par-rw) read "par0"
+(par-rw) close "par0"
+(par-rw) open "par1"
+(par-rw) read "par1"
+(par-rw) close "par1"
+(par-rw) open "par2"
+(par-rw) read "par2"
+(par-rw) close "par2"
+(par-rw) open "par3"
+(par-rw) read "par3"
+(par-rw) close "par3"
+(par-rw) end
+EOF
+fail "parallel throughput $parallel is less than half of serial "
+  . "throughput $serial bytes per million cycles\n"
+  if $parallel * 2 < $serial;
+pass "serial $serial, parallel $parallel bytes per million cycles";
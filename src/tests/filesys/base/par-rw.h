@@ -0,0 +1,10 @@
+#ifndef TESTS_FILESYS_BASE_PAR_RW_H
+#define TESTS_FILESYS_BASE_PAR_RW_H
+
+#define CHILD_CNT 4
+#define CHUNK_SIZE 512
+#define FILE_SIZE (16 * CHUNK_SIZE)
+#define ROUND_CNT 8
+static const char shared_name[] = "shared";
+
+#endif /* tests/filesys/base/par-rw.h */
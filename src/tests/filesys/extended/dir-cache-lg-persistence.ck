@@ -0,0 +1,8 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+my ($fs);
+$fs->{'big'}{"f$_"} = [''] foreach grep ($_ % 2, 0...199);
+check_archive ($fs);
+pass;
@@ -0,0 +1,85 @@
+/* Creates 200 files in one directory, more than the
+   directory-entry cache holds, and looks each of them up twice.
+   Then removes every other one and checks that exactly the rest
+   are left, both by lookup and by readdir. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 200
+
+static int inums[FILE_CNT];
+
+/* Returns the inode number of the file named NAME, or -1 if it
+   does not exist. */
+static int
+lookup (const char *name)
+{
+  int fd = open (name);
+  int inum;
+
+  if (fd < 2)
+    return -1;
+  inum = inumber (fd);
+  close (fd);
+  return inum;
+}
+
+void
+test_main (void) 
+{
+  char name[READDIR_MAX_LEN + 1];
+  char file_name[32];
+  int cnt;
+  int fd;
+  int i, j;
+
+  CHECK (mkdir ("big"), "mkdir \"big\"");
+  msg ("create %d files in \"big\"", FILE_CNT);
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (file_name, sizeof file_name, "big/f%d", i);
+      if (!create (file_name, 0))
+        fail ("create \"%s\"", file_name);
+    }
+
+  msg ("look up each file twice");
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (file_name, sizeof file_name, "big/f%d", i);
+      inums[i] = lookup (file_name);
+      if (inums[i] < 0 || lookup (file_name) != inums[i])
+        fail ("lookup \"%s\"", file_name);
+      for (j = 0; j < i; j++)
+        if (inums[j] == inums[i])
+          fail ("\"big/f%d\" and \"%s\" are the same file", j, file_name);
+    }
+
+  msg ("remove every other file");
+  for (i = 0; i < FILE_CNT; i += 2)
+    {
+      snprintf (file_name, sizeof file_name, "big/f%d", i);
+      if (!remove (file_name))
+        fail ("remove \"%s\"", file_name);
+    }
+
+  msg ("look up each file again");
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (file_name, sizeof file_name, "big/f%d", i);
+      if (i % 2 == 0 && lookup (file_name) != -1)
+        fail ("removed \"%s\" is still there", file_name);
+      if (i % 2 == 1 && lookup (file_name) != inums[i])
+        fail ("lookup \"%s\" after removals", file_name);
+    }
+
+  CHECK ((fd = open ("big")) > 1, "open \"big\"");
+  for (cnt = 0; readdir (fd, name); cnt++)
+    if (name[0] != 'f' || atoi (name + 1) % 2 != 1)
+      fail ("readdir returned \"%s\"", name);
+  CHECK (cnt == FILE_CNT / 2, "readdir \"big\" returned %d names", cnt);
+  close (fd);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(dir-cache-lg) begin
+(dir-cache-lg) mkdir "big"
+(dir-cache-lg) create 200 files in "big"
+(dir-cache-lg) look up each file twice
+(dir-cache-lg) remove every other file
+(dir-cache-lg) look up each file again
+(dir-cache-lg) open "big"
+(dir-cache-lg) readdir "big" returned 100 names
+(dir-cache-lg) end
+EOF
+pass;
@@ -0,0 +1,39 @@
+/* Removes names that the directory-entry cache holds, and checks
+   that lookups notice: a removed file can no longer be opened,
+   and a directory or file created under the same name is found
+   instead of the old one.  There is no rename system call, so
+   removing and re-creating is how a name comes to refer to
+   something else. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int fd;
+
+  CHECK (mkdir ("d"), "mkdir \"d\"");
+  CHECK (create ("d/x", 0), "create \"d/x\"");
+  CHECK ((fd = open ("d/x")) > 1, "open \"d/x\"");
+  close (fd);
+  CHECK (remove ("d/x"), "remove \"d/x\"");
+  CHECK (open ("d/x") == -1, "open \"d/x\" (must fail)");
+
+  CHECK (mkdir ("d/x"), "mkdir \"d/x\"");
+  CHECK ((fd = open ("d/x")) > 1, "open \"d/x\"");
+  CHECK (isdir (fd), "\"d/x\" is a directory now");
+  close (fd);
+  CHECK (create ("d/x/y", 0), "create \"d/x/y\"");
+  CHECK ((fd = open ("d/x/y")) > 1, "open \"d/x/y\"");
+  close (fd);
+
+  CHECK (remove ("d/x/y"), "remove \"d/x/y\"");
+  CHECK (remove ("d/x"), "remove \"d/x\"");
+  CHECK (create ("d/x", 0), "create \"d/x\"");
+  CHECK ((fd = open ("d/x")) > 1, "open \"d/x\"");
+  CHECK (!isdir (fd), "\"d/x\" is a file again");
+  close (fd);
+  CHECK (open ("d/x/y") == -1, "open \"d/x/y\" (must fail)");
+}
@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(dir-cache-rm) begin
+(dir-cache-rm) mkdir "d"
+(dir-cache-rm) create "d/x"
+(dir-cache-rm) open "d/x"
+(dir-cache-rm) remove "d/x"
+(dir-cache-rm) open "d/x" (must fail)
+(dir-cache-rm) mkdir "d/x"
+(dir-cache-rm) open "d/x"
+(dir-cache-rm) "d/x" is a directory now
+(dir-cache-rm) create "d/x/y"
+(dir-cache-rm) open "d/x/y"
+(dir-cache-rm) remove "d/x/y"
+(dir-cache-rm) remove "d/x"
+(dir-cache-rm) create "d/x"
+(dir-cache-rm) open "d/x"
+(dir-cache-rm) "d/x" is a file again
+(dir-cache-rm) open "d/x/y" (must fail)
+(dir-cache-rm) end
+EOF
+pass;
@@ -0,0 +1,49 @@
+/* Looks up the same names over and over, by absolute and relative
+   paths, as the directory-entry cache comes to serve them.  Checks
+   that they keep resolving to the same files, that a name in one
+   directory never resolves to the same name in another, and that
+   a missing name stays missing. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Returns the inode number of the file named NAME. */
+static int
+lookup (const char *name)
+{
+  int fd = open (name);
+  int inum;
+
+  if (fd < 2)
+    fail ("open \"%s\"", name);
+  inum = inumber (fd);
+  close (fd);
+  return inum;
+}
+
+void
+test_main (void) 
+{
+  int a_n, b_n;
+  int i;
+
+  CHECK (mkdir ("a"), "mkdir \"a\"");
+  CHECK (mkdir ("b"), "mkdir \"b\"");
+  CHECK (create ("a/n", 0), "create \"a/n\"");
+  CHECK (create ("b/n", 0), "create \"b/n\"");
+  a_n = lookup ("a/n");
+  b_n = lookup ("b/n");
+  CHECK (a_n != b_n, "\"a/n\" and \"b/n\" are different files");
+
+  msg ("look up \"/a/n\" and \"/b/n\" 100 times");
+  for (i = 0; i < 100; i++)
+    if (lookup ("/a/n") != a_n || lookup ("/b/n") != b_n)
+      fail ("lookup %d found the wrong file", i);
+
+  CHECK (chdir ("a"), "chdir \"a\"");
+  CHECK (lookup ("n") == a_n, "\"n\" is \"a/n\"");
+  CHECK (lookup ("../b/n") == b_n, "\"../b/n\" is \"b/n\"");
+  CHECK (open ("m") == -1, "open \"m\" (must fail)");
+  CHECK (open ("m") == -1, "open \"m\" again (must fail)");
+}
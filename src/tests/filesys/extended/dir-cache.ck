@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(dir-cache) begin
+(dir-cache) mkdir "a"
+(dir-cache) mkdir "b"
+(dir-cache) create "a/n"
+(dir-cache) create "b/n"
+(dir-cache) "a/n" and "b/n" are different files
+(dir-cache) look up "/a/n" and "/b/n" 100 times
+(dir-cache) chdir "a"
+(dir-cache) "n" is "a/n"
+(dir-cache) "../b/n" is "b/n"
+(dir-cache) open "m" (must fail)
+(dir-cache) open "m" again (must fail)
+(dir-cache) end
+EOF
+pass;
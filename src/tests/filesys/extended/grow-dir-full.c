@@ -0,0 +1,65 @@
+/* Creates files in one directory until it is full, which happens
+   once it has as many buckets as a directory may and one of them
+   fills up.  Checks that it held a good many files by then, that
+   the failed create left nothing behind, and that removing a file
+   makes room for it again.  Then removes all of the files. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* More files than any directory can hold. */
+#define MAX_FILES 2000
+
+/* Fewer files than a full directory should hold. */
+#define MIN_FILES 500
+
+void
+test_main (void) 
+{
+  char name[READDIR_MAX_LEN + 1];
+  char file_name[32];
+  int file_cnt, cnt;
+  int fd;
+  int i;
+
+  CHECK (mkdir ("full"), "mkdir \"full\"");
+  msg ("create files in \"full\" until it is full");
+  for (file_cnt = 0; file_cnt < MAX_FILES; file_cnt++)
+    {
+      snprintf (file_name, sizeof file_name, "full/f%d", file_cnt);
+      if (!create (file_name, 0))
+        break;
+    }
+  if (file_cnt == MAX_FILES)
+    fail ("\"full\" took %d files without filling up", MAX_FILES);
+  if (file_cnt < MIN_FILES)
+    fail ("\"full\" filled up after only %d files", file_cnt);
+  msg ("\"full\" filled up after at least %d files", MIN_FILES);
+
+  CHECK (open (file_name) == -1, "open \"full/f<failed>\" fails");
+  CHECK ((fd = open ("full")) > 1, "open \"full\"");
+  for (cnt = 0; readdir (fd, name); cnt++)
+    continue;
+  if (cnt != file_cnt)
+    fail ("readdir \"full\" returned %d names, expected %d", cnt, file_cnt);
+  msg ("readdir \"full\" returned every file");
+  msg ("close \"full\"");
+  close (fd);
+
+  CHECK (remove ("full/f0"), "remove \"full/f0\"");
+  CHECK (create ("full/f0", 0), "create \"full/f0\" again");
+
+  msg ("remove every file in \"full\"");
+  for (i = 0; i < file_cnt; i++)
+    {
+      snprintf (file_name, sizeof file_name, "full/f%d", i);
+      if (!remove (file_name))
+        fail ("remove \"%s\"", file_name);
+    }
+  CHECK ((fd = open ("full")) > 1, "open \"full\"");
+  CHECK (!readdir (fd, name), "readdir \"full\" returns nothing");
+  msg ("close \"full\"");
+  close (fd);
+}
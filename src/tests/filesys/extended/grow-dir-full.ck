@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-dir-full) begin
+(grow-dir-full) mkdir "full"
+(grow-dir-full) create files in "full" until it is full
+(grow-dir-full) "full" filled up after at least 500 files
+(grow-dir-full) open "full/f<failed>" fails
+(grow-dir-full) open "full"
+(grow-dir-full) readdir "full" returned every file
+(grow-dir-full) close "full"
+(grow-dir-full) remove "full/f0"
+(grow-dir-full) create "full/f0" again
+(grow-dir-full) remove every file in "full"
+(grow-dir-full) open "full"
+(grow-dir-full) readdir "full" returns nothing
+(grow-dir-full) close "full"
+(grow-dir-full) end
+EOF
+pass;
@@ -0,0 +1,53 @@
+/* Checks that the timer keeps counting ticks correctly while the
+   idle thread waits tickless.  Calibrates the CPU cycle counter
+   against the timer while it ticks periodically, then sleeps for
+   a range of lengths, some longer than one PIT count can cover,
+   and compares the ticks that passed with the cycles that did.
+   Lost ticks would make the sleeps run long, so that more cycles
+   pass than the ticks account for. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Ticks to calibrate the cycle counter over. */
+#define BUSY_TICKS 50
+
+/* Number of sleeps, of 1, 2, ..., SLEEP_CNT ticks. */
+#define SLEEP_CNT 20
+
+void
+test_alarm_idle (void) 
+{
+  int64_t start, ticks, expected;
+  uint64_t begin, busy_cycles, idle_cycles;
+  int i;
+
+  /* Count cycles per tick while busy, starting on a tick
+     boundary. */
+  start = timer_ticks ();
+  while (timer_ticks () == start)
+    continue;
+  start = timer_ticks ();
+  begin = timer_cycles ();
+  while (timer_elapsed (start) < BUSY_TICKS)
+    continue;
+  busy_cycles = timer_cycles () - begin;
+
+  /* Sleep with nothing else to run. */
+  start = timer_ticks ();
+  begin = timer_cycles ();
+  for (i = 1; i <= SLEEP_CNT; i++)
+    timer_sleep (i);
+  ticks = timer_elapsed (start);
+  idle_cycles = timer_cycles () - begin;
+
+  /* Allow 10% either way for the granularity of the sleeps and
+     for drift between the two clocks. */
+  expected = idle_cycles * BUSY_TICKS / busy_cycles;
+  if (ticks * 10 < expected * 9 || ticks * 10 > expected * 11)
+    fail ("%lld ticks passed while sleeping, but the cycle counter "
+          "says %lld did", ticks, expected);
+  pass ();
+}
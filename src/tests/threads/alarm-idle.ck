@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(alarm-idle) begin
+(alarm-idle) PASS
+(alarm-idle) end
+EOF
+pass;
@@ -0,0 +1,64 @@
+/* Checks that console output is line buffered per thread.
+   Several threads each print a line a piece at a time, through
+   printf(), putchar() and putbuf(), and yield the CPU after
+   every piece.  Without line buffering their pieces would come
+   out interleaved; with it, every line must come out whole. */
+
+#include <console.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define THREAD_CNT 4
+#define PIECE_CNT 8
+
+struct printer
+  {
+    int id;                     /* Printer number. */
+    struct semaphore *done;     /* Up'd when the line is printed. */
+  };
+
+static thread_func printer_func;
+
+void
+test_console_lines (void) 
+{
+  struct printer printers[THREAD_CNT];
+  struct semaphore done;
+  int i;
+
+  msg ("%d threads print a line %d pieces at a time",
+       THREAD_CNT, PIECE_CNT);
+  sema_init (&done, 0);
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      char name[16];
+      printers[i].id = i;
+      printers[i].done = &done;
+      snprintf (name, sizeof name, "printer %d", i);
+      thread_create (name, PRI_DEFAULT, printer_func, &printers[i]);
+    }
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&done);
+  msg ("all lines printed");
+}
+
+static void
+printer_func (void *p_) 
+{
+  struct printer *p = p_;
+  int i;
+
+  printf ("(console-lines) thread %d:", p->id);
+  thread_yield ();
+  for (i = 0; i < PIECE_CNT; i++) 
+    {
+      putchar (' ');
+      thread_yield ();
+      printf ("%d", i);
+      thread_yield ();
+    }
+  putbuf (".\n", 2);
+  sema_up (p->done);
+}
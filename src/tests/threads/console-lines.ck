@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# The threads may finish their lines in any order, but each line
+# must come out whole.
+my (@lines) = sort grep (/^\(console-lines\) thread /, @output);
+@output = grep (!/^\(console-lines\) thread /, @output);
+compare_output ("run", \@output, [<<'EOF']);
+(console-lines) begin
+(console-lines) 4 threads print a line 8 pieces at a time
+(console-lines) all lines printed
+(console-lines) end
+EOF
+my (@expected) = map ("(console-lines) thread $_: 0 1 2 3 4 5 6 7.", 0...3);
+fail "expected lines:\n", map ("  $_\n", @expected),
+  "but got:\n", map ("  $_\n", @lines), "\n"
+  if "@lines" ne "@expected";
+pass;
@@ -0,0 +1,67 @@
+/* Checks the line editing and line splitting that input_read()
+   does, by putting keys straight into the input buffer and
+   reading them back. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/interrupt.h"
+#include "devices/input.h"
+
+static void put_keys (const char *);
+static void check_read (size_t n, const char *expected);
+
+void
+test_input_edit (void) 
+{
+  /* A line per read, with its terminator. */
+  put_keys ("one\ntwo\r");
+  check_read (64, "one\n");
+  check_read (64, "two\r");
+
+  /* A new-line after a carriage return, even one typed later,
+     does not make an empty line. */
+  put_keys ("\nthree\r\nfour\n");
+  check_read (64, "three\r");
+  check_read (64, "four\n");
+
+  /* Erase and kill. */
+  put_keys ("fiv\bve\n" "sx\177ix\n" "junk\025seven\n");
+  check_read (64, "five\n");
+  check_read (64, "six\n");
+  check_read (64, "seven\n");
+
+  /* Reads end after N keys, even mid-line, and with nothing to
+     erase, erase and kill keys are read like others. */
+  put_keys ("eight\n" "\b" "\025");
+  check_read (3, "eig");
+  check_read (64, "ht\n");
+  check_read (1, "\b");
+  check_read (1, "\025");
+
+  pass ();
+}
+
+/* Puts KEYS into the input buffer, as if they were typed. */
+static void
+put_keys (const char *keys) 
+{
+  enum intr_level old_level = intr_disable ();
+  while (*keys != '\0')
+    input_putc (*keys++);
+  intr_set_level (old_level);
+}
+
+/* Reads up to N keys and checks that they are EXPECTED. */
+static void
+check_read (size_t n, const char *expected) 
+{
+  char buf[64];
+  size_t len = strlen (expected);
+  size_t cnt;
+
+  ASSERT (n <= sizeof buf);
+  cnt = input_read (buf, n);
+  if (cnt != len || memcmp (buf, expected, len))
+    fail ("input_read() returned %zu keys, expected %zu", cnt, len);
+}
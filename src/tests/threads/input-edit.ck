@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(input-edit) begin
+(input-edit) PASS
+(input-edit) end
+EOF
+pass;
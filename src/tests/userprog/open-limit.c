@@ -0,0 +1,26 @@
+/* Lowers the process's file descriptor limit with setfdlimit()
+   and checks that open() honors it, that closing a descriptor
+   makes room again, and that limits below 2 or above the
+   system-wide default are refused. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int h1, h2;
+
+  CHECK (!setfdlimit (1), "setfdlimit (1) fails");
+  CHECK (!setfdlimit (1000000), "setfdlimit (1000000) fails");
+  CHECK (setfdlimit (4), "setfdlimit (4)");
+  CHECK ((h1 = open ("sample.txt")) > 1, "open \"sample.txt\" once");
+  CHECK ((h2 = open ("sample.txt")) > 1, "open \"sample.txt\" again");
+  CHECK (open ("sample.txt") == -1, "open \"sample.txt\" over the limit");
+  msg ("close \"sample.txt\"");
+  close (h1);
+  CHECK (open ("sample.txt") == h1, "open \"sample.txt\" after close");
+  CHECK (setfdlimit (128), "setfdlimit (128)");
+  CHECK (open ("sample.txt") > 1, "open \"sample.txt\" with higher limit");
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(open-limit) begin
+(open-limit) setfdlimit (1) fails
+(open-limit) setfdlimit (1000000) fails
+(open-limit) setfdlimit (4)
+(open-limit) open "sample.txt" once
+(open-limit) open "sample.txt" again
+(open-limit) open "sample.txt" over the limit
+(open-limit) close "sample.txt"
+(open-limit) open "sample.txt" after close
+(open-limit) setfdlimit (128)
+(open-limit) open "sample.txt" with higher limit
+(open-limit) end
+open-limit: exit(0)
+EOF
+pass;
@@ -0,0 +1,32 @@
+/* Reads parts of a file with pread() and checks that the file
+   position does not move. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char buf[64];
+  int handle, byte_cnt;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  byte_cnt = pread (handle, buf, 40, 100);
+  if (byte_cnt != 40)
+    fail ("pread() returned %d instead of 40", byte_cnt);
+  compare_bytes (buf, sample + 100, 40, 100, "sample.txt");
+  CHECK (tell (handle) == 0, "file position still 0");
+
+  byte_cnt = pread (handle, buf, sizeof buf, sizeof sample - 11);
+  if (byte_cnt != 10)
+    fail ("pread() at end returned %d instead of 10", byte_cnt);
+  compare_bytes (buf, sample + sizeof sample - 11, 10, sizeof sample - 11,
+                 "sample.txt");
+
+  CHECK (pread (handle, buf, sizeof buf, sizeof sample + 100) == 0,
+         "pread() past end of file");
+}
@@ -0,0 +1,26 @@
+/* Reads a file into three buffers with one readv(). */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  static char a[10], b[100], c[sizeof sample];
+  struct iovec iov[3] = {{a, sizeof a}, {b, sizeof b}, {c, sizeof c}};
+  size_t size = sizeof sample - 1;
+  int handle, byte_cnt;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  byte_cnt = readv (handle, iov, 3);
+  if (byte_cnt != (int) size)
+    fail ("readv() returned %d instead of %zu", byte_cnt, size);
+  compare_bytes (a, sample, sizeof a, 0, "sample.txt");
+  compare_bytes (b, sample + sizeof a, sizeof b, sizeof a, "sample.txt");
+  compare_bytes (c, sample + sizeof a + sizeof b, size - sizeof a - sizeof b,
+                 sizeof a + sizeof b, "sample.txt");
+  CHECK (tell (handle) == size, "file position at end");
+}
@@ -0,0 +1,34 @@
+/* Writes a file, and a line of console output, from several
+   buffers with one writev() each. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  static char line1[] = "(writev-normal) gathered ";
+  static char line2[] = "console line\n";
+  struct iovec con[2] = {{line1, sizeof line1 - 1}, {line2, sizeof line2 - 1}};
+  size_t size = sizeof sample - 1;
+  struct iovec iov[3] = {{sample, 7},
+                         {sample + 7, 200},
+                         {sample + 207, size - 207}};
+  int handle, byte_cnt;
+
+  CHECK (create ("test.txt", size), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+  byte_cnt = writev (handle, iov, 3);
+  if (byte_cnt != (int) size)
+    fail ("writev() returned %d instead of %zu", byte_cnt, size);
+  msg ("close \"test.txt\"");
+  close (handle);
+  check_file ("test.txt", sample, size);
+
+  byte_cnt = writev (STDOUT_FILENO, con, 2);
+  if (byte_cnt != (int) (sizeof line1 + sizeof line2 - 2))
+    fail ("writev() to console returned %d", byte_cnt);
+}
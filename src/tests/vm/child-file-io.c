@@ -0,0 +1,43 @@
+/* Child process for page-merge-io test.
+   Repeatedly rewrites a 64 kB file and reads it back, keeping
+   the file system disk busy while the parent pages to swap. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+#define FILE_SIZE (64 * 1024)
+#define ROUND_CNT 16
+
+static char data[FILE_SIZE];
+static char buf[FILE_SIZE];
+
+int
+main (void)
+{
+  static const char file_name[] = "io-file";
+  int fd;
+  int round;
+
+  test_name = "child-file-io";
+  quiet = true;
+
+  random_init (0);
+  random_bytes (data, sizeof data);
+
+  CHECK (create (file_name, FILE_SIZE), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  for (round = 0; round < ROUND_CNT; round++)
+    {
+      seek (fd, 0);
+      CHECK (write (fd, data, sizeof data) == (int) sizeof data,
+             "write \"%s\"", file_name);
+      seek (fd, 0);
+      CHECK (read (fd, buf, sizeof buf) == (int) sizeof buf,
+             "read \"%s\"", file_name);
+      compare_bytes (buf, data, sizeof buf, 0, file_name);
+    }
+  close (fd);
+
+  return 0;
+}
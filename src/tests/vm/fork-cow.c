@@ -0,0 +1,42 @@
+/* Forks after filling 1 MB of memory, and checks that the child
+   sees its contents and that the child's changes don't reach the
+   parent.  Both copies don't fit in memory together, so some of
+   the pages the processes share are swapped out. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (1024 * 1024)
+
+static char buf[SIZE];
+
+void
+test_main (void)
+{
+  size_t i;
+  pid_t pid;
+
+  for (i = 0; i < SIZE; i++)
+    buf[i] = i % 251;
+  msg ("initialize");
+
+  pid = fork ();
+  if (pid == 0)
+    {
+      for (i = 0; i < SIZE; i++)
+        if (buf[i] != (char) (i % 251))
+          fail ("child: byte %zu is %02hhx", i, buf[i]);
+      msg ("child sees the parent's data");
+      for (i = 0; i < SIZE; i++)
+        buf[i] = ~buf[i];
+      msg ("child changed its copy");
+      exit (81);
+    }
+  CHECK (pid > 0 && wait (pid) == 81, "fork and wait for child");
+
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != (char) (i % 251))
+      fail ("parent: byte %zu is %02hhx", i, buf[i]);
+  msg ("parent's data is unchanged");
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fork-cow) begin
+(fork-cow) initialize
+(fork-cow) child sees the parent's data
+(fork-cow) child changed its copy
+(fork-cow) fork and wait for child
+(fork-cow) parent's data is unchanged
+(fork-cow) end
+EOF
+pass;
@@ -0,0 +1,45 @@
+/* Forks with a file open and mapped privately, and checks that the
+   child inherits both: it reads on from the parent's position and
+   sees the parent's change to the mapping, while its own reads and
+   writes leave the parent's alone. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((char *) 0x10000000)
+
+void
+test_main (void)
+{
+  char buf[10];
+  int handle;
+  pid_t pid;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (read (handle, buf, 10) == 10, "read \"sample.txt\"");
+  CHECK (mmap2 (handle, ACTUAL, 0, 0, MAP_PRIVATE) != MAP_FAILED,
+         "mmap2 \"sample.txt\" private");
+  ACTUAL[0] = 'x';
+
+  pid = fork ();
+  if (pid == 0)
+    {
+      CHECK (tell (handle) == 10 && read (handle, buf, 10) == 10
+             && !memcmp (buf, sample + 10, 10),
+             "child reads on from the parent's position");
+      CHECK (ACTUAL[0] == 'x' && ACTUAL[1] == sample[1],
+             "child sees the parent's mapping");
+      ACTUAL[0] = 'y';
+      CHECK (munmap_range (ACTUAL, 4096) == 0, "child unmaps its copy");
+      exit (81);
+    }
+  CHECK (pid > 0 && wait (pid) == 81, "fork and wait for child");
+
+  CHECK (tell (handle) == 10, "parent's position is unchanged");
+  CHECK (ACTUAL[0] == 'x' && ACTUAL[1] == sample[1],
+         "parent's mapping is unchanged");
+  close (handle);
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fork-files) begin
+(fork-files) open "sample.txt"
+(fork-files) read "sample.txt"
+(fork-files) mmap2 "sample.txt" private
+(fork-files) child reads on from the parent's position
+(fork-files) child sees the parent's mapping
+(fork-files) child unmaps its copy
+(fork-files) fork and wait for child
+(fork-files) parent's position is unchanged
+(fork-files) parent's mapping is unchanged
+(fork-files) end
+EOF
+pass;
@@ -0,0 +1,51 @@
+/* Uses madvise(MADV_DONTNEED) on anonymous memory, on a private
+   file mapping, and on a shared file mapping, and checks what each
+   reads back afterward. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ANON ((char *) 0x10000000)
+#define PRIVATE ((char *) 0x20000000)
+#define SHARED ((char *) 0x30000000)
+
+void
+test_main (void)
+{
+  char buf[1024];
+  int handle;
+
+  CHECK (mmap2 (-1, ANON, 4096, 0, MAP_PRIVATE | MAP_ANONYMOUS)
+         != MAP_FAILED, "mmap2 anonymous memory");
+  memset (ANON, 'x', 4096);
+  CHECK (madvise (ANON, 4096, MADV_DONTNEED) == 0,
+         "madvise anonymous memory DONTNEED");
+  CHECK (ANON[0] == 0 && ANON[4095] == 0, "anonymous memory is zeroed");
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (mmap2 (handle, PRIVATE, 0, 0, MAP_PRIVATE) != MAP_FAILED,
+         "mmap2 \"sample.txt\" private");
+  memset (PRIVATE, 'x', 100);
+  CHECK (madvise (PRIVATE, 4096, MADV_DONTNEED) == 0,
+         "madvise private mapping DONTNEED");
+  CHECK (!memcmp (PRIVATE, sample, strlen (sample)),
+         "private mapping reads the file again");
+
+  CHECK (mmap2 (handle, SHARED, 0, 0, MAP_SHARED) != MAP_FAILED,
+         "mmap2 \"sample.txt\" shared");
+  memset (SHARED, 'y', 100);
+  CHECK (madvise (SHARED, 4096, MADV_DONTNEED) == 0,
+         "madvise shared mapping DONTNEED");
+  CHECK (SHARED[0] == 'y' && SHARED[99] == 'y' && SHARED[100] == sample[100],
+         "shared mapping kept its changes");
+  CHECK (pread (handle, buf, 100, 0) == 100 && buf[0] == 'y' && buf[99] == 'y',
+         "changes reached the file");
+
+  CHECK (madvise (ANON, 4096, 99) == -1, "unknown advice must fail");
+  CHECK (madvise (ANON + 0x1000000, 4096, MADV_DONTNEED) == -1,
+         "madvise of unmapped memory must fail");
+  close (handle);
+}
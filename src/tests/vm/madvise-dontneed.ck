@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(madvise-dontneed) begin
+(madvise-dontneed) mmap2 anonymous memory
+(madvise-dontneed) madvise anonymous memory DONTNEED
+(madvise-dontneed) anonymous memory is zeroed
+(madvise-dontneed) open "sample.txt"
+(madvise-dontneed) mmap2 "sample.txt" private
+(madvise-dontneed) madvise private mapping DONTNEED
+(madvise-dontneed) private mapping reads the file again
+(madvise-dontneed) mmap2 "sample.txt" shared
+(madvise-dontneed) madvise shared mapping DONTNEED
+(madvise-dontneed) shared mapping kept its changes
+(madvise-dontneed) changes reached the file
+(madvise-dontneed) unknown advice must fail
+(madvise-dontneed) madvise of unmapped memory must fail
+(madvise-dontneed) end
+EOF
+pass;
@@ -0,0 +1,57 @@
+/* Writes a 256 kB file, maps it, and reads it through the mapping
+   with MADV_SEQUENTIAL, then with MADV_RANDOM after MADV_WILLNEED,
+   checking the data each time. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((char *) 0x10000000)
+#define SIZE (256 * 1024)
+
+static char buf[4096];
+
+/* Checks that the mapping holds the pattern written to the file. */
+static void
+check_mapping (const char *how)
+{
+  size_t i;
+
+  for (i = 0; i < SIZE; i++)
+    if (ACTUAL[i] != (char) (i / 4096 + i))
+      fail ("byte %zu of mapping is wrong when %s", i, how);
+  msg ("mapping is correct when %s", how);
+}
+
+void
+test_main (void)
+{
+  int handle;
+  size_t i;
+
+  CHECK (create ("data", SIZE), "create \"data\"");
+  CHECK ((handle = open ("data")) > 1, "open \"data\"");
+  for (i = 0; i < SIZE; i += sizeof buf)
+    {
+      size_t j;
+
+      for (j = 0; j < sizeof buf; j++)
+        buf[j] = (i + j) / 4096 + (i + j);
+      if (write (handle, buf, sizeof buf) != sizeof buf)
+        fail ("write at offset %zu failed", i);
+    }
+
+  CHECK (mmap2 (handle, ACTUAL, 0, 0, MAP_PRIVATE) != MAP_FAILED,
+         "mmap2 \"data\"");
+  CHECK (madvise (ACTUAL, SIZE, MADV_SEQUENTIAL) == 0,
+         "madvise SEQUENTIAL");
+  check_mapping ("read sequentially");
+
+  CHECK (madvise (ACTUAL, SIZE, MADV_DONTNEED) == 0, "madvise DONTNEED");
+  CHECK (madvise (ACTUAL, SIZE, MADV_RANDOM) == 0, "madvise RANDOM");
+  CHECK (madvise (ACTUAL, SIZE / 2, MADV_WILLNEED) == 0,
+         "madvise WILLNEED on first half");
+  check_mapping ("read randomly");
+  close (handle);
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(madvise-seq) begin
+(madvise-seq) create "data"
+(madvise-seq) open "data"
+(madvise-seq) mmap2 "data"
+(madvise-seq) madvise SEQUENTIAL
+(madvise-seq) mapping is correct when read sequentially
+(madvise-seq) madvise DONTNEED
+(madvise-seq) madvise RANDOM
+(madvise-seq) madvise WILLNEED on first half
+(madvise-seq) mapping is correct when read randomly
+(madvise-seq) end
+EOF
+pass;
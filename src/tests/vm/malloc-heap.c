@@ -0,0 +1,83 @@
+/* Allocates blocks of many sizes with malloc, fills each with its
+   own pattern, frees and reallocates some of them, and verifies
+   that no block was overwritten.  Then checks that freeing
+   everything gives the heap back. */
+
+#include <malloc.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define BLOCK_CNT 200
+
+static char *blocks[BLOCK_CNT];
+static size_t sizes[BLOCK_CNT];
+
+/* Checks that block I still holds its pattern. */
+static void
+check_block (size_t i)
+{
+  size_t j;
+
+  for (j = 0; j < sizes[i]; j++)
+    if (blocks[i][j] != (char) (i + j))
+      fail ("byte %zu of block %zu (size %zu) was overwritten",
+            j, i, sizes[i]);
+}
+
+/* Allocates block I with SIZE bytes and fills in its pattern. */
+static void
+alloc_block (size_t i, size_t size)
+{
+  size_t j;
+
+  sizes[i] = size;
+  blocks[i] = malloc (size);
+  if (blocks[i] == NULL)
+    fail ("malloc of %zu bytes failed", size);
+  for (j = 0; j < size; j++)
+    blocks[i][j] = i + j;
+}
+
+void
+test_main (void)
+{
+  void *start = sbrk (0);
+  size_t i;
+
+  /* Sizes from 1 byte to about 20 kB, small ones most often. */
+  for (i = 0; i < BLOCK_CNT; i++)
+    alloc_block (i, 1 + (i * i * 37) % (i % 4 == 0 ? 20000 : 700));
+  for (i = 0; i < BLOCK_CNT; i++)
+    check_block (i);
+  msg ("malloc %d blocks", BLOCK_CNT);
+
+  for (i = 0; i < BLOCK_CNT; i += 2)
+    free (blocks[i]);
+  for (i = 1; i < BLOCK_CNT; i += 2)
+    check_block (i);
+  msg ("free every other block");
+
+  for (i = 0; i < BLOCK_CNT; i += 2)
+    alloc_block (i, 1 + (i * 53) % 3000);
+  for (i = 1; i < BLOCK_CNT; i += 4)
+    {
+      size_t old_size = sizes[i];
+      size_t j;
+
+      sizes[i] = old_size * 3 + 5000;
+      blocks[i] = realloc (blocks[i], sizes[i]);
+      if (blocks[i] == NULL)
+        fail ("realloc of block %zu failed", i);
+      for (j = old_size; j < sizes[i]; j++)
+        blocks[i][j] = i + j;
+    }
+  for (i = 0; i < BLOCK_CNT; i++)
+    check_block (i);
+  msg ("malloc and realloc again");
+
+  for (i = 0; i < BLOCK_CNT; i++)
+    free (blocks[i]);
+  CHECK (sbrk (0) == start, "free everything gives the heap back");
+}
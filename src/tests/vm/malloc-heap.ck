@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(malloc-heap) begin
+(malloc-heap) malloc 200 blocks
+(malloc-heap) free every other block
+(malloc-heap) malloc and realloc again
+(malloc-heap) free everything gives the heap back
+(malloc-heap) end
+EOF
+pass;
@@ -0,0 +1,41 @@
+/* Maps anonymous memory, checks that it is zeroed and usable, and
+   that it can be unmapped. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((char *) 0x10000000)
+#define SIZE (16 * 4096)
+
+void
+test_main (void)
+{
+  mapid_t map;
+  size_t i;
+
+  CHECK ((map = mmap2 (-1, ACTUAL, SIZE, 0, MAP_PRIVATE | MAP_ANONYMOUS))
+         != MAP_FAILED, "mmap2 anonymous memory");
+  for (i = 0; i < SIZE; i++)
+    if (ACTUAL[i] != 0)
+      fail ("byte %zu of anonymous memory is %02hhx instead of 0",
+            i, ACTUAL[i]);
+  msg ("anonymous memory is zeroed");
+
+  for (i = 0; i < SIZE; i++)
+    ACTUAL[i] = i % 251;
+  for (i = 0; i < SIZE; i++)
+    if (ACTUAL[i] != (char) (i % 251))
+      fail ("byte %zu of anonymous memory changed", i);
+  msg ("anonymous memory holds data");
+
+  CHECK (mmap2 (-1, ACTUAL, 0, 0, MAP_PRIVATE | MAP_ANONYMOUS) == MAP_FAILED,
+         "mmap2 of zero-length anonymous memory must fail");
+
+  munmap (map);
+  CHECK ((map = mmap2 (-1, ACTUAL, 4096, 0, MAP_SHARED | MAP_ANONYMOUS))
+         != MAP_FAILED, "mmap2 again after munmap");
+  CHECK (ACTUAL[100] == 0, "new mapping is zeroed");
+  munmap (map);
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-anon) begin
+(mmap-anon) mmap2 anonymous memory
+(mmap-anon) anonymous memory is zeroed
+(mmap-anon) anonymous memory holds data
+(mmap-anon) mmap2 of zero-length anonymous memory must fail
+(mmap-anon) mmap2 again after munmap
+(mmap-anon) new mapping is zeroed
+(mmap-anon) end
+EOF
+pass;
@@ -0,0 +1,64 @@
+/* Maps pieces of a three-page file at page offsets, one of them
+   running past the end of the file, and uses msync to write a
+   change to one of them back while it stays mapped. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+#define ACTUAL ((char *) 0x10000000)
+
+static char buf[PAGE];
+
+/* Checks that the SIZE bytes at P are all C. */
+static void
+check_fill (const char *p, char c, size_t size, const char *what)
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    if (p[i] != c)
+      fail ("byte %zu of %s is %02hhx instead of %02hhx", i, what, p[i], c);
+  msg ("%s is correct", what);
+}
+
+void
+test_main (void)
+{
+  int handle;
+  int i;
+
+  CHECK (create ("data", 3 * PAGE), "create \"data\"");
+  CHECK ((handle = open ("data")) > 1, "open \"data\"");
+  for (i = 0; i < 3; i++)
+    {
+      memset (buf, 'a' + i, PAGE);
+      if (write (handle, buf, PAGE) != PAGE)
+        fail ("write page %d failed", i);
+    }
+
+  CHECK (mmap2 (handle, ACTUAL, PAGE, PAGE, MAP_SHARED | MAP_POPULATE)
+         != MAP_FAILED, "mmap2 second page");
+  check_fill (ACTUAL, 'b', PAGE, "second page");
+
+  CHECK (mmap2 (handle, ACTUAL + 0x10000, 2 * PAGE, 2 * PAGE, MAP_SHARED)
+         != MAP_FAILED, "mmap2 third page and beyond");
+  check_fill (ACTUAL + 0x10000, 'c', PAGE, "third page");
+  check_fill (ACTUAL + 0x10000 + PAGE, 0, PAGE, "page past end of file");
+
+  CHECK (mmap2 (handle, ACTUAL + 0x20000, PAGE, 100, MAP_SHARED)
+         == MAP_FAILED, "mmap2 at misaligned offset must fail");
+  CHECK (mmap2 (handle, ACTUAL + 0x20000, PAGE, 0, MAP_SHARED | MAP_PRIVATE)
+         == MAP_FAILED, "mmap2 both shared and private must fail");
+
+  memset (ACTUAL, 'B', PAGE);
+  CHECK (msync (ACTUAL, PAGE) == 0, "msync second page");
+  CHECK (pread (handle, buf, PAGE, PAGE) == PAGE, "read second page of file");
+  check_fill (buf, 'B', PAGE, "second page of file");
+
+  CHECK (msync (ACTUAL + 0x20000, PAGE) == -1,
+         "msync of unmapped memory must fail");
+  close (handle);
+}
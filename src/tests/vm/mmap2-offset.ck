@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap2-offset) begin
+(mmap2-offset) create "data"
+(mmap2-offset) open "data"
+(mmap2-offset) mmap2 second page
+(mmap2-offset) second page is correct
+(mmap2-offset) mmap2 third page and beyond
+(mmap2-offset) third page is correct
+(mmap2-offset) page past end of file is correct
+(mmap2-offset) mmap2 at misaligned offset must fail
+(mmap2-offset) mmap2 both shared and private must fail
+(mmap2-offset) msync second page
+(mmap2-offset) read second page of file
+(mmap2-offset) second page of file is correct
+(mmap2-offset) msync of unmapped memory must fail
+(mmap2-offset) end
+EOF
+pass;
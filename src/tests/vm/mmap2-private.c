@@ -0,0 +1,35 @@
+/* Maps a file privately, modifies the mapping, and verifies that
+   the changes are visible through the mapping but never reach the
+   file. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((void *) 0x10000000)
+
+void
+test_main (void)
+{
+  char buf[1024];
+  int handle;
+  mapid_t map;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((map = mmap2 (handle, ACTUAL, 0, 0, MAP_PRIVATE)) != MAP_FAILED,
+         "mmap2 \"sample.txt\" private");
+  CHECK (!memcmp (ACTUAL, sample, strlen (sample)),
+         "compare mapped data against file data");
+
+  memset (ACTUAL, 'x', 100);
+  CHECK (!memcmp (ACTUAL, "xxxx", 4) && !memcmp ((char *) ACTUAL + 100,
+                                                 sample + 100, 100),
+         "mapping sees its own changes");
+  munmap (map);
+
+  read (handle, buf, strlen (sample));
+  CHECK (!memcmp (buf, sample, strlen (sample)), "file is unchanged");
+  close (handle);
+}
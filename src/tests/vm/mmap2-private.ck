@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap2-private) begin
+(mmap2-private) open "sample.txt"
+(mmap2-private) mmap2 "sample.txt" private
+(mmap2-private) compare mapped data against file data
+(mmap2-private) mapping sees its own changes
+(mmap2-private) file is unchanged
+(mmap2-private) end
+EOF
+pass;
@@ -0,0 +1,41 @@
+/* Unmaps the middle page of a three-page mapping, checks that the
+   pages on either side still work and are written back when the
+   rest of the mapping goes, and then verifies that the middle page
+   is inaccessible. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+#define ACTUAL ((char *) 0x10000000)
+
+static char buf[3 * PAGE];
+
+void
+test_main (void)
+{
+  int handle;
+  mapid_t map;
+
+  CHECK (create ("data", 3 * PAGE), "create \"data\"");
+  CHECK ((handle = open ("data")) > 1, "open \"data\"");
+  CHECK ((map = mmap (handle, ACTUAL)) != MAP_FAILED, "mmap \"data\"");
+  CHECK (munmap_range (ACTUAL + PAGE, PAGE) == 0, "unmap middle page");
+
+  memset (ACTUAL, 'x', PAGE);
+  memset (ACTUAL + 2 * PAGE, 'z', PAGE);
+  munmap (map);
+  msg ("unmap the rest");
+
+  CHECK (read (handle, buf, 3 * PAGE) == 3 * PAGE, "read \"data\"");
+  CHECK (buf[0] == 'x' && buf[PAGE - 1] == 'x'
+         && buf[PAGE] == 0 && buf[2 * PAGE - 1] == 0
+         && buf[2 * PAGE] == 'z' && buf[3 * PAGE - 1] == 'z',
+         "outer pages were written back");
+
+  CHECK ((map = mmap (handle, ACTUAL)) != MAP_FAILED, "mmap \"data\" again");
+  CHECK (munmap_range (ACTUAL + PAGE, PAGE) == 0, "unmap middle page");
+  fail ("unmapped memory is readable (%d)", *(int *) (ACTUAL + PAGE));
+}
@@ -0,0 +1,21 @@
+/* Runs the page-merge-par workload, which pages heavily to the
+   swap disk, while a child process rewrites and re-reads a file
+   on the file system disk.  The two disks sit on different IDE
+   channels, so their I/O should overlap.  The per-device
+   throughput that the kernel prints at shutdown is the
+   benchmark's result. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/parallel-merge.h"
+
+void
+test_main (void) 
+{
+  pid_t child;
+
+  CHECK ((child = exec ("child-file-io")) != -1, "exec \"child-file-io\"");
+  parallel_merge ("child-sort", 123);
+  CHECK (wait (child) == 0, "wait for child-file-io");
+}
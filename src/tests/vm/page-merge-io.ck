@@ -0,0 +1,31 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-merge-io) begin
+(page-merge-io) exec "child-file-io"
+(page-merge-io) init
+(page-merge-io) sort chunk 0
+(page-merge-io) sort chunk 1
+(page-merge-io) sort chunk 2
+(page-merge-io) sort chunk 3
+(page-merge-io) sort chunk 4
+(page-merge-io) sort chunk 5
+(page-merge-io) sort chunk 6
+(page-merge-io) sort chunk 7
+(page-merge-io) wait for child 0
+(page-merge-io) wait for child 1
+(page-merge-io) wait for child 2
+(page-merge-io) wait for child 3
+(page-merge-io) wait for child 4
+(page-merge-io) wait for child 5
+(page-merge-io) wait for child 6
+(page-merge-io) wait for child 7
+(page-merge-io) merge
+(page-merge-io) verify
+(page-merge-io) success, buf_idx=1,048,576
+(page-merge-io) wait for child-file-io
+(page-merge-io) end
+EOF
+pass;
@@ -0,0 +1,45 @@
+/* Grows the heap with sbrk, checks that the new memory is zeroed
+   and usable, then shrinks it and grows it again.  Finally checks
+   that the heap cannot shrink below its start or grow over a
+   mapping. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define HEAP_SIZE (64 * 1024)
+
+void
+test_main (void)
+{
+  char *start, *heap;
+  size_t i;
+
+  CHECK ((start = sbrk (0)) != (void *) -1, "sbrk(0)");
+  CHECK ((heap = sbrk (HEAP_SIZE)) == start, "grow heap by %d bytes",
+         HEAP_SIZE);
+  CHECK (sbrk (0) == start + HEAP_SIZE, "break moved up");
+
+  for (i = 0; i < HEAP_SIZE; i++)
+    if (heap[i] != 0)
+      fail ("byte %zu of new heap is %02hhx instead of 0", i, heap[i]);
+  msg ("new heap is zeroed");
+
+  memset (heap, 'x', HEAP_SIZE);
+  CHECK (heap[0] == 'x' && heap[HEAP_SIZE - 1] == 'x', "heap is writable");
+
+  CHECK (sbrk (-HEAP_SIZE / 2) == start + HEAP_SIZE, "shrink heap by half");
+  CHECK (heap[HEAP_SIZE / 2 - 1] == 'x', "lower half is intact");
+  CHECK (sbrk (HEAP_SIZE / 2) == start + HEAP_SIZE / 2, "grow heap again");
+  CHECK (heap[HEAP_SIZE / 2] == 0, "regrown memory is zeroed");
+
+  CHECK (sbrk (-2 * HEAP_SIZE) == (void *) -1,
+         "shrinking below the start must fail");
+  CHECK (mmap2 (-1, heap + 2 * HEAP_SIZE, 4096, 0,
+                MAP_PRIVATE | MAP_ANONYMOUS) != MAP_FAILED,
+         "mmap2 above the heap");
+  CHECK (sbrk (2 * HEAP_SIZE) == (void *) -1,
+         "growing into the mapping must fail");
+  CHECK (sbrk (0) == start + HEAP_SIZE, "break did not move");
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(sbrk-grow) begin
+(sbrk-grow) sbrk(0)
+(sbrk-grow) grow heap by 65536 bytes
+(sbrk-grow) break moved up
+(sbrk-grow) new heap is zeroed
+(sbrk-grow) heap is writable
+(sbrk-grow) shrink heap by half
+(sbrk-grow) lower half is intact
+(sbrk-grow) grow heap again
+(sbrk-grow) regrown memory is zeroed
+(sbrk-grow) shrinking below the start must fail
+(sbrk-grow) mmap2 above the heap
+(sbrk-grow) growing into the mapping must fail
+(sbrk-grow) break did not move
+(sbrk-grow) end
+EOF
+pass;
@@ -1,5 +1,6 @@
 #include "threads/init.h"
 #include <console.h>
+#include <ctype.h>
 #include <debug.h>
 #include <inttypes.h>
 #include <limits.h>
@@ -34,6 +35,8 @@
 #ifdef FILESYS
 #include "devices/block.h"
 #include "devices/ide.h"
+#include "devices/ramdisk.h"
+#include "devices/virtio-blk.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
@@ -56,6 +59,13 @@ static const char *scratch_bdev_name;
 #ifdef VM
 static const char *swap_bdev_name;
 #endif
+
+/* -ramscratch, -ramswap: Sizes in bytes of RAM disks to create
+   for these roles, or 0 to create none. */
+static size_t ramscratch_size;
+#ifdef VM
+static size_t ramswap_size;
+#endif
 #endif /* FILESYS */
 
 /* -ul: Maximum number of pages to put into palloc's user pool. */
@@ -72,6 +82,9 @@ static void usage (void);
 #ifdef FILESYS
 static void locate_block_devices (void);
 static void locate_block_device (enum block_type, const char *name);
+static const char *create_ramdisk (const char *name, enum block_type,
+                                   size_t size, const char *bdev_name);
+static size_t parse_size (const char *);
 #endif
 
 int main (void) NO_RETURN;
@@ -101,6 +114,7 @@ main (void)
   /* Initialize memory system. */
   palloc_init (user_page_limit);
   malloc_init ();
+  console_init_buffers ();
   paging_init ();
 
   /* Segmentation. */
@@ -127,6 +141,7 @@ main (void)
 #ifdef FILESYS
   /* Initialize file system. */
   ide_init ();
+  virtio_blk_init ();
   locate_block_devices ();
   filesys_init (format_filesys);
 #endif
@@ -249,6 +264,8 @@ parse_options (char **argv)
         shutdown_configure (SHUTDOWN_POWER_OFF);
       else if (!strcmp (name, "-r"))
         shutdown_configure (SHUTDOWN_REBOOT);
+      else if (!strcmp (name, "-notickless"))
+        timer_tickless = false;
 #ifdef FILESYS
       else if (!strcmp (name, "-f"))
         format_filesys = true;
@@ -256,9 +273,15 @@ parse_options (char **argv)
         filesys_bdev_name = value;
       else if (!strcmp (name, "-scratch"))
         scratch_bdev_name = value;
+      else if (!strcmp (name, "-nodma"))
+        ide_use_dma = false;
+      else if (!strcmp (name, "-ramscratch"))
+        ramscratch_size = parse_size (value);
 #ifdef VM
       else if (!strcmp (name, "-swap"))
         swap_bdev_name = value;
+      else if (!strcmp (name, "-ramswap"))
+        ramswap_size = parse_size (value);
 #endif
 #endif
       else if (!strcmp (name, "-rs"))
@@ -268,6 +291,13 @@ parse_options (char **argv)
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
+      else if (!strcmp (name, "-fdlimit")) 
+        {
+          fd_limit = atoi (value);
+          if (fd_limit < FD_LIMIT_MIN)
+            PANIC ("bad file descriptor limit \"%s\" (at least %d)",
+                   value, FD_LIMIT_MIN);
+        }
 #endif
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
@@ -301,6 +331,16 @@ run_task (char **argv)
   printf ("Execution of '%s' complete.\n", task);
 }
 
+#ifdef FILESYS
+/* Prints block device statistics, as at shutdown, so that a
+   benchmark can see them at a point of its choosing. */
+static void
+iostat (char **argv UNUSED)
+{
+  block_print_stats ();
+}
+#endif
+
 /* Executes all of the actions specified in ARGV[]
    up to the null pointer sentinel. */
 static void
@@ -324,6 +364,7 @@ run_actions (char **argv)
       {"rm", 2, fsutil_rm},
       {"extract", 1, fsutil_extract},
       {"append", 2, fsutil_append},
+      {"iostat", 1, iostat},
 #endif
       {NULL, 0, NULL},
     };
@@ -370,6 +411,7 @@ usage (void)
           "  ls                 List files in the root directory.\n"
           "  cat FILE           Print FILE to the console.\n"
           "  rm FILE            Delete FILE.\n"
+          "  iostat             Print block device statistics.\n"
           "Use these actions indirectly via `pintos' -g and -p options:\n"
           "  extract            Untar from scratch device into file system.\n"
           "  append FILE        Append FILE to tar file on scratch device.\n"
@@ -378,18 +420,24 @@ usage (void)
           "  -h                 Print this help message and power off.\n"
           "  -q                 Power off VM after actions or on panic.\n"
           "  -r                 Reboot after actions.\n"
+          "  -notickless        Keep the timer ticking while idle.\n"
 #ifdef FILESYS
           "  -f                 Format file system device during startup.\n"
           "  -filesys=BDEV      Use BDEV for file system instead of default.\n"
           "  -scratch=BDEV      Use BDEV for scratch instead of default.\n"
+          "  -nodma             Use PIO instead of DMA for IDE disks.\n"
+          "  -ramscratch=SIZE   Use a SIZE-byte RAM disk (K/M suffix ok)\n"
+          "                     for scratch.\n"
 #ifdef VM
           "  -swap=BDEV         Use BDEV for swap instead of default.\n"
+          "  -ramswap=SIZE      Use a SIZE-byte RAM disk for swap.\n"
 #endif
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+          "  -fdlimit=COUNT     Allow each process COUNT file descriptors.\n"
 #endif
           );
   shutdown_power_off ();
@@ -400,6 +448,13 @@ usage (void)
 static void
 locate_block_devices (void)
 {
+  scratch_bdev_name = create_ramdisk ("ramscratch", BLOCK_SCRATCH,
+                                      ramscratch_size, scratch_bdev_name);
+#ifdef VM
+  swap_bdev_name = create_ramdisk ("ramswap", BLOCK_SWAP,
+                                   ramswap_size, swap_bdev_name);
+#endif
+
   locate_block_device (BLOCK_FILESYS, filesys_bdev_name);
   locate_block_device (BLOCK_SCRATCH, scratch_bdev_name);
 #ifdef VM
@@ -407,6 +462,51 @@ locate_block_devices (void)
 #endif
 }
 
+/* If SIZE is nonzero, creates a SIZE-byte RAM disk named NAME for
+   the given ROLE and returns NAME, so that the RAM disk takes the
+   role.  Otherwise, returns BDEV_NAME unchanged. */
+static const char *
+create_ramdisk (const char *name, enum block_type role, size_t size,
+                const char *bdev_name)
+{
+  if (size == 0)
+    return bdev_name;
+  if (bdev_name != NULL)
+    PANIC ("cannot use both a RAM disk and \"%s\" for %s",
+           bdev_name, block_type_name (role));
+  if (ramdisk_create (name, role, size) == NULL)
+    PANIC ("%s: not enough memory for %zu-byte RAM disk", name, size);
+  return name;
+}
+
+/* Parses SIZE as a number of bytes, optionally followed by K or M
+   for kilobytes or megabytes. */
+static size_t
+parse_size (const char *size)
+{
+  const char *end;
+  size_t unit = 1;
+  size_t n = 0;
+
+  if (size == NULL)
+    PANIC ("missing size");
+  for (end = size; isdigit (*end); end++)
+    {
+      if (n > (SIZE_MAX - (*end - '0')) / 10)
+        PANIC ("size \"%s\" too large", size);
+      n = n * 10 + (*end - '0');
+    }
+  if (*end == 'K' || *end == 'k')
+    unit = 1024, end++;
+  else if (*end == 'M' || *end == 'm')
+    unit = 1024 * 1024, end++;
+  if (*end != '\0' || n == 0)
+    PANIC ("bad size \"%s\"", size);
+  if (n > SIZE_MAX / unit)
+    PANIC ("size \"%s\" too large", size);
+  return n * unit;
+}
+
 /* Figures out what block device to use for the given ROLE: the
    block device with the given NAME, if NAME is non-null,
    otherwise the first block device in probe order of type
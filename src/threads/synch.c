@@ -341,3 +341,101 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   while (!list_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
+
+/* Initializes readers-writer lock RW. */
+void
+rwlock_init (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_init (&rw->lock);
+  cond_init (&rw->can_read);
+  cond_init (&rw->can_write);
+  rw->readers = 0;
+  rw->waiting_writers = 0;
+  rw->writer = NULL;
+  rw->writer_depth = 0;
+}
+
+/* Acquires RW for reading, sleeping while another thread holds
+   it for writing.  Readers do not wait for queued writers, so a
+   thread that already holds RW for reading may safely acquire
+   it again. */
+void
+rwlock_acquire_read (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->lock);
+  if (rw->writer == thread_current ())
+    rw->writer_depth++;
+  else
+    {
+      while (rw->writer != NULL)
+        cond_wait (&rw->can_read, &rw->lock);
+      rw->readers++;
+    }
+  lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread holds for reading. */
+void
+rwlock_release_read (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->lock);
+  if (rw->writer == thread_current ())
+    {
+      ASSERT (rw->writer_depth > 0);
+      rw->writer_depth--;
+    }
+  else
+    {
+      ASSERT (rw->readers > 0);
+      if (--rw->readers == 0 && rw->waiting_writers > 0)
+        cond_signal (&rw->can_write, &rw->lock);
+    }
+  lock_release (&rw->lock);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it. */
+void
+rwlock_acquire_write (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->lock);
+  if (rw->writer == thread_current ())
+    rw->writer_depth++;
+  else
+    {
+      rw->waiting_writers++;
+      while (rw->writer != NULL || rw->readers > 0)
+        cond_wait (&rw->can_write, &rw->lock);
+      rw->waiting_writers--;
+      rw->writer = thread_current ();
+    }
+  lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread holds for writing. */
+void
+rwlock_release_write (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->lock);
+  ASSERT (rw->writer == thread_current ());
+  if (rw->writer_depth > 0)
+    rw->writer_depth--;
+  else
+    {
+      rw->writer = NULL;
+      if (rw->waiting_writers > 0)
+        cond_signal (&rw->can_write, &rw->lock);
+      cond_broadcast (&rw->can_read, &rw->lock);
+    }
+  lock_release (&rw->lock);
+}
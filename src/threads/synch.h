@@ -43,6 +43,27 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Readers-writer lock.
+   Any number of readers may hold the lock at once, or a single
+   writer.  The writer may re-acquire the lock, for reading or
+   writing, while it already holds it. */
+struct rwlock
+  {
+    struct lock lock;           /* Protects the members below. */
+    struct condition can_read;  /* Signaled when the writer leaves. */
+    struct condition can_write; /* Signaled when the lock goes idle. */
+    int readers;                /* Number of readers holding the lock. */
+    int waiting_writers;        /* Number of writers waiting. */
+    struct thread *writer;      /* Writer holding the lock, if any. */
+    int writer_depth;           /* Nested acquisitions by WRITER. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
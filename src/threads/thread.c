@@ -1,9 +1,11 @@
 #include "threads/thread.h"
+#include <console.h>
 #include <debug.h>
 #include <stddef.h>
 #include <random.h>
 #include <stdio.h>
 #include <string.h>
+#include "devices/timer.h"
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
@@ -13,6 +15,7 @@
 #include "threads/vaddr.h"
 #ifdef USERPROG
 #include "userprog/process.h"
+#include "filesys/directory.h"
 #endif
 #include "vm/page.h"
 #include "threads/malloc.h"
@@ -141,6 +144,14 @@ thread_tick (void)
     intr_yield_on_return ();
 }
 
+/* Accounts for TICKS timer ticks that passed, without timer
+   interrupts, while the idle thread waited in tickless mode. */
+void
+thread_tick_idle (int64_t ticks) 
+{
+  idle_ticks += ticks;
+}
+
 /* Prints thread statistics. */
 void
 thread_print_stats (void)
@@ -206,6 +217,9 @@ thread_create (const char *name, int priority,
   if (cur != NULL)
   {
     list_push_back (&cur->child_list, &t->child_elem);
+    // project 4
+    if (cur->cwd != NULL)
+      t->cwd = dir_reopen (cur->cwd);
   }
 #endif
   // project 3
@@ -299,6 +313,9 @@ thread_exit (void)
   process_exit ();
 #endif
 
+  /* Write out any partial line of console output. */
+  console_exit ();
+
   /* Remove thread from all threads list, set our status to dying,
      and schedule another process.  That process will destroy us
      when it calls thread_schedule_tail(). */
@@ -411,19 +428,9 @@ idle (void *idle_started_ UNUSED)
       intr_disable ();
       thread_block ();
 
-      /* Re-enable interrupts and wait for the next one.
-
-         The `sti' instruction disables interrupts until the
-         completion of the next instruction, so these two
-         instructions are executed atomically.  This atomicity is
-         important; otherwise, an interrupt could be handled
-         between re-enabling interrupts and waiting for the next
-         one to occur, wasting as much as one clock tick worth of
-         time.
-
-         See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
-         7.11.1 "HLT Instruction". */
-      asm volatile ("sti; hlt" : : : "memory");
+      /* Wait for an interrupt, skipping timer ticks if
+         nothing is due. */
+      timer_idle ();
     }
 }
 
@@ -478,11 +485,9 @@ init_thread (struct thread *t, const char *name, int priority)
   t->magic = THREAD_MAGIC;
 
   // Project 2
-  t->min_fd = 2;
-  for (int i = 0; i < FILE_MAX; i++)
-  {
-    t->file_array[i] = NULL;
-  }
+#ifdef USERPROG
+  fd_table_init (&t->fds);
+#endif
   t->exit_status = -1;
   t->is_loaded = false;
   list_init (&t->child_list);
@@ -494,6 +499,9 @@ init_thread (struct thread *t, const char *name, int priority)
   list_init(&t->lock_list);
   list_init(&t->mmf_list);
   t->mmf_id = 0;
+  t->heap_start = t->brk = NULL;
+
+  t->cwd = NULL;
 
   old_level = intr_disable ();
   list_push_back (&all_list, &t->allelem);
@@ -8,8 +8,11 @@
 #include "threads/synch.h"
 
 #include "filesys/file.h"
+#include "userprog/fdtable.h"
 #include "vm/page.h"
 
+struct intr_frame;
+
 /* States in a thread's life cycle. */
 enum thread_status
   {
@@ -28,7 +31,6 @@ typedef int tid_t;
 #define PRI_MIN 0                       /* Lowest priority. */
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
-#define FILE_MAX 128                    /* Maximum number of files a process can open */
 
 /* A kernel thread or user process.
 
@@ -101,12 +103,13 @@ struct thread
 
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
+    void *user_esp;                     /* User stack pointer at syscall entry. */
+    struct intr_frame *user_if;         /* User registers at syscall entry. */
 
     // Project 2
     int exit_status;                    /* Exit status of the thread */
     bool is_loaded;                     /* Whether the thread is loaded */
-    struct file *file_array[FILE_MAX];
-    uint8_t min_fd;
+    struct fd_table fds;                /* Open files */
 
     struct list child_list;             /* List of child processes */
     struct list_elem child_elem;        /* List element for child processes list */
@@ -123,8 +126,21 @@ struct thread
     struct list mmf_list;
     int mmf_id;
 
+    void *heap_start;                   /* Start of the heap, just past the data. */
+    void *brk;                          /* End of the heap (the program break). */
+
     struct list lock_list;
 
+    // project 4
+    struct dir *cwd;                    /* Working directory, or NULL for the root */
+
+    /* Owned by devices/timer.c. */
+    int64_t wakeup;                     /* Tick to wake up at in timer_sleep(). */
+
+    /* Owned by lib/kernel/console.c. */
+    struct console_line *console_line;  /* Output not yet written, or null. */
+    bool console_busy;                  /* Writing out or allocating it? */
+
     /* Owned by thread.c. */
     unsigned magic;                     /* Detects stack overflow. */
   };
@@ -138,6 +154,7 @@ void thread_init (void);
 void thread_start (void);
 
 void thread_tick (void);
+void thread_tick_idle (int64_t ticks);
 void thread_print_stats (void);
 
 typedef void thread_func (void *aux);
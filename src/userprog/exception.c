@@ -6,6 +6,7 @@
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "userprog/syscall.h"
+#include "userprog/uaccess.h"
 #include "vm/page.h"
 
 /* Number of page faults processed. */
@@ -154,18 +155,27 @@ page_fault (struct intr_frame *f)
   void *upage = pg_round_down(fault_addr);
   // printf("page fault: %p\n", fault_addr);
 
+  // a write to a page whose frame fork() shared with another process
+  if (!not_present && write && is_user_vaddr(fault_addr)
+      && page_copy_on_write(&thread_current()->page_table, upage))
+  {
+    return;
+  }
+
   if (is_kernel_vaddr(fault_addr) || !not_present)
   {
     // printf("page fault on kernel address\n");
+    if (!user && uaccess_fixup(f))
+      return;
     syscall_exit(-1);
   }
 
   struct hash *page_table = &thread_current()->page_table;
   struct page *p = page_get(page_table, upage);
 
-  // stack growth
-  void *esp = f->esp;
-  if (esp - 32 <= fault_addr && PHYS_BASE - MAX_STACK_SIZE <= fault_addr)
+  // stack growth; f->esp is only the user's if we came from user mode
+  void *esp = user ? f->esp : thread_current()->user_esp;
+  if (page_is_stack_addr(fault_addr, esp))
   {
     // printf("page fault: stack growth\n");
     if (p == NULL)
@@ -174,13 +184,22 @@ page_fault (struct intr_frame *f)
     }
   }
 
+  p = page_get(page_table, upage);
+  bool from_file = p != NULL && p->status == PAGE_STATUS_FILE;
   if (page_load(page_table, upage))
   {
     // printf("page fault: page load success\n");
+    if (from_file)
+    {
+      page_readahead(page_table, p);
+    }
     return;
   }
 
   //  printf("page_fault: load_failed\n");
+  // a copy to or from user memory fails instead of killing us
+  if (!user && uaccess_fixup(f))
+    return;
   syscall_exit(-1);
 
     /* To implement virtual memory, delete the rest of the function
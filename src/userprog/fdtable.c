@@ -0,0 +1,189 @@
+#include "userprog/fdtable.h"
+#include <debug.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+
+/* Number of descriptors in a newly allocated table.  Must be a
+   multiple of 32, the bits in a bitmap word. */
+#define FD_INITIAL_SIZE 32
+
+/* Bits per bitmap word. */
+#define WORD_BITS 32
+
+/* Most descriptors a new process may have. */
+int fd_limit = FD_LIMIT_DEFAULT;
+
+static bool grow (struct fd_table *);
+
+/* Initializes T as an empty table.  Nothing is allocated until
+   the first fd_alloc(). */
+void
+fd_table_init (struct fd_table *t)
+{
+  t->files = NULL;
+  t->used = NULL;
+  t->size = 0;
+  t->limit = fd_limit;
+  t->hint = 0;
+}
+
+/* Closes every file in T and frees T's storage. */
+void
+fd_table_destroy (struct fd_table *t)
+{
+  int fd;
+
+  for (fd = 0; fd < t->size; fd++)
+    if (t->files[fd] != NULL)
+      file_close (t->files[fd]);
+  free (t->files);
+  free (t->used);
+  fd_table_init (t);
+}
+
+/* Makes T, which must be empty, a copy of SRC for fork(): each
+   file open in SRC is reopened in T under the same descriptor,
+   at the same position.  Returns false if memory is short, with
+   T holding the files reopened so far. */
+bool
+fd_table_copy (struct fd_table *t, struct fd_table *src)
+{
+  int fd;
+
+  ASSERT (t->size == 0);
+
+  t->limit = src->limit;
+  if (src->size == 0)
+    return true;
+
+  t->files = calloc (src->size, sizeof *t->files);
+  t->used = calloc (src->size / WORD_BITS, sizeof *t->used);
+  if (t->files == NULL || t->used == NULL)
+    {
+      free (t->files);
+      free (t->used);
+      t->files = NULL;
+      t->used = NULL;
+      return false;
+    }
+  t->size = src->size;
+  t->used[0] = 0x3;
+
+  for (fd = 0; fd < src->size; fd++)
+    if (src->files[fd] != NULL)
+      {
+        struct file *file = file_reopen (src->files[fd]);
+        if (file == NULL)
+          return false;
+        file_seek (file, file_tell (src->files[fd]));
+        t->files[fd] = file;
+        t->used[fd / WORD_BITS] |= 1u << (fd % WORD_BITS);
+      }
+  return true;
+}
+
+/* Sets T's limit to LIMIT descriptors.  Descriptors already open
+   at or above LIMIT stay open, but no new ones are handed out
+   there.  Returns false, leaving the limit alone, if LIMIT is
+   below FD_LIMIT_MIN or above the system-wide fd_limit. */
+bool
+fd_table_set_limit (struct fd_table *t, int limit)
+{
+  if (limit < FD_LIMIT_MIN || limit > fd_limit)
+    return false;
+  t->limit = limit;
+  return true;
+}
+
+/* Adds FILE to T under the lowest free descriptor and returns
+   it, or returns -1 if T is at its limit or memory is short. */
+int
+fd_alloc (struct fd_table *t, struct file *file)
+{
+  int words, w;
+
+  ASSERT (file != NULL);
+
+  /* Find a word with a zero bit, starting from the hint. */
+  words = t->size / WORD_BITS;
+  for (w = t->hint; w < words; w++)
+    if (t->used[w] != UINT32_MAX)
+      break;
+  if (w == words)
+    {
+      if (!grow (t))
+        return -1;
+    }
+  t->hint = w;
+
+  /* Take its lowest zero bit. */
+  {
+    int fd = w * WORD_BITS + __builtin_ctz (~t->used[w]);
+    if (fd >= t->limit)
+      return -1;
+    t->used[w] |= 1u << (fd % WORD_BITS);
+    t->files[fd] = file;
+    return fd;
+  }
+}
+
+/* Returns the file that FD refers to in T, or a null pointer if
+   FD is not open. */
+struct file *
+fd_lookup (struct fd_table *t, int fd)
+{
+  return fd >= 0 && fd < t->size ? t->files[fd] : NULL;
+}
+
+/* Removes FD from T and returns the file it referred to, which
+   the caller should close, or returns a null pointer if FD is
+   not open. */
+struct file *
+fd_remove (struct fd_table *t, int fd)
+{
+  struct file *file = fd_lookup (t, fd);
+
+  if (file != NULL)
+    {
+      t->files[fd] = NULL;
+      t->used[fd / WORD_BITS] &= ~(1u << (fd % WORD_BITS));
+      if (fd / WORD_BITS < t->hint)
+        t->hint = fd / WORD_BITS;
+    }
+  return file;
+}
+
+/* Doubles the size of T, or allocates it if it is empty.
+   Returns false if T is at its limit or memory is short. */
+static bool
+grow (struct fd_table *t)
+{
+  int new_size = t->size == 0 ? FD_INITIAL_SIZE : t->size * 2;
+  struct file **files;
+  uint32_t *used;
+
+  if (t->size >= t->limit)
+    return false;
+
+  files = realloc (t->files, new_size * sizeof *files);
+  if (files == NULL)
+    return false;
+  t->files = files;
+
+  used = realloc (t->used, new_size / WORD_BITS * sizeof *used);
+  if (used == NULL)
+    return false;
+  t->used = used;
+
+  memset (files + t->size, 0, (new_size - t->size) * sizeof *files);
+  memset (used + t->size / WORD_BITS, 0,
+          (new_size - t->size) / WORD_BITS * sizeof *used);
+
+  /* Descriptors 0 and 1 belong to the console. */
+  if (t->size == 0)
+    used[0] = 0x3;
+
+  t->size = new_size;
+  return true;
+}
@@ -0,0 +1,36 @@
+#ifndef USERPROG_FDTABLE_H
+#define USERPROG_FDTABLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct file;
+
+/* Default for the most file descriptors a process may have,
+   including 0 and 1 for the console.  Set with -fdlimit.  A
+   process may lower its own limit, or raise it back up to this
+   one, with fd_table_set_limit(). */
+#define FD_LIMIT_DEFAULT 128
+#define FD_LIMIT_MIN 2
+extern int fd_limit;
+
+/* A process's file descriptor table.  Starts out empty and grows
+   on demand, up to LIMIT descriptors. */
+struct fd_table
+  {
+    struct file **files;        /* File for each descriptor, or null. */
+    uint32_t *used;             /* Bitmap of descriptors in use. */
+    int size;                   /* Number of descriptors in FILES. */
+    int limit;                  /* Most descriptors allowed. */
+    int hint;                   /* No free descriptor in USED words before this. */
+  };
+
+void fd_table_init (struct fd_table *);
+void fd_table_destroy (struct fd_table *);
+bool fd_table_copy (struct fd_table *, struct fd_table *src);
+bool fd_table_set_limit (struct fd_table *, int limit);
+int fd_alloc (struct fd_table *, struct file *);
+struct file *fd_lookup (struct fd_table *, int fd);
+struct file *fd_remove (struct fd_table *, int fd);
+
+#endif /* userprog/fdtable.h */
@@ -19,10 +19,12 @@
 #include "threads/vaddr.h"
 
 #include "userprog/syscall.h"
-#include "vm/frame.h"
+#include "vm/mmf.h"
 #include "vm/page.h"
 
 static thread_func start_process NO_RETURN;
+static thread_func fork_process NO_RETURN;
+static bool copy_process (struct thread *parent);
 static bool load (const char *cmdline, void (**eip) (void), void **esp);
 
 struct thread*
@@ -87,6 +89,91 @@ process_execute (const char *file_name)
   return tid;
 }
 
+/* What process_fork() passes to the new process. */
+struct fork_args
+  {
+    struct thread *parent;      /* Process calling fork(). */
+    struct intr_frame if_;      /* Its registers at the call. */
+  };
+
+/* Starts a new process that is a copy of the current one, which
+   called fork() with the user registers in IF_: the copy resumes
+   from the same place, but sees fork() return 0.  Returns the new
+   process's thread id, or TID_ERROR if it cannot be created. */
+tid_t
+process_fork (struct intr_frame *if_)
+{
+  struct thread *cur = thread_current ();
+  struct fork_args args;
+  struct thread *child;
+  tid_t tid;
+
+  args.parent = cur;
+  args.if_ = *if_;
+  tid = thread_create (cur->name, PRI_DEFAULT, fork_process, &args);
+  if (tid == TID_ERROR)
+    return TID_ERROR;
+
+  /* ARGS must outlive the copy. */
+  child = get_child_proc_tid (tid);
+  sema_down (&child->sema_load);
+  if (!child->is_loaded)
+    {
+      process_wait (tid);
+      return TID_ERROR;
+    }
+  return tid;
+}
+
+/* A thread function that makes the current thread a copy of the
+   process that called process_fork() and starts it running. */
+static void
+fork_process (void *args_)
+{
+  struct fork_args *args = args_;
+  struct intr_frame if_ = args->if_;
+  bool success;
+
+  success = copy_process (args->parent);
+  thread_current ()->is_loaded = success;
+  sema_up (&thread_current ()->sema_load);
+  if (!success)
+    thread_exit ();
+
+  /* The parent gets the child's id from fork(), the child 0. */
+  if_.eax = 0;
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
+/* Gives the current thread a copy of PARENT's user process: its
+   memory, sharing frames until one side writes to them (see
+   page_table_copy()), its open files and mappings, each with its
+   own position, and its executable.  Returns false if memory is
+   short, leaving the rest to process_exit(). */
+static bool
+copy_process (struct thread *parent)
+{
+  struct thread *cur = thread_current ();
+
+  cur->pagedir = pagedir_create ();
+  if (cur->pagedir == NULL)
+    return false;
+  process_activate ();
+
+  cur->exec_file = file_reopen (parent->exec_file);
+  if (cur->exec_file == NULL)
+    return false;
+  file_deny_write (cur->exec_file);
+
+  cur->mmf_id = parent->mmf_id;
+  cur->heap_start = parent->heap_start;
+  cur->brk = parent->brk;
+  return (fd_table_copy (&cur->fds, &parent->fds)
+          && mmf_copy (parent)
+          && page_table_copy (&cur->page_table, parent));
+}
+
 /* Argument stack for argument passing */
 void
 argument_stack (int argc, char **argv, void **sp)
@@ -214,18 +301,9 @@ process_exit (void)
   struct thread *cur = thread_current ();
   uint32_t *pd;
 
-  for (int i = 2; i < FILE_MAX; i++)
-  {
-    if (cur->file_array[i] != NULL)
-    {
-      file_close(cur->file_array[i]);
-    }
-  }
+  fd_table_destroy(&cur->fds);
 
-  for (int i = 0; i < cur->mmf_id; i++)
-  {
-    syscall_munmap(i);
-  }
+  mmf_cleanup();
 
   struct list_elem *e;
   while (!list_empty(&cur->lock_list))
@@ -242,6 +320,9 @@ process_exit (void)
   file_close(cur->exec_file);
   cur->exec_file = NULL;
 
+  dir_close(cur->cwd);
+  cur->cwd = NULL;
+
   pd = cur->pagedir;
   sema_up(&cur->sema_wait);
   if (pd != NULL)
@@ -438,6 +519,10 @@ load (const char *file_name, void (**eip) (void), void **esp)
               if (!load_segment (file, file_page, (void *) mem_page,
                                  read_bytes, zero_bytes, writable))
                 goto done;
+
+              /* The heap starts after the highest segment. */
+              if ((void *) mem_page + read_bytes + zero_bytes > t->heap_start)
+                t->heap_start = (void *) mem_page + read_bytes + zero_bytes;
             }
           else
             goto done;
@@ -449,6 +534,9 @@ load (const char *file_name, void (**eip) (void), void **esp)
   if (!setup_stack (esp))
     goto done;
 
+  /* The heap starts out empty. */
+  t->brk = t->heap_start;
+
   /* Start address. */
   *eip = (void (*) (void)) ehdr.e_entry;
 
@@ -463,8 +551,6 @@ load (const char *file_name, void (**eip) (void), void **esp)
 
 /* load() helpers. */
 
-static bool install_page (void *upage, void *kpage, bool writable);
-
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
 static bool
@@ -541,9 +627,11 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
       size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
-      // Lazy Loading
-      page_file_init(&thread_current()->page_table, upage, file, ofs,
-                     page_read_bytes, page_zero_bytes, writable);
+      // Lazy Loading; pages already set up are freed with the page
+      // table when the failed process exits
+      if (page_file_init(&thread_current()->page_table, upage, file, ofs,
+                         page_read_bytes, page_zero_bytes, writable) == NULL)
+        return false;
 
       /* Advance. */
       read_bytes -= page_read_bytes;
@@ -559,40 +647,14 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 static bool
 setup_stack (void **esp)
 {
-  uint8_t *kpage;
+  struct hash *page_table = &thread_current ()->page_table;
   bool success = false;
 
-  kpage = frame_alloc (PAL_USER | PAL_ZERO, PHYS_BASE - PGSIZE);
-  if (kpage != NULL)
+  if (page_zero_init (page_table, PHYS_BASE - PGSIZE) != NULL)
     {
-      success = install_page (((uint8_t *) PHYS_BASE) - PGSIZE, kpage, true);
+      success = page_load (page_table, PHYS_BASE - PGSIZE);
       if (success)
-      {
         *esp = PHYS_BASE;
-        page_frame_init(&thread_current()->page_table, PHYS_BASE - PGSIZE, kpage);
-      }
-      else
-        frame_free (kpage);
     }
   return success;
 }
-
-/* Adds a mapping from user virtual address UPAGE to kernel
-   virtual address KPAGE to the page table.
-   If WRITABLE is true, the user process may modify the page;
-   otherwise, it is read-only.
-   UPAGE must not already be mapped.
-   KPAGE should probably be a page obtained from the user pool
-   with palloc_get_page().
-   Returns true on success, false if UPAGE is already mapped or
-   if memory allocation fails. */
-static bool
-install_page (void *upage, void *kpage, bool writable)
-{
-  struct thread *t = thread_current ();
-
-  /* Verify that there's not already a page at that virtual
-     address, then map our page there. */
-  return (pagedir_get_page (t->pagedir, upage) == NULL
-          && pagedir_set_page (t->pagedir, upage, kpage, writable));
-}
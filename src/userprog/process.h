@@ -4,6 +4,7 @@
 #include "threads/thread.h"
 
 tid_t process_execute (const char *file_name);
+tid_t process_fork (struct intr_frame *if_);
 int process_wait (tid_t);
 void process_exit (void);
 void process_activate (void);
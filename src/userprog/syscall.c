@@ -1,4 +1,5 @@
 #include "userprog/syscall.h"
+#include <console.h>
 #include <stdio.h>
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
@@ -20,38 +21,28 @@
 #include "vm/mmf.h"
 #include "threads/malloc.h"
 #include "threads/vaddr.h"
+#include "userprog/exception.h"
 #include "userprog/pagedir.h"
+#include "userprog/uaccess.h"
 
-static void syscall_handler (struct intr_frame *);
+// project 4
+#include "filesys/directory.h"
+#include "filesys/inode.h"
 
-struct lock file_lock;
+// Longest file name path and command line that system calls
+// accept, counting the null terminator.
+#define PATH_MAX 256
+#define CMD_LINE_MAX 512
 
-void
-get_stack_args (void *esp, void **arg, int count)
-{
-  int i;
-  for (i = 0; i < count; i++)
-  {
-    if (!is_user_vaddr(esp + sizeof(void *) * i))
-      syscall_exit(-1);
+// Most bytes that one read() from the console returns.
+#define STDIN_CHUNK 128
 
-    arg[i] = *(void **)(esp + sizeof(void *) * i);
-  }
-}
-
-bool validate_addr (void *addr)
-{
-  if (addr >= (void *) STACK_BOTTOM && addr < PHYS_BASE && addr != 0)
-    return true;
-
-  return false;
-}
+static void syscall_handler (struct intr_frame *);
 
 void
 syscall_init (void)
 {
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
-  lock_init(&file_lock);
 }
 
 void
@@ -87,31 +78,18 @@ syscall_wait (tid_t pid)
 bool
 syscall_create (const char *file, unsigned initial_size)
 {
-  if (!is_user_vaddr(file) || file == NULL)
-  {
-    syscall_exit(-1);
-  }
   return filesys_create(file, initial_size);
 }
 
 bool
 syscall_remove (const char *file)
 {
-  if (!is_user_vaddr(file) || file == NULL)
-  {
-    syscall_exit(-1);
-  }
   return filesys_remove(file);
 }
 
 int
 syscall_open (const char *file)
 {
-  if (!is_user_vaddr(file) || file == NULL)
-  {
-    syscall_exit(-1);
-  }
-
   struct file *f = filesys_open(file);
   if (f == NULL)
   {
@@ -119,28 +97,10 @@ syscall_open (const char *file)
   }
 
   struct thread *t = thread_current();
-  int fd = t->min_fd;
-  if (fd >= FILE_MAX || t->file_array[fd] != NULL)
-  {
-    return -1;
-  }
-
-  t->file_array[fd] = f;
-
-  bool is_min_fd = false;
-  for (int i = 2; i < FILE_MAX; i++)
+  int fd = fd_alloc(&t->fds, f);
+  if (fd < 0)
   {
-    if (t->file_array[i] == NULL)
-    {
-      t->min_fd = i;
-      is_min_fd = true;
-      break;
-    }
-  }
-
-  if (!is_min_fd)
-  {
-    t->min_fd = FILE_MAX;
+    file_close(f);
   }
   return fd;
 }
@@ -148,12 +108,8 @@ syscall_open (const char *file)
 int
 syscall_filesize (int fd)
 {
-  if (fd < 0 || fd >= FILE_MAX)
-  {
-    return -1;
-  }
   struct thread *t = thread_current();
-  struct file *f = t->file_array[fd];
+  struct file *f = fd_lookup(&t->fds, fd);
   if (f == NULL)
   {
     return -1;
@@ -169,18 +125,21 @@ syscall_read (int fd, void *buffer, unsigned size)
   {
     syscall_exit(-1);
   }
-  if (fd < 0 || fd >= FILE_MAX)
-  {
-    return -1;
-  }
   // STDIN
   if (fd == 0)
   {
-    for (unsigned i = 0; i < size; i++)
+    // show any prompt before waiting for input
+    console_flush();
+    // input_read() runs with interrupts off, so it must not fault;
+    // read into a kernel buffer and copy out afterward
+    char line[STDIN_CHUNK];
+    size_t bytes_read = input_read(line, size < STDIN_CHUNK ? size
+                                                            : STDIN_CHUNK);
+    if (!copy_to_user(buffer, line, bytes_read))
     {
-      ((char *)buffer)[i] = input_getc();
+      syscall_exit(-1);
     }
-    return size;
+    return bytes_read;
   }
 
   // STDOUT
@@ -190,17 +149,20 @@ syscall_read (int fd, void *buffer, unsigned size)
   }
 
   struct thread *t = thread_current();
-  struct file *f = t->file_array[fd];
-  if (f == NULL)
+  struct file *f = fd_lookup(&t->fds, fd);
+  if (f == NULL || inode_is_dir(file_get_inode(f)))
   {
     return -1;
   }
-  lock_acquire(&file_lock);
-  // pin memory to avoid page fault while holding lock
-  memset(buffer, 0, size);
-  int ret = file_read(f, buffer, size);
-  lock_release(&file_lock);
-  return ret;
+  // keep the buffer resident so that file_read() does not fault on
+  // it while holding the inode lock
+  if (!page_pin_range(&t->page_table, buffer, size, true))
+  {
+    syscall_exit(-1);
+  }
+  int bytes_read = file_read(f, buffer, size);
+  page_unpin_range(&t->page_table, buffer, size);
+  return bytes_read;
 }
 
 int
@@ -211,10 +173,6 @@ syscall_write (int fd, const void *buffer, unsigned size)
   {
     syscall_exit(-1);
   }
-  if (fd < 0 || fd >= FILE_MAX)
-  {
-    return -1;
-  }
   // STDIN
   if (fd == 0)
   {
@@ -228,26 +186,26 @@ syscall_write (int fd, const void *buffer, unsigned size)
   }
 
   struct thread *t = thread_current();
-  struct file *f = t->file_array[fd];
-  if (f == NULL)
+  struct file *f = fd_lookup(&t->fds, fd);
+  if (f == NULL || inode_is_dir(file_get_inode(f)))
   {
     return -1;
   }
-  lock_acquire(&file_lock);
-  int ret = file_write(f, buffer, size);
-  lock_release(&file_lock);
-  return ret;
+  // keep the buffer resident while file_write() reads it
+  if (!page_pin_range(&t->page_table, buffer, size, false))
+  {
+    syscall_exit(-1);
+  }
+  int bytes_written = file_write(f, buffer, size);
+  page_unpin_range(&t->page_table, buffer, size);
+  return bytes_written;
 }
 
 void
 syscall_seek (int fd, unsigned position)
 {
-  if (fd < 0 || fd >= FILE_MAX)
-  {
-    return;
-  }
   struct thread *t = thread_current();
-  struct file *f = t->file_array[fd];
+  struct file *f = fd_lookup(&t->fds, fd);
   if (f == NULL)
   {
     return;
@@ -258,12 +216,8 @@ syscall_seek (int fd, unsigned position)
 unsigned
 syscall_tell (int fd)
 {
-  if (fd < 0 || fd >= FILE_MAX)
-  {
-    return 0;
-  }
   struct thread *t = thread_current();
-  struct file *f = t->file_array[fd];
+  struct file *f = fd_lookup(&t->fds, fd);
   if (f == NULL)
   {
     return -1;
@@ -274,190 +228,749 @@ syscall_tell (int fd)
 void
 syscall_close (int fd)
 {
-  if (fd < 0 || fd >= FILE_MAX)
-  {
-    return;
-  }
   struct thread *t = thread_current();
-  struct file *f = t->file_array[fd];
+  struct file *f = fd_remove(&t->fds, fd);
   if (f == NULL)
   {
     return;
   }
 
-  lock_acquire(&file_lock);
   file_close(f);
-  lock_release(&file_lock);
-  t->file_array[fd] = NULL;
-  if (fd < t->min_fd)
-  {
-    t->min_fd = fd;
-  }
 }
 
 int
 syscall_mmap (int fd, void *vaddr)
+{
+  // the whole file, shared
+  return syscall_mmap2(fd, vaddr, 0, 0, MAP_SHARED);
+}
+
+// Whether the LENGTH bytes at ADDR are a nonempty, page-aligned
+// range of user memory
+static bool
+is_user_page_range (void *addr, size_t length)
+{
+  return (addr != NULL && pg_ofs(addr) == 0 && length > 0
+          && is_user_vaddr(addr) && length <= (size_t)(PHYS_BASE - addr));
+}
+
+int
+syscall_mmap2 (int fd, void *addr, size_t length, unsigned offset, int flags)
 {
   struct thread *t = thread_current();
-  struct file *f;
-  struct file *reopen_file;
-  struct mmf *mmf;
+  struct file *f = NULL;
+  int sharing = flags & (MAP_SHARED | MAP_PRIVATE);
 
-  if (fd < 2 || fd >= FILE_MAX)
+  if ((sharing != MAP_SHARED && sharing != MAP_PRIVATE)
+      || (flags & ~(MAP_SHARED | MAP_PRIVATE | MAP_POPULATE
+                    | MAP_ANONYMOUS)) != 0
+      || offset % PGSIZE != 0 || (off_t)offset < 0)
   {
     return -1;
   }
-
-  f = t->file_array[fd];
-  if (f == NULL || file_length(f) == 0 || vaddr == NULL || pg_ofs(vaddr) != 0)
+  if (flags & MAP_ANONYMOUS)
+  {
+    if (offset != 0)
+    {
+      return -1;
+    }
+  }
+  else
+  {
+    f = fd_lookup(&t->fds, fd);
+    if (f == NULL || inode_is_dir(file_get_inode(f)))
+    {
+      return -1;
+    }
+    // by default, from OFFSET to the end of the file
+    if (length == 0 && (off_t)offset < file_length(f))
+    {
+      length = file_length(f) - offset;
+    }
+  }
+  // leave room for the stack to grow
+  if (!is_user_page_range(addr, length)
+      || addr + length > PHYS_BASE - MAX_STACK_SIZE)
   {
     return -1;
   }
 
-  reopen_file = file_reopen(f);
-  if (reopen_file == NULL)
+  struct file *reopen_file = NULL;
+  if (f != NULL && (reopen_file = file_reopen(f)) == NULL)
   {
     return -1;
   }
-
-  mmf = mmf_init(t->mmf_id++, reopen_file, vaddr);
+  struct mmf *mmf = mmf_init(t->mmf_id, reopen_file, addr, offset, length,
+                             flags);
   if (mmf == NULL)
   {
+    file_close(reopen_file);
     return -1;
   }
+  t->mmf_id++;
   return mmf->id;
 }
 
 void
 syscall_munmap (int mmf_id)
 {
-  // printf("syscall_munmap: start\n");
-  struct thread *t = thread_current();
-  struct mmf *mmf = NULL;
-  void *upage = NULL;
-
-  if (mmf_id >= t->mmf_id)
+  struct mmf *mmf = mmf_get(mmf_id);
+  if (mmf != NULL)
   {
-    return;
+    mmf_unmap(mmf);
   }
+}
 
-  mmf = mmf_get (mmf_id);
-  // printf("syscall_munmap: check mmf, mmf->upage %p, mmf->file %p, mmf->id %d\n", mmf->upage, mmf->file, mmf->id);
-  if (mmf == NULL)
+void *
+syscall_sbrk (intptr_t increment)
+{
+  struct thread *t = thread_current();
+  void *old_brk = t->brk;
+  void *new_brk = old_brk + increment;
+  void *old_end = pg_round_up(old_brk);
+  void *new_end = pg_round_up(new_brk);
+  void *upage;
+
+  // the heap can't shrink below its start or grow into the stack
+  if (increment < 0 ? new_brk < t->heap_start || new_brk > old_brk
+      : new_brk < old_brk || new_brk > PHYS_BASE - MAX_STACK_SIZE)
   {
-    return;
+    return (void *)-1;
   }
 
-  upage = mmf->upage;
-  int size = file_length(mmf->file);
-  off_t ofs;
-
-  for (ofs = 0; ofs < size; ofs += PGSIZE)
+  // new heap pages are zero pages, faulted in when first touched
+  for (upage = old_end; upage < new_end; upage += PGSIZE)
   {
-    struct page *page = page_get (&t->page_table, upage);
-    if (page == NULL)
+    if (page_get(&t->page_table, upage) != NULL
+        || page_zero_init(&t->page_table, upage) == NULL)
     {
-      // printf("syscall_munmap: something wrong?? why no page found? upage %p\n", upage);
-      break;
+      // ran into a mapping, or out of memory; undo
+      while (upage > old_end)
+      {
+        upage -= PGSIZE;
+        page_unmap(&t->page_table, page_get(&t->page_table, upage));
+      }
+      return (void *)-1;
     }
-    // printf("syscall_munmap: upage %p\n", upage);
-    if (pagedir_is_dirty (t->pagedir, upage))
+  }
+  for (upage = new_end; upage < old_end; upage += PGSIZE)
+  {
+    struct page *p = page_get(&t->page_table, upage);
+    if (p != NULL)
     {
-      void *kpage = pagedir_get_page(t->pagedir, upage);
-      lock_acquire(&file_lock);
-      file_write_at(page->file, kpage, page->read_bytes, page->ofs);
-      lock_release(&file_lock);
+      page_unmap(&t->page_table, p);
     }
+  }
 
-    page_delete (&t->page_table, page);
+  t->brk = new_brk;
+  return old_brk;
+}
 
-    upage += PGSIZE;
+int
+syscall_madvise (void *addr, size_t length, int advice)
+{
+  struct thread *t = thread_current();
+  if (!is_user_page_range(addr, length)
+      || !page_advise(&t->page_table, addr, length, advice))
+  {
+    return -1;
   }
-  list_remove(&mmf->elem);
+  return 0;
 }
 
-static void
-syscall_handler (struct intr_frame *f)
+tid_t
+syscall_fork (void)
+{
+  return process_fork(thread_current()->user_if);
+}
+
+// Limits the calling process to LIMIT file descriptors from now on.
+// A child made by fork() inherits the limit; one made by exec()
+// starts with the -fdlimit default.
+bool
+syscall_setfdlimit (int limit)
+{
+  return fd_table_set_limit(&thread_current()->fds, limit);
+}
+
+int
+syscall_munmap_range (void *addr, size_t length)
+{
+  if (!is_user_page_range(addr, length))
+  {
+    return -1;
+  }
+  mmf_unmap_range(addr, length);
+  return 0;
+}
+
+int
+syscall_msync (void *addr, size_t length)
+{
+  if (!is_user_page_range(addr, length) || !mmf_sync_range(addr, length))
+  {
+    return -1;
+  }
+  return 0;
+}
+
+bool
+syscall_chdir (const char *dir)
 {
-  if (validate_addr(f->esp) == false)
+  return filesys_chdir(dir);
+}
+
+bool
+syscall_mkdir (const char *dir)
+{
+  return filesys_mkdir(dir);
+}
+
+bool
+syscall_readdir (int fd, char *name)
+{
+  struct thread *t = thread_current();
+  struct file *f = fd_lookup(&t->fds, fd);
+  if (f == NULL || !inode_is_dir(file_get_inode(f)))
+  {
+    return false;
+  }
+
+  // the directory position is the file position, so that it
+  // survives between calls
+  struct dir *dir = dir_open(inode_reopen(file_get_inode(f)));
+  if (dir == NULL)
+  {
+    return false;
+  }
+  char entry[NAME_MAX + 1];
+  dir_seek(dir, file_tell(f));
+  bool success = dir_readdir(dir, entry);
+  file_seek(f, dir_tell(dir));
+  dir_close(dir);
+
+  // copy out after the directory lock is released, in case it faults
+  if (success && !copy_to_user(name, entry, strlen(entry) + 1))
+  {
     syscall_exit(-1);
+  }
+  return success;
+}
 
-  // printf("system call! %d\n", *(int *)f->esp);
+bool
+syscall_isdir (int fd)
+{
+  struct thread *t = thread_current();
+  struct file *f = fd_lookup(&t->fds, fd);
+  if (f == NULL)
+  {
+    return false;
+  }
+  return inode_is_dir(file_get_inode(f));
+}
 
-  void *arg[3];
+int
+syscall_inumber (int fd)
+{
+  struct thread *t = thread_current();
+  struct file *f = fd_lookup(&t->fds, fd);
+  if (f == NULL)
+  {
+    return -1;
+  }
+  return inode_get_inumber(file_get_inode(f));
+}
 
-  switch (*(int *)f->esp)
+int
+syscall_pread (int fd, void *buffer, unsigned size, unsigned offset)
+{
+  struct thread *t = thread_current();
+  struct file *f = fd_lookup(&t->fds, fd);
+  if (f == NULL || inode_is_dir(file_get_inode(f)) || (off_t)offset < 0)
   {
-    case SYS_HALT:
-      syscall_halt();
-      break;
-    case SYS_EXIT:
-      get_stack_args(f->esp + 4, arg, 1);
-      syscall_exit((int)arg[0]);
-      break;
-    case SYS_EXEC:
-      get_stack_args(f->esp + 4, arg, 1);
-      int ret = syscall_exec((char *)arg[0]);
-      if (ret == TID_ERROR)
-      {
-        syscall_exit(-1);
-      }
-      if (ret == -2)
-      {
-        ret = -1;
-      }
-      f->eax = ret;
-      break;
-    case SYS_WAIT:
-      get_stack_args(f->esp + 4, arg, 1);
-      f->eax = syscall_wait((int)arg[0]);
-      break;
-    case SYS_CREATE:
-      get_stack_args(f->esp + 4, arg, 2);
-      f->eax = syscall_create((char *)arg[0], (unsigned)arg[1]);
-      break;
-    case SYS_REMOVE:
-      get_stack_args(f->esp + 4, arg, 1);
-      f->eax = syscall_remove((char *)arg[0]);
-      break;
-    case SYS_OPEN:
-      get_stack_args(f->esp + 4, arg, 1);
-      f->eax = syscall_open((char *)arg[0]);
-      break;
-    case SYS_FILESIZE:
-      get_stack_args(f->esp + 4, arg, 1);
-      f->eax = syscall_filesize((int)arg[0]);
-      break;
-    case SYS_READ:
-      get_stack_args(f->esp + 4, arg, 3);
-      f->eax = syscall_read((int)arg[0], (void *)arg[1], (unsigned)arg[2]);
-      break;
-    case SYS_WRITE:
-      get_stack_args(f->esp + 4, arg, 3);
-      f->eax = syscall_write((int)arg[0], (void *)arg[1], (unsigned)arg[2]);
-      break;
-    case SYS_SEEK:
-      get_stack_args(f->esp + 4, arg, 2);
-      syscall_seek((int)arg[0], (unsigned)arg[1]);
-      break;
-    case SYS_TELL:
-      get_stack_args(f->esp + 4, arg, 1);
-      f->eax = syscall_tell((int)arg[0]);
-      break;
-    case SYS_CLOSE:
-      get_stack_args(f->esp + 4, arg, 1);
-      syscall_close((int)arg[0]);
+    return -1;
+  }
+  // like syscall_read(), but file_read_at() leaves the position alone
+  if (!page_pin_range(&t->page_table, buffer, size, true))
+  {
+    syscall_exit(-1);
+  }
+  int bytes_read = file_read_at(f, buffer, size, offset);
+  page_unpin_range(&t->page_table, buffer, size);
+  return bytes_read;
+}
+
+int
+syscall_pwrite (int fd, const void *buffer, unsigned size, unsigned offset)
+{
+  struct thread *t = thread_current();
+  struct file *f = fd_lookup(&t->fds, fd);
+  if (f == NULL || inode_is_dir(file_get_inode(f)) || (off_t)offset < 0)
+  {
+    return -1;
+  }
+  if (!page_pin_range(&t->page_table, buffer, size, false))
+  {
+    syscall_exit(-1);
+  }
+  int bytes_written = file_write_at(f, buffer, size, offset);
+  page_unpin_range(&t->page_table, buffer, size);
+  return bytes_written;
+}
+
+int
+syscall_copy_file_range (int fd_in, unsigned off_in, int fd_out,
+                         unsigned off_out, unsigned size)
+{
+  struct thread *t = thread_current();
+  struct file *in = fd_lookup(&t->fds, fd_in);
+  struct file *out = fd_lookup(&t->fds, fd_out);
+  if (in == NULL || out == NULL
+      || inode_is_dir(file_get_inode(in)) || inode_is_dir(file_get_inode(out))
+      || (off_t)off_in < 0 || (off_t)off_out < 0 || (off_t)size < 0)
+  {
+    return -1;
+  }
+  // no user buffer, so nothing to pin: the data stays in the kernel
+  return file_copy_range(in, off_in, out, off_out, size);
+}
+
+// Copies in the IOVCNT-element iovec array at user address UIOV.
+// Returns a malloc()'d copy, or NULL if IOVCNT is out of range or
+// memory is short.  Kills the process if UIOV is not readable.
+static struct iovec *
+copy_in_iovec (const struct iovec *uiov, int iovcnt)
+{
+  if (iovcnt <= 0 || iovcnt > IOV_MAX)
+  {
+    return NULL;
+  }
+  struct iovec *iov = malloc(iovcnt * sizeof *iov);
+  if (iov == NULL)
+  {
+    return NULL;
+  }
+  if (!copy_from_user(iov, uiov, iovcnt * sizeof *iov))
+  {
+    free(iov);
+    syscall_exit(-1);
+  }
+  return iov;
+}
+
+int
+syscall_readv (int fd, const struct iovec *uiov, int iovcnt)
+{
+  struct iovec *iov = copy_in_iovec(uiov, iovcnt);
+  if (iov == NULL)
+  {
+    return -1;
+  }
+
+  // one buffer at a time, stopping at the first short read
+  int total = 0;
+  for (int i = 0; i < iovcnt; i++)
+  {
+    int n = syscall_read(fd, iov[i].iov_base, iov[i].iov_len);
+    if (n < 0)
+    {
+      total = i == 0 ? -1 : total;
       break;
-    case SYS_MMAP:
-      get_stack_args(f->esp + 4, arg, 2);
-      f->eax = syscall_mmap((int)arg[0], (void *)arg[1]);
+    }
+    total += n;
+    if ((size_t)n < iov[i].iov_len)
+    {
       break;
-    case SYS_MUNMAP:
-      get_stack_args(f->esp + 4, arg, 1);
-      syscall_munmap((int)arg[0]);
+    }
+  }
+  free(iov);
+  return total;
+}
+
+int
+syscall_writev (int fd, const struct iovec *uiov, int iovcnt)
+{
+  struct iovec *iov = copy_in_iovec(uiov, iovcnt);
+  if (iov == NULL)
+  {
+    return -1;
+  }
+
+  int total = 0;
+  for (int i = 0; i < iovcnt; i++)
+  {
+    int n = syscall_write(fd, iov[i].iov_base, iov[i].iov_len);
+    if (n < 0)
+    {
+      total = i == 0 ? -1 : total;
       break;
-    default:
-      syscall_exit(-1);
+    }
+    total += n;
+    if ((size_t)n < iov[i].iov_len)
+    {
       break;
+    }
   }
+  free(iov);
+  return total;
+}
+
+// Copies the user string USTR into a new block of SIZE bytes,
+// which the caller must free().  Kills the process if USTR is not
+// readable.  Returns NULL if USTR, with its null terminator, does
+// not fit in SIZE bytes, or if memory is short, which the caller
+// treats like any other invalid argument.
+static char *
+copy_in_string (const char *ustr, size_t size)
+{
+  char *kstr = malloc(size);
+  if (kstr == NULL)
+  {
+    return NULL;
+  }
+
+  int len = strncpy_from_user(kstr, ustr, size);
+  if (len < 0)
+  {
+    free(kstr);
+    syscall_exit(-1);
+  }
+  if ((size_t)len == size)
+  {
+    free(kstr);
+    return NULL;
+  }
+  return kstr;
+}
+
+// Adapters from the argument words on the user stack to the
+// syscall_*() functions.  Each returns the value for EAX.
+
+static uint32_t
+sys_halt (const uint32_t *arg UNUSED)
+{
+  syscall_halt();
+  NOT_REACHED();
+}
+
+static uint32_t
+sys_exit (const uint32_t *arg)
+{
+  syscall_exit((int)arg[0]);
+  NOT_REACHED();
+}
+
+static uint32_t
+sys_exec (const uint32_t *arg)
+{
+  char *cmd_line = copy_in_string((const char *)arg[0], CMD_LINE_MAX);
+  if (cmd_line == NULL)
+  {
+    return -1;
+  }
+  tid_t ret = syscall_exec(cmd_line);
+  free(cmd_line);
+  if (ret == TID_ERROR)
+  {
+    syscall_exit(-1);
+  }
+  if (ret == -2)
+  {
+    ret = -1;
+  }
+  return ret;
+}
+
+static uint32_t
+sys_wait (const uint32_t *arg)
+{
+  return syscall_wait((tid_t)arg[0]);
+}
+
+static uint32_t
+sys_create (const uint32_t *arg)
+{
+  char *file = copy_in_string((const char *)arg[0], PATH_MAX);
+  if (file == NULL)
+  {
+    return false;
+  }
+  bool success = syscall_create(file, (unsigned)arg[1]);
+  free(file);
+  return success;
+}
+
+static uint32_t
+sys_remove (const uint32_t *arg)
+{
+  char *file = copy_in_string((const char *)arg[0], PATH_MAX);
+  if (file == NULL)
+  {
+    return false;
+  }
+  bool success = syscall_remove(file);
+  free(file);
+  return success;
+}
+
+static uint32_t
+sys_open (const uint32_t *arg)
+{
+  char *file = copy_in_string((const char *)arg[0], PATH_MAX);
+  if (file == NULL)
+  {
+    return -1;
+  }
+  int fd = syscall_open(file);
+  free(file);
+  return fd;
+}
+
+static uint32_t
+sys_filesize (const uint32_t *arg)
+{
+  return syscall_filesize((int)arg[0]);
+}
+
+static uint32_t
+sys_read (const uint32_t *arg)
+{
+  return syscall_read((int)arg[0], (void *)arg[1], (unsigned)arg[2]);
+}
+
+static uint32_t
+sys_write (const uint32_t *arg)
+{
+  return syscall_write((int)arg[0], (const void *)arg[1], (unsigned)arg[2]);
+}
+
+static uint32_t
+sys_seek (const uint32_t *arg)
+{
+  syscall_seek((int)arg[0], (unsigned)arg[1]);
+  return 0;
+}
+
+static uint32_t
+sys_tell (const uint32_t *arg)
+{
+  return syscall_tell((int)arg[0]);
+}
+
+static uint32_t
+sys_close (const uint32_t *arg)
+{
+  syscall_close((int)arg[0]);
+  return 0;
+}
+
+static uint32_t
+sys_mmap (const uint32_t *arg)
+{
+  return syscall_mmap((int)arg[0], (void *)arg[1]);
+}
+
+static uint32_t
+sys_munmap (const uint32_t *arg)
+{
+  syscall_munmap((int)arg[0]);
+  return 0;
+}
+
+static uint32_t
+sys_chdir (const uint32_t *arg)
+{
+  char *dir = copy_in_string((const char *)arg[0], PATH_MAX);
+  if (dir == NULL)
+  {
+    return false;
+  }
+  bool success = syscall_chdir(dir);
+  free(dir);
+  return success;
+}
+
+static uint32_t
+sys_mkdir (const uint32_t *arg)
+{
+  char *dir = copy_in_string((const char *)arg[0], PATH_MAX);
+  if (dir == NULL)
+  {
+    return false;
+  }
+  bool success = syscall_mkdir(dir);
+  free(dir);
+  return success;
+}
+
+static uint32_t
+sys_readdir (const uint32_t *arg)
+{
+  return syscall_readdir((int)arg[0], (char *)arg[1]);
+}
+
+static uint32_t
+sys_isdir (const uint32_t *arg)
+{
+  return syscall_isdir((int)arg[0]);
+}
+
+static uint32_t
+sys_inumber (const uint32_t *arg)
+{
+  return syscall_inumber((int)arg[0]);
+}
+
+static uint32_t
+sys_pread (const uint32_t *arg)
+{
+  return syscall_pread((int)arg[0], (void *)arg[1], (unsigned)arg[2],
+                       (unsigned)arg[3]);
+}
+
+static uint32_t
+sys_pwrite (const uint32_t *arg)
+{
+  return syscall_pwrite((int)arg[0], (const void *)arg[1], (unsigned)arg[2],
+                        (unsigned)arg[3]);
+}
+
+static uint32_t
+sys_readv (const uint32_t *arg)
+{
+  return syscall_readv((int)arg[0], (const struct iovec *)arg[1], (int)arg[2]);
+}
+
+static uint32_t
+sys_writev (const uint32_t *arg)
+{
+  return syscall_writev((int)arg[0], (const struct iovec *)arg[1], (int)arg[2]);
+}
+
+static uint32_t
+sys_copy_file_range (const uint32_t *arg)
+{
+  return syscall_copy_file_range((int)arg[0], (unsigned)arg[1], (int)arg[2],
+                                 (unsigned)arg[3], (unsigned)arg[4]);
+}
+
+static uint32_t
+sys_mmap2 (const uint32_t *arg)
+{
+  return syscall_mmap2((int)arg[0], (void *)arg[1], (size_t)arg[2],
+                       (unsigned)arg[3], (int)arg[4]);
+}
+
+static uint32_t
+sys_sbrk (const uint32_t *arg)
+{
+  return (uint32_t)syscall_sbrk((intptr_t)arg[0]);
+}
+
+static uint32_t
+sys_madvise (const uint32_t *arg)
+{
+  return syscall_madvise((void *)arg[0], (size_t)arg[1], (int)arg[2]);
+}
+
+static uint32_t
+sys_fork (const uint32_t *arg UNUSED)
+{
+  return syscall_fork();
+}
+
+static uint32_t
+sys_setfdlimit (const uint32_t *arg)
+{
+  return syscall_setfdlimit((int)arg[0]);
+}
+
+static uint32_t
+sys_munmap_range (const uint32_t *arg)
+{
+  return syscall_munmap_range((void *)arg[0], (size_t)arg[1]);
+}
+
+static uint32_t
+sys_msync (const uint32_t *arg)
+{
+  return syscall_msync((void *)arg[0], (size_t)arg[1]);
+}
+
+// A system call: its handler and how many argument words it takes
+// from the user stack.
+struct syscall
+{
+  uint32_t (*func) (const uint32_t *arg);
+  int argc;
+};
+
+#define SYSCALL_MAX_ARGS 5
+
+static const struct syscall syscall_table[] =
+{
+  [SYS_HALT]     = { sys_halt,     0 },
+  [SYS_EXIT]     = { sys_exit,     1 },
+  [SYS_EXEC]     = { sys_exec,     1 },
+  [SYS_WAIT]     = { sys_wait,     1 },
+  [SYS_CREATE]   = { sys_create,   2 },
+  [SYS_REMOVE]   = { sys_remove,   1 },
+  [SYS_OPEN]     = { sys_open,     1 },
+  [SYS_FILESIZE] = { sys_filesize, 1 },
+  [SYS_READ]     = { sys_read,     3 },
+  [SYS_WRITE]    = { sys_write,    3 },
+  [SYS_SEEK]     = { sys_seek,     2 },
+  [SYS_TELL]     = { sys_tell,     1 },
+  [SYS_CLOSE]    = { sys_close,    1 },
+  [SYS_MMAP]     = { sys_mmap,     2 },
+  [SYS_MUNMAP]   = { sys_munmap,   1 },
+  [SYS_CHDIR]    = { sys_chdir,    1 },
+  [SYS_MKDIR]    = { sys_mkdir,    1 },
+  [SYS_READDIR]  = { sys_readdir,  2 },
+  [SYS_ISDIR]    = { sys_isdir,    1 },
+  [SYS_INUMBER]  = { sys_inumber,  1 },
+  [SYS_PREAD]    = { sys_pread,    4 },
+  [SYS_PWRITE]   = { sys_pwrite,   4 },
+  [SYS_READV]    = { sys_readv,    3 },
+  [SYS_WRITEV]   = { sys_writev,   3 },
+  [SYS_COPY_FILE_RANGE] = { sys_copy_file_range, 5 },
+  [SYS_MMAP2]    = { sys_mmap2,    5 },
+  [SYS_MUNMAP_RANGE] = { sys_munmap_range, 2 },
+  [SYS_MSYNC]    = { sys_msync,    2 },
+  [SYS_SBRK]     = { sys_sbrk,     1 },
+  [SYS_MADVISE]  = { sys_madvise,  3 },
+  [SYS_FORK]     = { sys_fork,     0 },
+  [SYS_SETFDLIMIT] = { sys_setfdlimit, 1 },
+};
+
+static void
+syscall_handler (struct intr_frame *f)
+{
+  uint32_t nr;
+  uint32_t arg[SYSCALL_MAX_ARGS];
+  const struct syscall *sc;
+
+  // for page faults in kernel mode on the user stack
+  thread_current()->user_esp = f->esp;
+  // for fork(), which copies the registers
+  thread_current()->user_if = f;
+
+  // one fault-checked copy each for the number and the arguments
+  if (!copy_from_user(&nr, f->esp, sizeof nr))
+  {
+    syscall_exit(-1);
+  }
+  if (nr >= sizeof syscall_table / sizeof *syscall_table
+      || syscall_table[nr].func == NULL)
+  {
+    syscall_exit(-1);
+  }
+  sc = &syscall_table[nr];
+  ASSERT (sc->argc <= SYSCALL_MAX_ARGS);
+  if (!copy_from_user(arg, (uint32_t *)f->esp + 1, sc->argc * sizeof *arg))
+  {
+    syscall_exit(-1);
+  }
+
+  f->eax = sc->func(arg);
 }
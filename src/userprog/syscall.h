@@ -4,10 +4,9 @@
 #define STACK_BOTTOM 0x8048000
 
 #include <stdbool.h>
+#include <uio.h>
 #include "threads/thread.h"
 
-void get_stack_args (void *esp, void **arg, int count);
-bool validate_addr (void *addr);
 void syscall_halt (void);
 void syscall_exit (int status);
 tid_t syscall_exec (const char *cmd_line);
@@ -24,6 +23,28 @@ void syscall_close (int fd);
 
 int syscall_mmap(int fd, void *addr);
 void syscall_munmap(int mmf_id);
+int syscall_mmap2 (int fd, void *addr, size_t length, unsigned offset,
+                   int flags);
+int syscall_munmap_range (void *addr, size_t length);
+int syscall_msync (void *addr, size_t length);
+void *syscall_sbrk (intptr_t increment);
+int syscall_madvise (void *addr, size_t length, int advice);
+tid_t syscall_fork (void);
+bool syscall_setfdlimit (int limit);
+
+bool syscall_chdir (const char *dir);
+bool syscall_mkdir (const char *dir);
+bool syscall_readdir (int fd, char *name);
+bool syscall_isdir (int fd);
+int syscall_inumber (int fd);
+
+int syscall_pread (int fd, void *buffer, unsigned size, unsigned offset);
+int syscall_pwrite (int fd, const void *buffer, unsigned size,
+                    unsigned offset);
+int syscall_readv (int fd, const struct iovec *iov, int iovcnt);
+int syscall_writev (int fd, const struct iovec *iov, int iovcnt);
+int syscall_copy_file_range (int fd_in, unsigned off_in, int fd_out,
+                             unsigned off_out, unsigned size);
 
 void syscall_init (void);
 
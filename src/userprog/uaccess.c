@@ -0,0 +1,85 @@
+#include "userprog/uaccess.h"
+#include <stdint.h>
+#include "threads/interrupt.h"
+#include "threads/vaddr.h"
+
+/* A user memory access in uaccess-copy.S and where to resume if it
+   faults. */
+struct fixup
+  {
+    void (*insn) (void);        /* Instruction that may fault. */
+    void (*resume) (void);      /* Where to continue instead. */
+  };
+
+/* Defined in uaccess-copy.S.  Terminated by a null pair. */
+extern const struct fixup uaccess_fixups[];
+size_t uaccess_copy (void *dst, const void *src, size_t n);
+int uaccess_strncpy (char *dst, const char *src, size_t size);
+
+/* Returns true if the N bytes starting at UADDR all lie in user
+   virtual memory. */
+static bool
+is_user_range (const void *uaddr, size_t n)
+{
+  uintptr_t start = (uintptr_t) uaddr;
+  return n <= (uintptr_t) PHYS_BASE && start <= (uintptr_t) PHYS_BASE - n;
+}
+
+/* Copies N bytes from user address USRC to kernel address DST.
+   Returns true if successful, false if any part of the source is
+   not valid, readable user memory. */
+bool
+copy_from_user (void *dst, const void *usrc, size_t n)
+{
+  return is_user_range (usrc, n) && uaccess_copy (dst, usrc, n) == 0;
+}
+
+/* Copies N bytes from kernel address SRC to user address UDST.
+   Returns true if successful, false if any part of the
+   destination is not valid, writable user memory.  Bytes up to
+   the first bad one may have been written anyway. */
+bool
+copy_to_user (void *udst, const void *src, size_t n)
+{
+  return is_user_range (udst, n) && uaccess_copy (udst, src, n) == 0;
+}
+
+/* Copies the null-terminated string at user address USRC into
+   DST, which has room for SIZE bytes.  Returns the length of the
+   string, or SIZE if it does not fit, in which case DST is not
+   null-terminated.  Returns -1 if the string runs into memory
+   that is not valid, readable user memory. */
+int
+strncpy_from_user (char *dst, const char *usrc, size_t size)
+{
+  size_t avail = (uintptr_t) usrc < (uintptr_t) PHYS_BASE
+                 ? (uintptr_t) PHYS_BASE - (uintptr_t) usrc : 0;
+  int len;
+
+  if (avail >= size)
+    return uaccess_strncpy (dst, usrc, size);
+
+  /* The string would cross into kernel memory.  That's fine if
+     it ends first. */
+  len = uaccess_strncpy (dst, usrc, avail);
+  return len >= 0 && (size_t) len < avail ? len : -1;
+}
+
+/* Called by the page fault handler for a fault in kernel mode
+   that it could not resolve.  If the fault happened while one of
+   the routines above accessed user memory, arranges for F to
+   resume at the routine's error path and returns true.
+   Otherwise, returns false. */
+bool
+uaccess_fixup (struct intr_frame *f)
+{
+  const struct fixup *p;
+
+  for (p = uaccess_fixups; p->insn != NULL; p++)
+    if (f->eip == p->insn)
+      {
+        f->eip = p->resume;
+        return true;
+      }
+  return false;
+}
@@ -1,18 +1,21 @@
 #include "vm/frame.h"
 #include <stdio.h>
+#include <string.h>
 #include "threads/malloc.h"
 #include "threads/synch.h"
+#include "threads/vaddr.h"
 #include "userprog/pagedir.h"
-#include "userprog/syscall.h"
 #include "vm/page.h"
 #include "vm/swap.h"
 
 static struct list frame_table;
 static struct lock frame_lock;
 static struct frame *last_frame;
-extern struct lock file_lock;
 
 void frame_evict(void);
+static struct frame *frame_next (struct frame *fe);
+static bool frame_test_accessed (struct frame *fe);
+static void frame_free_unused (struct frame *fe);
 
 // Frame table Initialization
 void
@@ -23,9 +26,12 @@ frame_init(void)
   last_frame = NULL;
 }
 
-// Allocate frame
+// Allocate a frame for page P, or for no page yet if P is NULL.  The
+// frame comes back pinned, so that it isn't evicted before the caller
+// has filled it in; unpin it with frame_unpin() (or let go of it with
+// frame_release()) after that.
 void *
-frame_alloc(enum palloc_flags flags, void *upage)
+frame_alloc(enum palloc_flags flags, struct page *p)
 {
   lock_acquire(&frame_lock);
   void *kpage = palloc_get_page(flags);
@@ -37,41 +43,47 @@ frame_alloc(enum palloc_flags flags, void *upage)
     if (kpage == NULL)
     {
       // printf("frame_alloc: eviction failed\n");
+      lock_release(&frame_lock);
       return NULL;
     }
   }
   struct frame *f = malloc(sizeof(struct frame));
+  if (f == NULL)
+  {
+    palloc_free_page(kpage);
+    lock_release(&frame_lock);
+    return NULL;
+  }
   f->kpage = kpage;
-  f->upage = upage;
-  f->thread = thread_current ();
+  list_init(&f->pages);
+  if (p != NULL)
+  {
+    list_push_back(&f->pages, &p->frame_elem);
+  }
+  f->pin_cnt = 1;
   list_push_back(&frame_table, &f->elem);
   lock_release(&frame_lock);
   return kpage;
 }
 
-// Free frame with kpage
+// Take P out of its frame, which the caller has pinned, and unmap it
+// from its process.  This drops the caller's pin; the frame is freed
+// once no page is left in it.
 void
-frame_free(void *kpage)
+frame_release(struct page *p)
 {
-  struct list_elem *e;
   struct frame *fe;
+
   lock_acquire(&frame_lock);
-  for (e = list_begin(&frame_table); e != list_end(&frame_table); e = list_next(e))
+  fe = frame_get(p->kpage);
+  if (fe != NULL)
   {
-    fe = list_entry(e, struct frame, elem);
-    if (fe->kpage == kpage)
-    {
-      list_remove(e);
-      palloc_free_page(kpage);
-      pagedir_clear_page(fe->thread->pagedir, fe->upage);
-      free(fe);
-      lock_release(&frame_lock);
-      return;
-    }
+    list_remove(&p->frame_elem);
+    pagedir_clear_page(p->thread->pagedir, p->upage);
+    fe->pin_cnt--;
+    frame_free_unused(fe);
   }
   lock_release(&frame_lock);
-  // if there is no frame to free then it is an error
-  syscall_exit(-1);
 }
 
 // Get frame
@@ -91,6 +103,144 @@ frame_get (void *kpage)
   return NULL;
 }
 
+// Pin the frame that holds page P, so that it is not evicted until
+// frame_unpin().  Returns false if P is not in a frame (any more).
+bool
+frame_pin (struct page *p)
+{
+  bool success = false;
+
+  lock_acquire(&frame_lock);
+  if (p->status == PAGE_STATUS_FRAME)
+  {
+    struct frame *fe = frame_get(p->kpage);
+    if (fe != NULL)
+    {
+      fe->pin_cnt++;
+      success = true;
+    }
+  }
+  lock_release(&frame_lock);
+  return success;
+}
+
+// Unpin frame with kpage
+void
+frame_unpin (void *kpage)
+{
+  lock_acquire(&frame_lock);
+  struct frame *fe = frame_get(kpage);
+  if (fe != NULL && fe->pin_cnt > 0)
+  {
+    fe->pin_cnt--;
+    frame_free_unused(fe);
+  }
+  lock_release(&frame_lock);
+}
+
+// Give C, a copy of page P made by fork() in the current process,
+// P's contents: P's frame, mapped into the current process, or P's
+// swap slot.  A writable private page is mapped read-only in both
+// processes from now on, so that the first write to it copies the
+// frame (see frame_unshare()).  Returns false if memory is short.
+bool
+frame_share (struct page *p, struct page *c)
+{
+  bool success = true;
+
+  // P's status may change under us until we hold the lock
+  lock_acquire(&frame_lock);
+  c->status = p->status;
+  c->origin = p->origin;
+  c->swap_index = p->swap_index;
+  c->kpage = NULL;
+  if (p->status == PAGE_STATUS_FRAME)
+  {
+    struct frame *fe = frame_get(p->kpage);
+    uint32_t *pd = p->thread->pagedir;
+    uint32_t *cpd = c->thread->pagedir;
+
+    success = pagedir_set_page(cpd, c->upage, fe->kpage, p->writable && p->shared);
+    if (success)
+    {
+      // C holds P's changes to its file page, if any, as well
+      if (pagedir_is_dirty(pd, p->upage))
+      {
+        pagedir_set_dirty(cpd, c->upage, true);
+      }
+      if (p->writable && !p->shared)
+      {
+        pagedir_set_writable(pd, p->upage, false);
+      }
+      c->kpage = fe->kpage;
+      list_push_back(&fe->pages, &c->frame_elem);
+    }
+  }
+  else if (p->status == PAGE_STATUS_SWAP)
+  {
+    swap_share(p->swap_index);
+  }
+  lock_release(&frame_lock);
+  return success;
+}
+
+// Make P, a writable private page whose frame the caller has pinned,
+// writable again after fork() shared its frame: in place if the other
+// processes have let go of the frame, in a copy of the frame if not.
+// P stays pinned, in its new frame.  Returns false if memory is short.
+bool
+frame_unshare (struct page *p)
+{
+  uint32_t *pd = p->thread->pagedir;
+  struct frame *old, *fe;
+  struct list_elem *e;
+  void *kpage;
+  bool dirty = false;
+
+  lock_acquire(&frame_lock);
+  old = frame_get(p->kpage);
+  if (list_size(&old->pages) == 1)
+  {
+    pagedir_set_writable(pd, p->upage, true);
+    lock_release(&frame_lock);
+    return true;
+  }
+  lock_release(&frame_lock);
+
+  // the old frame stays pinned, so it's safe to copy from
+  kpage = frame_alloc(PAL_USER, NULL);
+  if (kpage == NULL)
+  {
+    return false;
+  }
+  memcpy(kpage, old->kpage, PGSIZE);
+
+  lock_acquire(&frame_lock);
+  fe = frame_get(kpage);
+  // the copy holds whatever changes were made to a file page before
+  // fork(), so it must not look clean to eviction, which would drop
+  // it and read the file back in
+  for (e = list_begin(&old->pages); e != list_end(&old->pages); e = list_next(e))
+  {
+    struct page *q = list_entry(e, struct page, frame_elem);
+    dirty = dirty || pagedir_is_dirty(q->thread->pagedir, q->upage);
+  }
+  list_remove(&p->frame_elem);
+  list_push_back(&fe->pages, &p->frame_elem);
+  // the page table for P is already there, so this can't fail
+  pagedir_clear_page(pd, p->upage);
+  pagedir_set_page(pd, p->upage, kpage, true);
+  if (dirty)
+  {
+    pagedir_set_dirty(pd, p->upage, true);
+  }
+  p->kpage = kpage;
+  old->pin_cnt--;
+  frame_free_unused(old);
+  lock_release(&frame_lock);
+  return true;
+}
+
 // Evict frame
 void
 frame_evict(void)
@@ -98,67 +248,137 @@ frame_evict(void)
   ASSERT(lock_held_by_current_thread(&frame_lock));
 
   struct frame *fe = last_frame;
-  struct page *pe;
+  struct page *first, *q;
+  struct list_elem *e;
+  size_t frame_cnt = list_size(&frame_table);
+  size_t i;
+  bool dirty = false;
+  bool to_file;
+  int swap_index = -1;
 
+  if (frame_cnt == 0)
+  {
+    return;
+  }
   if (fe == NULL)
   {
     fe = list_entry(list_front(&frame_table), struct frame, elem);
   }
 
-  while (pagedir_is_accessed(fe->thread->pagedir, fe->upage))
+  // clock algorithm, passing over pinned frames; two sweeps find a
+  // victim unless every frame is pinned
+  for (i = 0; fe->pin_cnt > 0 || frame_test_accessed(fe); i++)
   {
-    pagedir_set_accessed(fe->thread->pagedir, fe->upage, false);
-    if (list_next(&fe->elem) == list_end(&frame_table))
-    {
-      fe = list_entry(list_front(&frame_table), struct frame, elem);
-    }
-    else
+    if (i >= 2 * frame_cnt)
     {
-      fe = list_entry(list_next(&fe->elem), struct frame, elem);
+      return;
     }
+    fe = frame_next(fe);
   }
-
-  if (list_next(&fe->elem) == list_end(&frame_table))
+  last_frame = frame_next(fe);
+  if (last_frame == fe)
   {
-    last_frame = list_entry(list_front(&frame_table), struct frame, elem);
+    last_frame = NULL;
   }
-  else
+
+  // every process that maps the frame loses it together, so it is
+  // written back or swapped out once for all of them
+  ASSERT(!list_empty(&fe->pages));
+  first = list_entry(list_front(&fe->pages), struct page, frame_elem);
+  for (e = list_begin(&fe->pages); e != list_end(&fe->pages); e = list_next(e))
   {
-    last_frame = list_entry(list_next(&fe->elem), struct frame, elem);
+    q = list_entry(e, struct page, frame_elem);
+    dirty = dirty || pagedir_is_dirty(q->thread->pagedir, q->upage);
   }
 
-  // printf("frame_evict: page_get %p\n", fe->upage);
-  pe = page_get (&fe->thread->page_table, fe->upage);
-  if (pe == NULL)
+  // file pages can be read back in from the file: shared ones
+  // once written back, private ones as long as they're unmodified
+  to_file = first->origin == PAGE_STATUS_FILE && (first->shared || !dirty);
+  if (to_file && dirty)
   {
-    // printf("frame_evict: page_get failed\n");
-    lock_release(&frame_lock);
-    syscall_exit(-1);
+    file_write_at(first->file, fe->kpage, first->read_bytes, first->ofs);
+  }
+  else if (!to_file)
+  {
+    // printf("frame_evict: swap_out\n");
+    swap_index = swap_out(fe->kpage);
   }
 
-  if (pe->origin == PAGE_STATUS_FILE &&
-      pagedir_is_dirty(fe->thread->pagedir, fe->upage))
+  while (!list_empty(&fe->pages))
   {
-    // printf("frame_evict: file write; dirty\n");
-    bool lock_held = lock_held_by_current_thread(&file_lock);
-    if (!lock_held)
+    q = list_entry(list_pop_front(&fe->pages), struct page, frame_elem);
+    pagedir_clear_page(q->thread->pagedir, q->upage);
+    if (to_file)
     {
-      lock_acquire(&file_lock);
+      q->status = PAGE_STATUS_FILE;
     }
-    file_write_at(pe->file, fe->kpage, pe->read_bytes, pe->ofs);
-    if (!lock_held)
+    else
     {
-      lock_release(&file_lock);
+      // a modified private page no longer matches its file, so it
+      // is anonymous memory from now on (copy-on-write)
+      if (q->origin == PAGE_STATUS_FILE)
+      {
+        q->origin = PAGE_STATUS_ZERO;
+      }
+      q->swap_index = swap_index;
+      q->status = PAGE_STATUS_SWAP;
+      // one reference to the slot for each page
+      if (!list_empty(&fe->pages))
+      {
+        swap_share(swap_index);
+      }
     }
   }
 
-  // printf("frame_evict: swap_out\n");
-  pe->swap_index = swap_out(fe->kpage);
-  pe->status = PAGE_STATUS_SWAP;
+  frame_free_unused(fe);
+}
 
-  pagedir_clear_page(fe->thread->pagedir, fe->upage);
+// The frame after FE in the clock's order
+static struct frame *
+frame_next (struct frame *fe)
+{
+  if (list_next(&fe->elem) == list_end(&frame_table))
+  {
+    return list_entry(list_front(&frame_table), struct frame, elem);
+  }
+  return list_entry(list_next(&fe->elem), struct frame, elem);
+}
 
-  lock_release(&frame_lock);
-  frame_free(fe->kpage);
-  lock_acquire(&frame_lock);
+// Whether any process has accessed FE since the last call; clears
+// their accessed bits
+static bool
+frame_test_accessed (struct frame *fe)
+{
+  struct list_elem *e;
+  bool accessed = false;
+
+  for (e = list_begin(&fe->pages); e != list_end(&fe->pages); e = list_next(e))
+  {
+    struct page *q = list_entry(e, struct page, frame_elem);
+    if (pagedir_is_accessed(q->thread->pagedir, q->upage))
+    {
+      pagedir_set_accessed(q->thread->pagedir, q->upage, false);
+      accessed = true;
+    }
+  }
+  return accessed;
+}
+
+// Free FE if no page is in it and no one has it pinned
+static void
+frame_free_unused (struct frame *fe)
+{
+  ASSERT(lock_held_by_current_thread(&frame_lock));
+
+  if (!list_empty(&fe->pages) || fe->pin_cnt > 0)
+  {
+    return;
+  }
+  if (last_frame == fe)
+  {
+    last_frame = frame_next(fe) != fe ? frame_next(fe) : NULL;
+  }
+  list_remove(&fe->elem);
+  palloc_free_page(fe->kpage);
+  free(fe);
 }
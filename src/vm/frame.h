@@ -5,17 +5,23 @@
 #include "threads/thread.h"
 #include "threads/palloc.h"
 
+struct page;
+
 struct frame
 {
   void *kpage;                  /* Kernel virtual address. */
-  void *upage;                  /* User virtual address. */
-  struct thread *thread;        /* Thread that owns the frame. */
+  struct list pages;            /* Pages mapped to the frame (see fork()). */
+  int pin_cnt;                  /* Not to be evicted while nonzero. */
   struct list_elem elem;        /* List element. */
 };
 
 void frame_init (void);
-void *frame_alloc (enum palloc_flags flags, void *upage);
-void frame_free(void *kpage);
+void *frame_alloc (enum palloc_flags flags, struct page *p);
+void frame_release (struct page *p);
 struct frame* frame_get (void *kpage);
+bool frame_pin (struct page *p);
+void frame_unpin (void *kpage);
+bool frame_share (struct page *p, struct page *c);
+bool frame_unshare (struct page *p);
 
 #endif /* VM_FRAME_H */
@@ -1,40 +1,97 @@
 #include "vm/mmf.h"
+#include <round.h>
 #include <stdio.h>
 #include "threads/malloc.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "vm/page.h"
 
+static void mmf_unmap_page (struct hash *page_table, struct page *p);
+
+// Map LENGTH bytes of FILE, starting at page-aligned offset OFS, at
+// UPAGE.  FLAGS are MAP_* flags.  The mapping owns FILE from now on.
+// FILE is NULL for an anonymous mapping of zeroed pages.  Returns
+// NULL if part of the range is already in use.
 struct mmf *
-mmf_init (int id, struct file* file, void* upage)
+mmf_init (int id, struct file* file, void* upage, off_t ofs,
+          size_t length, int flags)
 {
-  struct mmf *mmf = (struct mmf *)malloc(sizeof mmf);
+  struct hash *page_tbl = &thread_current()->page_table;
+  size_t page_cnt = DIV_ROUND_UP(length, PGSIZE);
+  off_t size = file != NULL ? file_length(file) : 0;
+  size_t i;
+
+  ASSERT (pg_ofs(upage) == 0 && ofs % PGSIZE == 0);
+
+  for (i = 0; i < page_cnt; i++)
+  {
+    if (page_get (page_tbl, upage + i * PGSIZE) != NULL)
+    {
+      return NULL;
+    }
+  }
 
+  struct mmf *mmf = malloc(sizeof *mmf);
+  if (mmf == NULL)
+  {
+    return NULL;
+  }
   mmf->id = id;
   mmf->file = file;
   mmf->upage = upage;
+  mmf->page_cnt = page_cnt;
+  mmf->mapped_cnt = page_cnt;
+  list_push_back(&thread_current()->mmf_list, &mmf->elem);
 
-  off_t ofs;
-  int size = file_length(file);
-
-  struct hash *page_tbl = &thread_current()->page_table;
-
-  for (ofs = 0; ofs < size; ofs += PGSIZE)
+  for (i = 0; i < page_cnt; i++, ofs += PGSIZE)
   {
-    if (page_get (page_tbl, upage + ofs) != NULL)
+    struct page *p;
+    if (file == NULL)
+    {
+      p = page_zero_init(page_tbl, upage + i * PGSIZE);
+    }
+    else
+    {
+      // pages past the end of the file are zero, and never written back
+      uint32_t read_bytes = 0;
+      if (ofs < size)
+      {
+        read_bytes = ofs + PGSIZE < size ? PGSIZE : size - ofs;
+      }
+      p = page_file_init(page_tbl, upage + i * PGSIZE, file, ofs,
+                         read_bytes, PGSIZE - read_bytes, true);
+    }
+    if (p == NULL)
     {
+      // out of memory: undo, leaving FILE to the caller
+      mmf->file = NULL;
+      mmf->page_cnt = mmf->mapped_cnt = i;
+      if (i > 0)
+      {
+        mmf_unmap(mmf);
+      }
+      else
+      {
+        list_remove(&mmf->elem);
+        free(mmf);
+      }
       return NULL;
     }
+    p->shared = file != NULL && (flags & MAP_SHARED) != 0;
+    p->mmf = mmf;
   }
 
-  for (ofs = 0; ofs < size; ofs += PGSIZE)
+  // best effort: a page that can't be brought in now faults in later
+  if (flags & MAP_POPULATE)
   {
-    uint32_t read_bytes = ofs + PGSIZE < size ? PGSIZE : size - ofs;
-    page_file_init(page_tbl, upage, file, ofs, read_bytes, PGSIZE - read_bytes, true);
-    upage += PGSIZE;
+    for (i = 0; i < page_cnt; i++)
+    {
+      if (!page_load (page_tbl, upage + i * PGSIZE))
+      {
+        break;
+      }
+    }
   }
-  // printf("mmf_init: mmf->upage %p, mmf->file %p\n", (void *)mmf->upage, mmf->file);
-  list_push_back(&thread_current()->mmf_list, &mmf->elem);
   return mmf;
 }
 
@@ -49,22 +106,137 @@ mmf_get (int mmf_id)
 
     if (f->id == mmf_id)
     {
-      // printf("mmf_get: found mmf, upage %p, file %p\n", (f->upage), f->file);
-      // f->upage = *(void **)(f->upage);
       return f;
     }
   }
   return NULL;
 }
 
+// Give the current process, made by fork(), a copy of each of
+// PARENT's mappings, with a file of its own.  The copies have no
+// pages until page_table_copy() adds them.
+bool
+mmf_copy (struct thread *parent)
+{
+  struct list_elem *e;
+
+  for (e = list_begin(&parent->mmf_list); e != list_end(&parent->mmf_list); e = list_next(e))
+  {
+    struct mmf *pm = list_entry(e, struct mmf, elem);
+    struct mmf *mmf = malloc(sizeof *mmf);
+    if (mmf == NULL)
+    {
+      return false;
+    }
+    *mmf = *pm;
+    mmf->mapped_cnt = 0;
+    if (pm->file != NULL && (mmf->file = file_reopen(pm->file)) == NULL)
+    {
+      free(mmf);
+      return false;
+    }
+    list_push_back(&thread_current()->mmf_list, &mmf->elem);
+  }
+  return true;
+}
+
+// Unmap all that is left of MMF, which frees it
 void
-mmf_cleanup()
+mmf_unmap (struct mmf *mmf)
+{
+  struct hash *page_tbl = &thread_current()->page_table;
+  void *upage = mmf->upage;
+  void *end = mmf->upage + mmf->page_cnt * PGSIZE;
+
+  // a copy whose pages fork() didn't get to has none to free it with
+  if (mmf->mapped_cnt == 0)
+  {
+    list_remove(&mmf->elem);
+    file_close(mmf->file);
+    free(mmf);
+    return;
+  }
+  while (upage < end)
+  {
+    struct page *p = page_get (page_tbl, upage);
+    upage += PGSIZE;
+    if (p != NULL && p->mmf == mmf)
+    {
+      // MMF is freed along with its last page
+      bool last = mmf->mapped_cnt == 1;
+      mmf_unmap_page (page_tbl, p);
+      if (last)
+      {
+        break;
+      }
+    }
+  }
+}
+
+// Unmap the mapped pages among those covering the LENGTH bytes at
+// page-aligned ADDR, which may be parts of one or more mappings
+void
+mmf_unmap_range (void *addr, size_t length)
+{
+  struct hash *page_tbl = &thread_current()->page_table;
+  void *upage;
+
+  for (upage = addr; upage < addr + length; upage += PGSIZE)
+  {
+    struct page *p = page_get (page_tbl, upage);
+    if (p != NULL && p->mmf != NULL)
+    {
+      mmf_unmap_page (page_tbl, p);
+    }
+  }
+}
+
+// Write the modified pages of shared mappings among those covering
+// the LENGTH bytes at page-aligned ADDR back to their files.
+// Returns false, writing nothing, if part of the range is not mapped.
+bool
+mmf_sync_range (void *addr, size_t length)
+{
+  struct hash *page_tbl = &thread_current()->page_table;
+  void *upage;
+
+  for (upage = addr; upage < addr + length; upage += PGSIZE)
+  {
+    struct page *p = page_get (page_tbl, upage);
+    if (p == NULL || p->mmf == NULL)
+    {
+      return false;
+    }
+  }
+  for (upage = addr; upage < addr + length; upage += PGSIZE)
+  {
+    page_sync (page_get (page_tbl, upage));
+  }
+  return true;
+}
+
+// Unmap every mapping of the current process
+void
+mmf_cleanup (void)
 {
   struct thread *cur = thread_current();
   while (!list_empty(&cur->mmf_list))
   {
-    struct mmf *f = list_entry(list_pop_front(&cur->mmf_list), struct mmf, elem);
-    file_close(f->file);
-    free(f);
+    mmf_unmap (list_entry(list_front(&cur->mmf_list), struct mmf, elem));
+  }
+}
+
+// Unmap P, and free its mapping if it was the last page left
+static void
+mmf_unmap_page (struct hash *page_table, struct page *p)
+{
+  struct mmf *mmf = p->mmf;
+
+  page_unmap (page_table, p);
+  if (--mmf->mapped_cnt == 0)
+  {
+    list_remove(&mmf->elem);
+    file_close(mmf->file);
+    free(mmf);
   }
 }
@@ -2,18 +2,29 @@
 #define VM_MMF_H
 
 #include <list.h>
+#include <mman.h>
+#include <stddef.h>
 #include "filesys/file.h"
 
+struct thread;
+
 struct mmf
 {
     int id;
     struct list_elem elem;
     struct file *file;
     void *upage;
+    size_t page_cnt;            // pages in the mapping as created
+    size_t mapped_cnt;          // those not unmapped yet
 };
 
-struct mmf *mmf_init(int id, struct file *file, void *upage);
+struct mmf *mmf_init(int id, struct file *file, void *upage, off_t ofs,
+                     size_t length, int flags);
 struct mmf *mmf_get(int id);
+bool mmf_copy (struct thread *parent);
+void mmf_unmap (struct mmf *mmf);
+void mmf_unmap_range (void *addr, size_t length);
+bool mmf_sync_range (void *addr, size_t length);
 void mmf_cleanup (void);
 
 #endif /* VM_MMF_H */
@@ -6,15 +6,21 @@
 #include "threads/thread.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "userprog/exception.h"
 #include "userprog/syscall.h"
 #include "userprog/pagedir.h"
 #include "vm/frame.h"
+#include "vm/mmf.h"
 #include "vm/swap.h"
 
 static hash_hash_func page_hash_func;
 static hash_less_func page_less_func;
 static void page_destructor (struct hash_elem *e, void *aux);
-extern struct lock file_lock;
+static void page_release (struct page *p);
+
+// File pages to read in after a fault, beyond the faulting one
+#define READAHEAD_PAGES 2
+#define READAHEAD_SEQUENTIAL_PAGES 8
 
 // Page table initialization
 void
@@ -31,37 +37,29 @@ page_table_destroy (struct hash *page_table)
 }
 
 // Zero page initialization
-void
+struct page *
 page_zero_init (struct hash *page_table, void *upage)
 {
   struct page *p = malloc (sizeof (struct page));
+  if (p == NULL)
+  {
+    return NULL;
+  }
   p->kpage = NULL;
   p->upage = upage;
+  p->thread = thread_current ();
 
   p->status = PAGE_STATUS_ZERO;
   p->origin = PAGE_STATUS_ZERO;
 
   p->file = NULL;
   p->writable = true;
+  p->shared = false;
+  p->mmf = NULL;
+  p->advice = MADV_NORMAL;
 
   hash_insert (page_table, &p->elem);
-}
-
-// Frame page initialization
-void
-page_frame_init (struct hash *page_table, void *upage, void *kpage)
-{
-  struct page *p = malloc (sizeof (struct page));
-  p->kpage = kpage;
-  p->upage = upage;
-
-  p->status = PAGE_STATUS_FRAME;
-  p->origin = PAGE_STATUS_FRAME;
-
-  p->file = NULL;
-  p->writable = true;
-
-  hash_insert (page_table, &p->elem);
+  return p;
 }
 
 // File page initialization
@@ -71,8 +69,13 @@ page_file_init (struct hash *page_table, void *upage,
                 uint32_t zero_bytes, bool writable)
 {
   struct page *p = malloc (sizeof (struct page));
+  if (p == NULL)
+  {
+    return NULL;
+  }
   p->kpage = NULL;
   p->upage = upage;
+  p->thread = thread_current ();
 
   p->status = PAGE_STATUS_FILE;
   p->origin = PAGE_STATUS_FILE;
@@ -82,6 +85,9 @@ page_file_init (struct hash *page_table, void *upage,
   p->read_bytes = read_bytes;
   p->zero_bytes = zero_bytes;
   p->writable = writable;
+  p->shared = false;
+  p->mmf = NULL;
+  p->advice = MADV_NORMAL;
 
   hash_insert (page_table, &p->elem);
   // printf("page_file_init:       page %p, upage %p, file %p\n", p, upage, file);
@@ -92,16 +98,17 @@ bool
 page_load (struct hash *page_table, void *upage)
 {
   struct page *p = page_get (page_table, upage);
-  if (p == NULL)
+  if (p == NULL || p->status == PAGE_STATUS_FRAME)
   {
     return false;
   }
 
-  void *kpage = frame_alloc (PAL_USER, upage);
+  void *kpage = frame_alloc (PAL_USER, p);
   if (kpage == NULL)
   {
     return false;
   }
+  p->kpage = kpage;
 
   switch (p->status)
   {
@@ -115,26 +122,17 @@ page_load (struct hash *page_table, void *upage)
       break;
     case PAGE_STATUS_FILE:
     {
-      bool lock_held = lock_held_by_current_thread(&file_lock);
-      if (!lock_held)
-      {
-        lock_acquire (&file_lock);
-      }
       uint32_t file_read_bytes = file_read_at(p->file, kpage, p->read_bytes, p->ofs);
-      if (!lock_held)
-      {
-        lock_release (&file_lock);
-      }
       if (file_read_bytes != p->read_bytes)
       {
-        frame_free (p->kpage);
+        frame_release (p);
         return false;
       }
       memset (kpage + file_read_bytes, 0, p->zero_bytes);
       break;
-    // case PAGE_STATUS_FRAME: it is already loaded to frame! error!
     }
     default:
+      frame_release (p);
       return false;
   }
 
@@ -142,15 +140,85 @@ page_load (struct hash *page_table, void *upage)
       && !pagedir_set_page (thread_current ()->pagedir, upage, kpage, p->writable))
   {
     // printf("page_load: pagedir_set_page failed\n");
-    frame_free (p->kpage);
+    frame_release (p);
     return false;
   }
 
-  p->kpage = kpage;
   p->status = PAGE_STATUS_FRAME;
+  frame_unpin (kpage);
   return true;
 }
 
+// Copy PARENT's pages into PAGE_TABLE, the current process's, for
+// fork().  The copies share the parent's frames and swap slots (see
+// frame_share()), and use the current process's own executable and
+// mappings (see mmf_copy()).  Returns false if memory is short.
+bool
+page_table_copy (struct hash *page_table, struct thread *parent)
+{
+  struct thread *cur = thread_current ();
+  struct hash_iterator i;
+
+  hash_first (&i, &parent->page_table);
+  while (hash_next (&i))
+  {
+    struct page *p = hash_entry (hash_cur (&i), struct page, elem);
+    struct page *c = malloc (sizeof (struct page));
+    if (c == NULL)
+    {
+      return false;
+    }
+    *c = *p;
+    c->thread = cur;
+    if (p->mmf != NULL)
+    {
+      c->mmf = mmf_get (p->mmf->id);
+      c->file = c->mmf->file;
+    }
+    else if (p->file != NULL)
+    {
+      c->file = cur->exec_file;
+    }
+
+    if (!frame_share (p, c))
+    {
+      free (c);
+      return false;
+    }
+    hash_insert (page_table, &c->elem);
+    if (c->mmf != NULL)
+    {
+      c->mmf->mapped_cnt++;
+    }
+  }
+  return true;
+}
+
+// Handle a fault on a write to UPAGE that its mapping doesn't allow,
+// because fork() shared its frame: give the current process a frame
+// of its own to write to (see frame_unshare()).  Returns false if
+// UPAGE isn't writable at all, or memory is short.
+bool
+page_copy_on_write (struct hash *page_table, void *upage)
+{
+  struct page *p = page_get (page_table, upage);
+  bool success;
+
+  if (p == NULL || !p->writable)
+  {
+    return false;
+  }
+  // evicted since the fault: it comes back in a frame of its own
+  if (!frame_pin (p))
+  {
+    return true;
+  }
+  success = (pagedir_is_writable (thread_current ()->pagedir, upage)
+             || frame_unshare (p));
+  frame_unpin (p->kpage);
+  return success;
+}
+
 struct page* page_get (struct hash *page_table, void *upage)
 {
   struct page p;
@@ -169,6 +237,260 @@ page_delete (struct hash *page_table, struct page *p)
   free (p);
 }
 
+// Unmap P: write it back if it belongs to a shared mapping, give up
+// its frame or swap slot, and remove it from the page table
+void
+page_unmap (struct hash *page_table, struct page *p)
+{
+  page_release (p);
+  page_delete (page_table, p);
+}
+
+// Write the dirty page of a shared mapping P back to its file
+static void
+page_write_back (struct page *p)
+{
+  uint32_t *pd = p->thread->pagedir;
+
+  if (p->shared && pagedir_is_dirty (pd, p->upage))
+  {
+    // clear first, so that a write during the write-back isn't lost
+    pagedir_set_dirty (pd, p->upage, false);
+    file_write_at (p->file, p->kpage, p->read_bytes, p->ofs);
+  }
+}
+
+// Write P back to its file now if it is a dirty page of a shared
+// mapping.  Pages that are not in a frame are clean: eviction
+// writes shared pages back before giving up their frames.
+void
+page_sync (struct page *p)
+{
+  if (p->shared && frame_pin (p))
+  {
+    page_write_back (p);
+    frame_unpin (p->kpage);
+  }
+}
+
+// Drop P's contents now: it is read in again from its file, or
+// comes back zeroed, on the next access.  A modified page of a
+// shared mapping is written back first; other changes are lost,
+// without a trip to swap.
+void
+page_discard (struct page *p)
+{
+  page_release (p);
+  p->kpage = NULL;
+  p->status = p->file != NULL ? PAGE_STATUS_FILE : PAGE_STATUS_ZERO;
+  p->origin = p->status;
+}
+
+// After a fault has brought in file page P, bring in the pages of
+// the same file that follow it, so that they don't fault one at a
+// time: a few normally, more if P is in a sequential range, none if
+// it is in a random one.  Behind a sequential reader, also mark the
+// pages it is done with as not accessed, so that they are the first
+// to be evicted.
+void
+page_readahead (struct hash *page_table, struct page *p)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  int cnt;
+  int i;
+
+  switch (p->advice)
+  {
+    case MADV_RANDOM:
+      return;
+    case MADV_SEQUENTIAL:
+      cnt = READAHEAD_SEQUENTIAL_PAGES;
+      break;
+    default:
+      cnt = READAHEAD_PAGES;
+      break;
+  }
+
+  // don't let P be evicted to make room for what follows it
+  if (!frame_pin (p))
+  {
+    return;
+  }
+  for (i = 1; i <= cnt; i++)
+  {
+    struct page *q = page_get (page_table, p->upage + i * PGSIZE);
+    if (q == NULL || q->status != PAGE_STATUS_FILE || q->file != p->file
+        || q->ofs != p->ofs + i * PGSIZE || !page_load (page_table, q->upage))
+    {
+      break;
+    }
+  }
+  frame_unpin (p->kpage);
+
+  if (p->advice == MADV_SEQUENTIAL)
+  {
+    for (i = cnt + 1; i <= 2 * cnt; i++)
+    {
+      struct page *q = page_get (page_table, p->upage - i * PGSIZE);
+      if (q != NULL && q->status == PAGE_STATUS_FRAME
+          && q->advice == MADV_SEQUENTIAL)
+      {
+        pagedir_set_accessed (pd, q->upage, false);
+      }
+    }
+  }
+}
+
+// Apply ADVICE, one of the MADV_* values, to the pages covering the
+// LENGTH bytes at page-aligned ADDR.  Returns false, doing nothing,
+// if ADVICE is unknown or part of the range is not in use.
+bool
+page_advise (struct hash *page_table, void *addr, size_t length, int advice)
+{
+  void *upage;
+
+  if (advice < MADV_NORMAL || advice > MADV_DONTNEED)
+  {
+    return false;
+  }
+  for (upage = addr; upage < addr + length; upage += PGSIZE)
+  {
+    if (page_get (page_table, upage) == NULL)
+    {
+      return false;
+    }
+  }
+
+  for (upage = addr; upage < addr + length; upage += PGSIZE)
+  {
+    struct page *p = page_get (page_table, upage);
+    switch (advice)
+    {
+      case MADV_WILLNEED:
+        // best effort: stop if memory runs short
+        if (p->status != PAGE_STATUS_FRAME && !page_load (page_table, upage))
+        {
+          return true;
+        }
+        break;
+      case MADV_DONTNEED:
+        page_discard (p);
+        break;
+      default:
+        p->advice = advice;
+        break;
+    }
+  }
+  return true;
+}
+
+// Whether a fault at ADDR, with user stack pointer ESP, should
+// grow the stack
+bool
+page_is_stack_addr (const void *addr, const void *esp)
+{
+  return (esp - 32 <= addr && PHYS_BASE - MAX_STACK_SIZE <= addr
+          && is_user_vaddr(addr));
+}
+
+// Bring in upage and pin its frame
+static bool
+page_pin (struct hash *page_table, void *upage, bool write)
+{
+  struct page *p = page_get (page_table, upage);
+  if (p == NULL)
+  {
+    if (!page_is_stack_addr (upage, thread_current ()->user_esp))
+    {
+      return false;
+    }
+    p = page_zero_init (page_table, upage);
+    if (p == NULL)
+    {
+      return false;
+    }
+  }
+  if (write && !p->writable)
+  {
+    return false;
+  }
+
+  // the page may be evicted again between loading and pinning
+  while (!frame_pin (p))
+  {
+    if (p->status != PAGE_STATUS_FRAME && !page_load (page_table, upage))
+    {
+      return false;
+    }
+  }
+
+  // copy a frame shared by fork() now, while it's pinned, rather than
+  // when the kernel's write faults
+  if (write && !pagedir_is_writable (thread_current ()->pagedir, upage)
+      && !frame_unshare (p))
+  {
+    frame_unpin (p->kpage);
+    return false;
+  }
+  return true;
+}
+
+// Bring in and pin the pages covering the SIZE bytes at UADDR, so
+// that the kernel can access them without page faults (and, in
+// particular, while holding locks that the page fault handler may
+// need) until page_unpin_range().  WRITE means they will be written
+// to.  Returns false, with nothing left pinned, if some of them are
+// not valid user memory.
+bool
+page_pin_range (struct hash *page_table, const void *uaddr, size_t size,
+                bool write)
+{
+  void *start = pg_round_down (uaddr);
+  void *upage;
+
+  if (size == 0)
+  {
+    return true;
+  }
+  if (!is_user_vaddr (uaddr) || size > (size_t) (PHYS_BASE - uaddr))
+  {
+    return false;
+  }
+
+  for (upage = start; upage < uaddr + size; upage += PGSIZE)
+  {
+    if (!page_pin (page_table, upage, write))
+    {
+      if (upage != start)
+      {
+        page_unpin_range (page_table, start, upage - start);
+      }
+      return false;
+    }
+  }
+  return true;
+}
+
+// Unpin the pages pinned by page_pin_range()
+void
+page_unpin_range (struct hash *page_table, const void *uaddr, size_t size)
+{
+  void *upage;
+
+  if (size == 0)
+  {
+    return;
+  }
+  for (upage = pg_round_down (uaddr); upage < uaddr + size; upage += PGSIZE)
+  {
+    struct page *p = page_get (page_table, upage);
+    if (p != NULL && p->status == PAGE_STATUS_FRAME)
+    {
+      frame_unpin (p->kpage);
+    }
+  }
+}
+
 static unsigned
 page_hash_func (const struct hash_elem *e, void *aux UNUSED)
 {
@@ -185,37 +507,27 @@ page_less_func (const struct hash_elem *a, const struct hash_elem *b,
   return pa->upage < pb->upage;
 }
 
+// Write back and free whatever holds P's contents
 static void
-page_destructor (struct hash_elem *e, void *aux UNUSED)
+page_release (struct page *p)
 {
-  struct page *p = hash_entry (e, struct page, elem);
-  switch (p->status)
+  // pinning keeps the frame from being evicted under us; if that
+  // fails, the page has already left its frame
+  if (frame_pin (p))
   {
-    case PAGE_STATUS_FRAME:
-      if (p->origin == PAGE_STATUS_FILE && p->writable &&
-          pagedir_is_dirty (thread_current ()->pagedir, p->upage))
-      {
-        bool lock_held = lock_held_by_current_thread(&file_lock);
-        if (!lock_held)
-        {
-          lock_acquire(&file_lock);
-        }
-        file_write_at (p->file, p->kpage, p->read_bytes, p->ofs);
-        if (!lock_held)
-        {
-          lock_release(&file_lock);
-        }
-      }
-      frame_free (p->kpage);
-      break;
-    case PAGE_STATUS_SWAP:
-      swap_free (p->swap_index);
-      break;
-    case PAGE_STATUS_FILE:
-      break;
-    case PAGE_STATUS_ZERO:
-      break;
+    page_write_back (p);
+    frame_release (p);
   }
+  else if (p->status == PAGE_STATUS_SWAP)
+  {
+    swap_free (p->swap_index);
+  }
+}
 
+static void
+page_destructor (struct hash_elem *e, void *aux UNUSED)
+{
+  struct page *p = hash_entry (e, struct page, elem);
+  page_release (p);
   free (p);
 }
@@ -2,9 +2,14 @@
 #define VM_PAGE_H
 
 #include <hash.h>
+#include <list.h>
+#include <mman.h>
 #include "filesys/file.h"
 #include "filesys/off_t.h"
 
+struct mmf;
+struct thread;
+
 enum page_status
 {
   PAGE_STATUS_ZERO,
@@ -17,8 +22,10 @@ struct page
 {
   void *upage;
   void *kpage;
+  struct thread *thread;        // process the page belongs to
 
   struct hash_elem elem;
+  struct list_elem frame_elem;  // element in its frame's list of pages
 
   enum page_status status;
   enum page_status origin;
@@ -27,20 +34,35 @@ struct page
   off_t ofs;
   uint32_t read_bytes, zero_bytes;
   bool writable;
+  bool shared;                  // write changes back to FILE?
+  struct mmf *mmf;              // mapping this page belongs to, or NULL
+  int advice;                   // MADV_NORMAL, MADV_RANDOM, or MADV_SEQUENTIAL
   int swap_index;
 };
 
 void page_table_init (struct hash *page_table);
 void page_table_destroy (struct hash *page_table);
 void page_init (struct hash *page_table, void *upage, void *kpage);
-void page_zero_init (struct hash *page_table, void *upage);
-void page_frame_init (struct hash *page_table, void *upage, void *kpage);
+struct page *page_zero_init (struct hash *page_table, void *upage);
 struct page* page_file_init (struct hash *page_table, void *upage,
                               struct file *file, off_t ofs,
                               uint32_t read_bytes, uint32_t zero_bytes,
                               bool writable);
 bool page_load (struct hash *page_table, void *upage);
+bool page_table_copy (struct hash *page_table, struct thread *parent);
+bool page_copy_on_write (struct hash *page_table, void *upage);
 struct page* page_get (struct hash *page_table, void *upage);
 void page_delete (struct hash *page_table, struct page *p);
+void page_unmap (struct hash *page_table, struct page *p);
+void page_sync (struct page *p);
+void page_discard (struct page *p);
+void page_readahead (struct hash *page_table, struct page *p);
+bool page_advise (struct hash *page_table, void *addr, size_t length,
+                  int advice);
+bool page_is_stack_addr (const void *addr, const void *esp);
+bool page_pin_range (struct hash *page_table, const void *uaddr,
+                     size_t size, bool write);
+void page_unpin_range (struct hash *page_table, const void *uaddr,
+                       size_t size);
 
 #endif /* VM_PAGE_H */
@@ -1,6 +1,7 @@
 #include "vm/swap.h"
 #include <bitmap.h>
 #include <stdio.h>
+#include "threads/malloc.h"
 #include "threads/vaddr.h"
 #include "threads/synch.h"
 #include "userprog/syscall.h"
@@ -11,18 +12,27 @@ static struct bitmap *swap_table;
 static struct block *swap_block;
 static struct lock swap_lock;
 
+// Number of pages whose contents are in each slot: more than one
+// after fork() shares a slot, or a frame that is then swapped out
+static uint16_t *swap_refs;
+
 void swap_table_init(void)
 {
+  size_t slot_cnt;
+
   swap_block = block_get_role (BLOCK_SWAP);
-  swap_table = bitmap_create(block_size(swap_block) / SECTORS_PER_PAGE);
+  slot_cnt = block_size(swap_block) / SECTORS_PER_PAGE;
+  swap_table = bitmap_create(slot_cnt);
+  swap_refs = calloc(slot_cnt, sizeof *swap_refs);
 
   bitmap_set_all(swap_table, false);
   lock_init(&swap_lock);
 }
 
+// Read P's contents in from swap to KVA, giving up P's reference to
+// its slot
 void swap_in(struct page *p, void *kva)
 {
-  int i;
   unsigned swap_index = p->swap_index;
 
   lock_acquire (&swap_lock);
@@ -35,34 +45,42 @@ void swap_in(struct page *p, void *kva)
   {
     syscall_exit (-1);
   }
-
-  bitmap_set (swap_table, swap_index, false);
-
   lock_release (&swap_lock);
 
-  for (i = 0; i < SECTORS_PER_PAGE; i++)
-  {
-    block_read (swap_block, swap_index * SECTORS_PER_PAGE + i, kva + i * BLOCK_SECTOR_SIZE);
-  }
+  // one command for the whole page rather than one per sector; the
+  // slot stays ours until the read is done
+  block_read_multiple (swap_block, swap_index * SECTORS_PER_PAGE,
+                       SECTORS_PER_PAGE, kva);
+
+  swap_free (swap_index);
 }
 
 int swap_out(void *kva)
 {
-  int i;
   int swap_index;
 
   lock_acquire(&swap_lock);
   swap_index = bitmap_scan_and_flip (swap_table, 0, 1, false);
+  swap_refs[swap_index] = 1;
   lock_release(&swap_lock);
 
-  for (i = 0; i < SECTORS_PER_PAGE; i++)
-  {
-    block_write (swap_block, swap_index * SECTORS_PER_PAGE + i, kva + i * BLOCK_SECTOR_SIZE);
-  }
+  block_write_multiple (swap_block, swap_index * SECTORS_PER_PAGE,
+                        SECTORS_PER_PAGE, kva);
 
   return swap_index;
 }
 
+// Add a reference to a slot in use, for another page with the same
+// contents
+void swap_share(unsigned swap_index)
+{
+  lock_acquire(&swap_lock);
+  ASSERT (bitmap_test (swap_table, swap_index));
+  swap_refs[swap_index]++;
+  lock_release(&swap_lock);
+}
+
+// Drop a reference to a slot, freeing it with the last one
 void swap_free(unsigned swap_index)
 {
   lock_acquire(&swap_lock);
@@ -75,6 +93,9 @@ void swap_free(unsigned swap_index)
   {
     syscall_exit (-1);
   }
-  bitmap_set(swap_table, swap_index, false);
+  if (--swap_refs[swap_index] == 0)
+  {
+    bitmap_set(swap_table, swap_index, false);
+  }
   lock_release(&swap_lock);
 }
@@ -8,6 +8,7 @@
 void swap_table_init(void);
 void swap_in(struct page *p, void *kva);
 int swap_out(void *kva);
+void swap_share(unsigned swap_index);
 void swap_free(unsigned swap_index);
 
 #endif /* VM_SWAP_H */